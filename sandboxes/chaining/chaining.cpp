@@ -0,0 +1,100 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include <libslic3r/ShortestPath.hpp>
+#include <libslic3r/ExtrusionEntity.hpp>
+#include <libslic3r/Polyline.hpp>
+
+// Benchmark of chain_polylines() and chain_extrusion_entities() on random short segments spread over a print bed,
+// emulating a layer with a lot of gap fill or support lines. Reports the travel length and the run time
+// with and without the spatial clustering for increasing numbers of segments.
+
+const std::string USAGE_STR = {
+    "Usage: chaining [max_segments]"
+};
+
+using namespace Slic3r;
+
+static Polylines random_segments(size_t num_segments)
+{
+    std::mt19937 rng(num_segments);
+    std::uniform_real_distribution<double> dist_pos(0., scale_(250.));
+    std::uniform_real_distribution<double> dist_len(- scale_(2.), scale_(2.));
+    Polylines out;
+    out.reserve(num_segments);
+    for (size_t i = 0; i < num_segments; ++ i) {
+        Point a(dist_pos(rng), dist_pos(rng));
+        out.emplace_back(a, a + Point(dist_len(rng), dist_len(rng)));
+    }
+    return out;
+}
+
+template<typename T> static double travel_length(const T &first_points, const T &last_points)
+{
+    double len = 0.;
+    for (size_t i = 1; i < first_points.size(); ++ i)
+        len += (first_points[i] - last_points[i - 1]).template cast<double>().norm();
+    return unscale<double>(len);
+}
+
+template<typename Fn> static double measure(Fn &&fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(const int argc, const char *argv[])
+{
+    if (argc > 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+    size_t max_segments = (argc == 2) ? size_t(std::stoul(argv[1])) : 64000;
+
+    std::cout << "function;segments;cluster_size;travel_mm;time_s" << std::endl;
+    for (size_t num_segments = 1000; num_segments <= max_segments; num_segments *= 2) {
+        const Polylines segments = random_segments(num_segments);
+        for (size_t cluster_size : { size_t(0), ChainingParams().max_cluster_size }) {
+            ChainingParams params;
+            params.max_cluster_size = cluster_size;
+            // The 2-opt improvement is cubic in the number of segments.
+            params.time_budget      = 0.5;
+            // The unclustered reference is too slow for large inputs.
+            if (cluster_size == 0 && num_segments > 16000)
+                continue;
+
+            Polylines chained;
+            double t = measure([&segments, &chained, &params]() { chained = chain_polylines(segments, nullptr, params); });
+            Points first_points, last_points;
+            for (const Polyline &pl : chained) {
+                first_points.emplace_back(pl.first_point());
+                last_points.emplace_back(pl.last_point());
+            }
+            std::cout << "chain_polylines;" << num_segments << ";" << cluster_size << ";" << travel_length(first_points, last_points) << ";" << t << std::endl;
+
+            std::vector<ExtrusionPath> paths;
+            paths.reserve(segments.size());
+            for (const Polyline &pl : segments) {
+                paths.emplace_back(erGapFill);
+                paths.back().polyline = pl;
+            }
+            std::vector<ExtrusionEntity*> entities;
+            for (ExtrusionPath &path : paths)
+                entities.emplace_back(&path);
+            Point start_near(0, 0);
+            t = measure([&entities, &start_near, &params]() { chain_and_reorder_extrusion_entities(entities, &start_near, params); });
+            first_points.clear();
+            last_points.clear();
+            for (const ExtrusionEntity *ee : entities) {
+                first_points.emplace_back(ee->first_point());
+                last_points.emplace_back(ee->last_point());
+            }
+            std::cout << "chain_extrusion_entities;" << num_segments << ";" << cluster_size << ";" << travel_length(first_points, last_points) << ";" << t << std::endl;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
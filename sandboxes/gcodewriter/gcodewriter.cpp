@@ -0,0 +1,114 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include <libslic3r/GCodeWriter.hpp>
+
+// Benchmark of the G-code emitting of extrusion paths: the former std::ostringstream based formatting
+// returning a temporary string per G-code line is compared with GCodeWriter appending to a single output string.
+// Reports the number of heap allocations, the run time and the throughput in G-code lines per second.
+
+const std::string USAGE_STR = {
+    "Usage: gcodewriter [num_lines]"
+};
+
+using namespace Slic3r;
+
+static std::atomic<size_t> g_num_allocations { 0 };
+
+void* operator new(size_t size)
+{
+    ++ g_num_allocations;
+    if (void *ptr = std::malloc(size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+// The G1 line of an extrusion as it was formatted by GCodeWriter::extrude_to_xy() before the GCodeFormatter was introduced.
+static std::string extrude_to_xy_ostringstream(const Vec2d &point, double E)
+{
+    std::ostringstream gcode;
+    gcode << "G1 X" << std::fixed << std::setprecision(3) << point(0)
+          <<   " Y" << std::fixed << std::setprecision(3) << point(1)
+          <<   " E" << std::fixed << std::setprecision(5) << E;
+    gcode << "\n";
+    return gcode.str();
+}
+
+template<typename Fn> static void measure(const char *name, size_t num_lines, Fn &&fn)
+{
+    size_t num_allocations = g_num_allocations;
+    auto   start           = std::chrono::steady_clock::now();
+    size_t size            = fn();
+    double time            = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ";" << num_lines << ";" << g_num_allocations - num_allocations << ";" << time << ";"
+              << size_t(double(num_lines) / time) << ";" << size << std::endl;
+}
+
+int main(const int argc, const char *argv[])
+{
+    if (argc > 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+    const size_t num_lines = (argc == 2) ? size_t(std::stoul(argv[1])) : 2000000;
+    // Paths of 20 lines each, one string per path as GCode::_extrude() produces.
+    const size_t path_length = 20;
+
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> dist(0., 250.);
+    std::vector<Vec2d> points(num_lines);
+    for (Vec2d &pt : points)
+        pt = Vec2d(dist(rng), dist(rng));
+
+    std::cout << "method;lines;allocations;time_s;lines_per_s;gcode_size" << std::endl;
+    measure("ostringstream", num_lines, [&points, path_length]() {
+        size_t size = 0;
+        double E    = 0.;
+        for (size_t i = 0; i < points.size(); i += path_length) {
+            std::string gcode;
+            for (size_t j = i; j < std::min(points.size(), i + path_length); ++ j)
+                gcode += extrude_to_xy_ostringstream(points[j], E += 0.01);
+            size += gcode.size();
+        }
+        return size;
+    });
+
+    GCodeWriter writer;
+    writer.set_extruders({ 0 });
+    writer.set_extruder(0);
+    measure("GCodeWriter returning strings", num_lines, [&points, &writer, path_length]() {
+        size_t size = 0;
+        for (size_t i = 0; i < points.size(); i += path_length) {
+            std::string gcode;
+            for (size_t j = i; j < std::min(points.size(), i + path_length); ++ j)
+                gcode += writer.extrude_to_xy(points[j], 0.01);
+            size += gcode.size();
+        }
+        return size;
+    });
+    writer.reset_e(true);
+    measure("GCodeWriter appending", num_lines, [&points, &writer, path_length]() {
+        size_t      size = 0;
+        std::string gcode;
+        for (size_t i = 0; i < points.size(); i += path_length) {
+            // Reuse the output buffer the same way the G-code export appends paths of a layer into a single string.
+            gcode.clear();
+            for (size_t j = i; j < std::min(points.size(), i + path_length); ++ j)
+                writer.extrude_to_xy(gcode, points[j], 0.01);
+            size += gcode.size();
+        }
+        return size;
+    });
+
+    return EXIT_SUCCESS;
+}
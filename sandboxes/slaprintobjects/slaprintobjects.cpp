@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/SLAPrint.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+
+#include <tbb/task_scheduler_init.h>
+
+// Scaling of the SLA processing of a plate with many objects over the number of threads.
+// Each object is a sphere on top of a cylinder, so that it gets support points, a support tree and a pad.
+// Reports the run time of SLAPrint::process() for a plate with a single object and for a plate with
+// num_objects objects, each with 1, 2, 4, ... threads up to the number of hardware threads.
+
+const std::string USAGE_STR = {
+    "Usage: slaprintobjects [num_objects]"
+};
+
+using namespace Slic3r;
+
+int main(const int argc, const char *argv[])
+{
+    if (argc > 2) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+    const size_t num_objects = (argc > 1) ? size_t(std::stoul(argv[1])) : 12;
+
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    config.set_deserialize({
+        { "printer_technology", "SLA" },
+        { "supports_enable",    "1" },
+        { "pad_enable",         "1" }
+        });
+
+    auto make_plate = [](size_t objects) {
+        Model model;
+        const size_t grid = size_t(std::ceil(std::sqrt(double(objects))));
+        for (size_t i = 0; i < objects; ++ i) {
+            TriangleMesh mesh = make_sphere(6., PI / 30.);
+            TriangleMesh stem = make_cylinder(2., 8., PI / 30.);
+            stem.translate(0.f, 0.f, -14.f);
+            mesh.merge(stem);
+            ModelObject *object = model.add_object();
+            object->add_volume(mesh);
+            object->add_instance()->set_offset(Vec3d(-30. + 16. * double(i % grid), -50. + 16. * double(i / grid), 0.));
+        }
+        return model;
+    };
+
+    std::cout << "objects;threads;process_s" << std::endl;
+    const size_t max_threads = size_t(tbb::task_scheduler_init::default_num_threads());
+    for (size_t objects : { size_t(1), num_objects }) {
+        Model model = make_plate(objects);
+        for (size_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+            tbb::task_scheduler_init init(int(threads));
+            SLAPrint print;
+            print.apply(model, config);
+            print.set_status_silent();
+            auto start = std::chrono::steady_clock::now();
+            print.process();
+            std::cout << objects << ";" << threads << ";" << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << std::endl;
+            if (threads == max_threads)
+                break;
+        }
+        if (num_objects == 1)
+            break;
+    }
+    return EXIT_SUCCESS;
+}
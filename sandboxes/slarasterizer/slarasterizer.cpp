@@ -0,0 +1,109 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/SLA/AGGRaster.hpp>
+#include <libslic3r/SLA/RasterBase.hpp>
+
+// Benchmark of the rasterization and of the PNG encoding of SLA layers at the resolution of the SL1 display and at 4K.
+// A synthetic layer resembles a sliced model with supports: a few large rings with holes and a grid of support pillars.
+// Reports layers per second of drawing the layer polygon by polygon, drawing the whole layer at once and encoding it.
+
+const std::string USAGE_STR = {
+    "Usage: slarasterizer [num_layers] [num_pillars]"
+};
+
+using namespace Slic3r;
+
+template<typename Fn> static double measure(Fn &&fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static ClipperLib::Path circle(double cx, double cy, double r, size_t steps, bool hole)
+{
+    ClipperLib::Path path;
+    path.reserve(steps);
+    for (size_t i = 0; i < steps; ++ i) {
+        double a = (hole ? -2. : 2.) * PI * double(i) / double(steps);
+        path.push_back({ ClipperLib::cInt(scaled(cx + r * std::cos(a))), ClipperLib::cInt(scaled(cy + r * std::sin(a))) });
+    }
+    return path;
+}
+
+static std::vector<ClipperLib::Polygon> make_layer(double w, double h, size_t num_pillars)
+{
+    std::vector<ClipperLib::Polygon> layer;
+    // Hollowed object cross sections.
+    for (size_t i = 0; i < 3; ++ i) {
+        ClipperLib::Polygon poly;
+        double cx = w * double(i + 1) / 4.;
+        poly.Contour = circle(cx, h / 2., w / 10., 720, false);
+        poly.Holes.emplace_back(circle(cx, h / 2., w / 14., 720, true));
+        layer.emplace_back(std::move(poly));
+    }
+    // Support pillars outside of the cross sections, the polygons of a sliced layer do not overlap.
+    size_t grid = size_t(std::ceil(std::sqrt(double(num_pillars))));
+    for (size_t i = 0; i < num_pillars; ++ i) {
+        double x = w * (double(i % grid) + .5) / double(grid);
+        double y = h * (double(i / grid) + .5) / double(grid);
+        bool   inside = false;
+        for (size_t j = 0; j < 3 && ! inside; ++ j)
+            inside = std::hypot(x - w * double(j + 1) / 4., y - h / 2.) < w / 10. + 1.;
+        if (! inside) {
+            ClipperLib::Polygon poly;
+            poly.Contour = circle(x, y, .5, 45, false);
+            layer.emplace_back(std::move(poly));
+        }
+    }
+    return layer;
+}
+
+static void benchmark(const std::string &name, const sla::RasterBase::Resolution &res, const sla::RasterBase::PixelDim &pxdim, size_t num_layers, size_t num_pillars)
+{
+    double w = double(res.width_px) * pxdim.w_mm;
+    double h = double(res.height_px) * pxdim.h_mm;
+    std::vector<ClipperLib::Polygon> layer = make_layer(w, h, num_pillars);
+
+    sla::RasterGrayscaleAAGammaPower raster(res, pxdim, {}, 1.);
+    double time_polygons = measure([&]() {
+        for (size_t i = 0; i < num_layers; ++ i) {
+            raster.clear();
+            for (const ClipperLib::Polygon &poly : layer)
+                raster.draw(poly);
+        }
+    });
+    double time_layer = measure([&]() {
+        for (size_t i = 0; i < num_layers; ++ i) {
+            raster.clear();
+            raster.draw(layer);
+        }
+    });
+    size_t png_size = 0;
+    double time_encode = measure([&]() {
+        for (size_t i = 0; i < num_layers; ++ i)
+            png_size = raster.encode(sla::PNGRasterEncoder()).size();
+    });
+    std::cout << name << ";" << res.width_px << "x" << res.height_px << ";" << 
+        double(num_layers) / time_polygons << ";" << double(num_layers) / time_layer << ";" << double(num_layers) / time_encode << ";" << png_size << std::endl;
+}
+
+int main(const int argc, const char *argv[])
+{
+    if (argc > 3) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+    const size_t num_layers  = (argc > 1) ? size_t(std::stoul(argv[1])) : 50;
+    const size_t num_pillars = (argc > 2) ? size_t(std::stoul(argv[2])) : 400;
+
+    std::cout << "display;resolution;draw_polygons_layers_per_s;draw_layer_layers_per_s;png_layers_per_s;png_bytes" << std::endl;
+    benchmark("SL1", { 1440, 2560 }, { 68.04 / 1440, 120.96 / 2560 }, num_layers, num_pillars);
+    benchmark("4K",  { 3840, 2160 }, { 0.035, 0.035 }, num_layers, num_pillars);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/GCode/ToolOrdering.hpp>
+
+// Benchmark of the tool ordering and of the planning of wiping into infill for a multi-material plate:
+// a grid of cubes, each printed with one of the extruders in a round robin fashion, with a wipe tower and wiping into infill enabled.
+// Reports the run time of the ToolOrdering construction and of the wiping planning as performed by Print::_make_wipe_tower(),
+// and the number of layers with overridden extrusions to compare the results between versions.
+
+const std::string USAGE_STR = {
+    "Usage: toolordering [num_objects] [num_extruders]"
+};
+
+using namespace Slic3r;
+
+template<typename Fn> static double measure(Fn &&fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(const int argc, const char *argv[])
+{
+    if (argc > 3) {
+        std::cout << USAGE_STR << std::endl;
+        return EXIT_FAILURE;
+    }
+    const size_t num_objects   = (argc > 1) ? size_t(std::stoul(argv[1])) : 30;
+    const size_t num_extruders = (argc > 2) ? size_t(std::stoul(argv[2])) : 5;
+
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    config.set_num_extruders(unsigned(num_extruders));
+    config.set_deserialize({
+        { "wipe_tower",         "1" },
+        { "wipe_tower_x",       "220" },
+        { "wipe_tower_y",       "10" },
+        { "wipe_into_infill",   "1" },
+        { "layer_height",       "0.1" },
+        { "bed_shape",          "0x0,400x0,400x400,0x400" }
+        });
+
+    Model model;
+    const size_t grid = size_t(std::ceil(std::sqrt(double(num_objects))));
+    for (size_t i = 0; i < num_objects; ++ i) {
+        ModelObject *object = model.add_object();
+        object->add_volume(make_cube(20., 20., 20.));
+        object->add_instance()->set_offset(Vec3d(5. + 30. * double(i % grid), 5. + 30. * double(i / grid), 0.));
+        object->config.set_key_value("extruder", new ConfigOptionInt(int(i % num_extruders) + 1));
+    }
+    Print print;
+    print.apply(model, config);
+    print.set_status_silent();
+    std::cout << "Slicing " << num_objects << " objects printed with " << num_extruders << " extruders" << std::endl;
+    print.process();
+
+    // Repeat the planning to get a stable measurement, the planning of a single plate takes just milliseconds.
+    const size_t num_repeats    = 20;
+    const float  volume_to_wipe = 140.f;
+    ToolOrdering tool_ordering;
+    double time_ordering = 0.;
+    double time_wiping   = 0.;
+    for (size_t i = 0; i < num_repeats; ++ i) {
+        time_ordering += measure([&tool_ordering, &print]() { tool_ordering = ToolOrdering(print, (unsigned int)-1, true); });
+        time_wiping   += measure([&tool_ordering, &print, volume_to_wipe]() {
+            unsigned int current_extruder_id = tool_ordering.all_extruders().back();
+            for (LayerTools &layer_tools : tool_ordering.layer_tools()) {
+                if (! layer_tools.has_wipe_tower)
+                    continue;
+                for (unsigned int extruder_id : layer_tools.extruders)
+                    if (extruder_id != current_extruder_id) {
+                        layer_tools.wiping_extrusions().mark_wiping_extrusions(print, current_extruder_id, extruder_id, volume_to_wipe);
+                        current_extruder_id = extruder_id;
+                    }
+                layer_tools.wiping_extrusions().ensure_perimeters_infills_order(print);
+            }
+        });
+    }
+    size_t num_overridden = 0;
+    for (LayerTools &layer_tools : tool_ordering.layer_tools())
+        if (layer_tools.wiping_extrusions().is_anything_overridden())
+            ++ num_overridden;
+
+    std::cout << "layers;tool_ordering_s;wiping_s;layers_overridden" << std::endl;
+    std::cout << tool_ordering.layer_tools().size() << ";" << time_ordering / num_repeats << ";" << time_wiping / num_repeats << ";" << num_overridden << std::endl;
+    return EXIT_SUCCESS;
+}
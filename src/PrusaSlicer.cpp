@@ -21,6 +21,7 @@
 #include <string>
 #include <cstring>
 #include <iostream>
+#include <thread>
 #include <math.h>
 #include <boost/filesystem.hpp>
 #include <boost/nowide/args.hpp>
@@ -32,6 +33,7 @@
 
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Config.hpp"
+#include "libslic3r/GCode.hpp"
 #include "libslic3r/Geometry.hpp"
 #include "libslic3r/Model.hpp"
 #include "libslic3r/ModelArrange.hpp"
@@ -395,6 +397,16 @@ int CLI::run(int argc, char **argv)
                 model.add_default_instances();
                 model.print_info();
             }
+        } else if (opt_key == "gcode_analyze") {
+            // --gcode-analyze works on a G-code file, the machine limits are taken from the printer configuration.
+            PrintConfig config;
+            config.apply(m_print_config, true);
+            try {
+                boost::nowide::cout << analyze_gcode_file(m_config.opt_string("gcode_analyze"), config).to_json();
+            } catch (const std::exception &ex) {
+                boost::nowide::cerr << "error: " << ex.what() << std::endl;
+                return 1;
+            }
         } else if (opt_key == "export_stl") {
             for (auto &model : m_models)
                 model.add_default_instances();
@@ -435,6 +447,9 @@ int CLI::run(int argc, char **argv)
                 Print       fff_print;
                 SLAPrint    sla_print;
                 SL1Archive  sla_archive(sla_print.printer_config());
+                // The layers are exported just once, thus write them into the archive as they are rasterized
+                // instead of keeping all of them in memory, with a few layers per thread in flight.
+                sla_archive.set_streaming(4 * std::max(1u, std::thread::hardware_concurrency()));
                 sla_print.set_printer(&sla_archive);
                 sla_print.set_status_callback(
                             [](const PrintBase::SlicingStatus& s)
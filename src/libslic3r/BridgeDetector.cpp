@@ -3,6 +3,8 @@
 #include "Geometry.hpp"
 #include <algorithm>
 
+#include <tbb/parallel_for.h>
+
 namespace Slic3r {
 
 BridgeDetector::BridgeDetector(
@@ -72,6 +74,125 @@ void BridgeDetector::initialize()
     */
 }
 
+// Evaluates the bridging directions by covering the bridge with parallel lines spaced by the extrusion width,
+// clipping the lines with the (slightly inflated) bridge area and summing the lengths of the clipped lines,
+// which have both end points anchored.
+// Instead of clipping the lines with Clipper for each direction, edges of the clipping area and of the anchors
+// are stored once and the lines are intersected with the rotated edges as scan lines.
+class BridgeAngleEvaluator
+{
+public:
+    BridgeAngleEvaluator(const Polygons &clip_area, const ExPolygons &anchor_regions, coord_t spacing) :
+        m_anchor_regions(anchor_regions), m_spacing(spacing)
+    {
+        append_edges(m_clip_edges, clip_area);
+        for (const ExPolygon &expoly : anchor_regions) {
+            append_edges(m_anchor_edges, expoly.contour);
+            for (const Polygon &hole : expoly.holes)
+                append_edges(m_anchor_edges, hole);
+        }
+    }
+
+    // Returns total length of the anchored lines and the length of the longest anchored line in the bridging direction.
+    // The lines are generated the same way as the former Clipper based implementation did:
+    // over an oriented bounding box of the anchors, starting at its minimum, spaced by m_spacing.
+    void evaluate(double angle, double &total_length, double &max_length) const
+    {
+        total_length = 0.;
+        max_length   = 0.;
+
+        // Get an oriented bounding box around _anchor_regions.
+        BoundingBox bbox = get_extents_rotated(m_anchor_regions, - angle);
+        if (! bbox.defined)
+            return;
+        const size_t num_lines = size_t((bbox.max(1) - bbox.min(1)) / m_spacing) + 1;
+        const double s = sin(- angle);
+        const double c = cos(- angle);
+        std::vector<Crossing> clip_crossings   = this->crossings(m_clip_edges,   s, c, double(bbox.min(1)), num_lines);
+        std::vector<Crossing> anchor_crossings = this->crossings(m_anchor_edges, s, c, double(bbox.min(1)), num_lines);
+
+        const double xmin = double(bbox.min(0));
+        const double xmax = double(bbox.max(0));
+        auto it_clip   = clip_crossings.begin();
+        auto it_anchor = anchor_crossings.begin();
+        for (size_t i_line = 0; i_line < num_lines; ++ i_line) {
+            auto it_clip_end   = std::find_if(it_clip,   clip_crossings.end(),   [i_line](const Crossing &cr) { return cr.line_idx != i_line; });
+            auto it_anchor_end = std::find_if(it_anchor, anchor_crossings.end(), [i_line](const Crossing &cr) { return cr.line_idx != i_line; });
+            // Is the point on the scan line inside the anchors? Even-odd rule, the anchor regions do not overlap.
+            auto anchored = [it_anchor, it_anchor_end](double x) {
+                return ((std::lower_bound(it_anchor, it_anchor_end, x, [](const Crossing &cr, double x) { return cr.x < x; }) - it_anchor) & 1) == 1;
+            };
+            // The clipping area is a result of an offset, thus it is not self intersecting: the crossings are paired.
+            for (auto it = it_clip; it + 1 < it_clip_end; it += 2) {
+                double x1 = std::max(xmin, it->x);
+                double x2 = std::min(xmax, (it + 1)->x);
+                if (x1 < x2 && anchored(x1) && anchored(x2)) {
+                    // This line could be anchored.
+                    double len = x2 - x1;
+                    total_length += len;
+                    max_length = std::max(max_length, len);
+                }
+            }
+            it_clip   = it_clip_end;
+            it_anchor = it_anchor_end;
+        }
+    }
+
+private:
+    struct Edge {
+        Vec2d a;
+        Vec2d b;
+    };
+    struct Crossing {
+        size_t line_idx;
+        double x;
+        bool operator<(const Crossing &rhs) const { return line_idx < rhs.line_idx || (line_idx == rhs.line_idx && x < rhs.x); }
+    };
+
+    static void append_edges(std::vector<Edge> &edges, const Polygon &polygon)
+    {
+        for (size_t i = 0, j = polygon.points.size() - 1; i < polygon.points.size(); j = i ++)
+            edges.push_back({ polygon.points[j].cast<double>(), polygon.points[i].cast<double>() });
+    }
+    static void append_edges(std::vector<Edge> &edges, const Polygons &polygons)
+    {
+        for (const Polygon &polygon : polygons)
+            append_edges(edges, polygon);
+    }
+
+    // Rotate the edges by (s, c) and intersect them with the horizontal scan lines y = y0 + i * m_spacing, i < num_lines.
+    // Returns the crossings sorted by the scan line index and by the x coordinate.
+    std::vector<Crossing> crossings(const std::vector<Edge> &edges, double s, double c, double y0, size_t num_lines) const
+    {
+        std::vector<Crossing> out;
+        const double spacing = double(m_spacing);
+        for (const Edge &edge : edges) {
+            Vec2d a(c * edge.a.x() - s * edge.a.y(), c * edge.a.y() + s * edge.a.x());
+            Vec2d b(c * edge.b.x() - s * edge.b.y(), c * edge.b.y() + s * edge.b.x());
+            if (a.y() == b.y())
+                continue;
+            if (a.y() > b.y())
+                std::swap(a, b);
+            // Half open interval <a.y, b.y) to count a vertex shared by two edges just once.
+            double i_first = std::max(0., std::ceil((a.y() - y0) / spacing));
+            for (size_t i = size_t(i_first); i < num_lines; ++ i) {
+                double y = y0 + double(i) * spacing;
+                if (y >= b.y())
+                    break;
+                if (y >= a.y())
+                    out.push_back({ i, a.x() + (y - a.y()) * (b.x() - a.x()) / (b.y() - a.y()) });
+            }
+        }
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    const ExPolygons   &m_anchor_regions;
+    const coord_t       m_spacing;
+    std::vector<Edge>   m_clip_edges;
+    std::vector<Edge>   m_anchor_edges;
+};
+
 bool BridgeDetector::detect_angle(double bridge_direction_override)
 {
     if (this->_edges.empty() || this->_anchor_regions.empty()) 
@@ -95,55 +216,21 @@ bool BridgeDetector::detect_angle(double bridge_direction_override)
     /*  we'll now try several directions using a rudimentary visibility check:
         bridge in several directions and then sum the length of lines having both
         endpoints within anchors */
-        
-    bool have_coverage = false;
-    for (size_t i_angle = 0; i_angle < candidates.size(); ++ i_angle)
-    {
-        const double angle = candidates[i_angle].angle;
-
-        Lines lines;
-        {
-            // Get an oriented bounding box around _anchor_regions.
-            BoundingBox bbox = get_extents_rotated(this->_anchor_regions, - angle);
-            // Cover the region with line segments.
-            lines.reserve((bbox.max(1) - bbox.min(1) + this->spacing) / this->spacing);
-            double s = sin(angle);
-            double c = cos(angle);
-            //FIXME Vojtech: The lines shall be spaced half the line width from the edge, but then 
-            // some of the test cases fail. Need to adjust the test cases then?
-//            for (coord_t y = bbox.min(1) + this->spacing / 2; y <= bbox.max(1); y += this->spacing)
-            for (coord_t y = bbox.min(1); y <= bbox.max(1); y += this->spacing)
-                lines.push_back(Line(
-                    Point((coord_t)round(c * bbox.min(0) - s * y), (coord_t)round(c * y + s * bbox.min(0))),
-                    Point((coord_t)round(c * bbox.max(0) - s * y), (coord_t)round(c * y + s * bbox.max(0)))));
-        }
-
-        double total_length = 0;
-        double max_length = 0;
-        {
-            Lines clipped_lines = intersection_ln(lines, clip_area);
-            for (size_t i = 0; i < clipped_lines.size(); ++i) {
-                const Line &line = clipped_lines[i];
-                if (expolygons_contain(this->_anchor_regions, line.a) && expolygons_contain(this->_anchor_regions, line.b)) {
-                    // This line could be anchored.
-                    double len = line.length();
-                    total_length += len;
-                    max_length = std::max(max_length, len);
-                }
-            }        
+    // The clipping area and the anchors are indexed once, then all the candidate directions are evaluated in parallel.
+    BridgeAngleEvaluator evaluator(clip_area, this->_anchor_regions, this->spacing);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, candidates.size()),
+        [&candidates, &evaluator](const tbb::blocked_range<size_t> &range) {
+        for (size_t i_angle = range.begin(); i_angle < range.end(); ++ i_angle) {
+            BridgeDirection &candidate = candidates[i_angle];
+            // Sum length of bridged lines, max length of bridged lines.
+            evaluator.evaluate(candidate.angle, candidate.coverage, candidate.max_length);
+            /*  The following produces more correct results in some cases and more broken in others.
+                TODO: investigate, as it looks more reliable than line clipping. */
+            // $directions_coverage{$angle} = sum(map $_->area, @{$self->coverage($angle)}) // 0;
         }
-        if (total_length == 0.)
-            continue;
+    });
 
-        have_coverage = true;
-        // Sum length of bridged lines.
-        candidates[i_angle].coverage = total_length;
-        /*  The following produces more correct results in some cases and more broken in others.
-            TODO: investigate, as it looks more reliable than line clipping. */
-        // $directions_coverage{$angle} = sum(map $_->area, @{$self->coverage($angle)}) // 0;
-        // max length of bridged lines
-        candidates[i_angle].max_length = max_length;
-    }
+    bool have_coverage = std::any_of(candidates.begin(), candidates.end(), [](const BridgeDirection &c) { return c.coverage > 0.; });
 
     // if no direction produced coverage, then there's no bridge direction
     if (! have_coverage)
@@ -1,8 +1,12 @@
 #include <algorithm>
+#include <atomic>
 #include <vector>
 #include <float.h>
+#include <mutex>
 #include <unordered_map>
 
+#include <tbb/parallel_for.h>
+
 #if 0
 // #ifdef SLIC3R_GUI
 #include <wx/image.h>
@@ -145,180 +149,90 @@ void EdgeGrid::Grid::create_from_m_contours(coord_t resolution)
 	m_bbox.max(1) += eps;
 
 	// 2) Initialize the edge grid.
+	m_signed_distance_field.clear();
+	m_lazy_sdf.reset();
 	m_resolution = resolution;
 	m_cols = (m_bbox.max(0) - m_bbox.min(0) + m_resolution - 1) / m_resolution;
 	m_rows = (m_bbox.max(1) - m_bbox.min(1) + m_resolution - 1) / m_resolution;
 	m_cells.assign(m_rows * m_cols, Cell());
 
 	// 3) First round of contour rasterization, count the edges per grid cell.
-	for (size_t i = 0; i < m_contours.size(); ++ i) {
-		const Slic3r::Points &pts = *m_contours[i];
-		for (size_t j = 0; j < pts.size(); ++ j) {
-			// End points of the line segment.
-			Slic3r::Point p1(pts[j]);
-			Slic3r::Point p2 = pts[(j + 1 == pts.size()) ? 0 : j + 1];
-			p1(0) -= m_bbox.min(0);
-			p1(1) -= m_bbox.min(1);
-			p2(0) -= m_bbox.min(0);
-			p2(1) -= m_bbox.min(1);
-		   	// Get the cells of the end points.
-		    coord_t ix    = p1(0) / m_resolution;
-		    coord_t iy    = p1(1) / m_resolution;
-		    coord_t ixb   = p2(0) / m_resolution;
-		    coord_t iyb   = p2(1) / m_resolution;
-			assert(ix >= 0 && size_t(ix) < m_cols);
-			assert(iy >= 0 && size_t(iy) < m_rows);
-			assert(ixb >= 0 && size_t(ixb) < m_cols);
-			assert(iyb >= 0 && size_t(iyb) < m_rows);
-			// Account for the end points.
-			++ m_cells[iy*m_cols+ix].end;
-			if (ix == ixb && iy == iyb)
-				// Both ends fall into the same cell.
-				continue;
-		    // Raster the centeral part of the line.
-			coord_t dx = std::abs(p2(0) - p1(0));
-			coord_t dy = std::abs(p2(1) - p1(1));
-			if (p1(0) < p2(0)) {
-				int64_t ex = int64_t((ix + 1)*m_resolution - p1(0)) * int64_t(dy);
-				if (p1(1) < p2(1)) {
-					// x positive, y positive
-					int64_t ey = int64_t((iy + 1)*m_resolution - p1(1)) * int64_t(dx);
-					do {
-						assert(ix <= ixb && iy <= iyb);
-						if (ex < ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix += 1;
-						}
-						else if (ex == ey) {
-							ex = int64_t(dy) * m_resolution;
-							ey = int64_t(dx) * m_resolution;
-							ix += 1;
-							iy += 1;
-						}
-						else {
-							assert(ex > ey);
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy += 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
-				else {
-					// x positive, y non positive
-					int64_t ey = int64_t(p1(1) - iy*m_resolution) * int64_t(dx);
-					do {
-						assert(ix <= ixb && iy >= iyb);
-						if (ex <= ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix += 1;
-						}
-						else {
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy -= 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
+	// The contours are rasterized in parallel, the per cell counters are updated atomically.
+	std::vector<std::atomic<size_t>> cell_counters(m_cells.size());
+	{
+		struct Visitor {
+			Visitor(std::vector<std::atomic<size_t>> &counters, size_t cols) : counters(counters), cols(cols) {}
+			inline bool operator()(coord_t iy, coord_t ix) {
+				counters[iy * cols + ix].fetch_add(1, std::memory_order_relaxed);
+				// Continue traversing the grid along the edge.
+				return true;
 			}
-			else {
-				int64_t ex = int64_t(p1(0) - ix*m_resolution) * int64_t(dy);
-				if (p1(1) < p2(1)) {
-					// x non positive, y positive
-					int64_t ey = int64_t((iy + 1)*m_resolution - p1(1)) * int64_t(dx);
-					do {
-						assert(ix >= ixb && iy <= iyb);
-						if (ex < ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix -= 1;
-						}
-						else {
-							assert(ex >= ey);
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy += 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
+			std::vector<std::atomic<size_t>> &counters;
+			size_t							  cols;
+		};
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, m_contours.size()),
+			[this, &cell_counters](const tbb::blocked_range<size_t> &range) {
+				Visitor visitor(cell_counters, m_cols);
+				for (size_t i = range.begin(); i < range.end(); ++ i) {
+					const Slic3r::Points &pts = *m_contours[i];
+					for (size_t j = 0; j < pts.size(); ++ j)
+						this->visit_cells_intersecting_line(pts[j], pts[(j + 1 == pts.size()) ? 0 : j + 1], visitor);
 				}
-				else {
-					// x non positive, y non positive
-					int64_t ey = int64_t(p1(1) - iy*m_resolution) * int64_t(dx);
-					do {
-						assert(ix >= ixb && iy >= iyb);
-						if (ex < ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix -= 1;
-						}
-						else if (ex == ey) {
-							// The lower edge of a grid cell belongs to the cell.
-							// Handle the case where the ray may cross the lower left corner of a cell in a general case,
-							// or a left or lower edge in a degenerate case (horizontal or vertical line).
-							if (dx > 0) {
-								ex = int64_t(dy) * m_resolution;
-								ix -= 1;
-							}
-							if (dy > 0) {
-								ey = int64_t(dx) * m_resolution;
-								iy -= 1;
-							}
-						}
-						else {
-							assert(ex > ey);
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy -= 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
-			}
-		}
+			});
 	}
 
 	// 4) Prefix sum the numbers of hits per cells to get an index into m_cell_data.
-	size_t cnt = m_cells.front().end;
-	for (size_t i = 1; i < m_cells.size(); ++ i) {
+	size_t cnt = 0;
+	for (size_t i = 0; i < m_cells.size(); ++ i) {
 		m_cells[i].begin = cnt;
-		cnt += m_cells[i].end;
+		cnt += cell_counters[i].load(std::memory_order_relaxed);
 		m_cells[i].end = cnt;
+		// Reuse the counters as insertion cursors into m_cell_data.
+		cell_counters[i].store(m_cells[i].begin, std::memory_order_relaxed);
 	}
 
 	// 5) Allocate the cell data.
 	m_cell_data.assign(cnt, std::pair<size_t, size_t>(size_t(-1), size_t(-1)));
 
 	// 6) Finally fill in m_cell_data by rasterizing the lines once again.
-	for (size_t i = 0; i < m_cells.size(); ++i)
-		m_cells[i].end = m_cells[i].begin;
-
-	struct Visitor {
-		Visitor(std::vector<std::pair<size_t, size_t>> &cell_data, std::vector<Cell> &cells, size_t cols) :
-			cell_data(cell_data), cells(cells), cols(cols), i(0), j(0) {}
-
-		inline bool operator()(coord_t iy, coord_t ix) {
-			cell_data[cells[iy*cols + ix].end++] = std::pair<size_t, size_t>(i, j);
-			// Continue traversing the grid along the edge.
-			return true;
-		}
+	{
+		struct Visitor {
+			Visitor(std::vector<std::pair<size_t, size_t>> &cell_data, std::vector<std::atomic<size_t>> &cursors, size_t cols) :
+				cell_data(cell_data), cursors(cursors), cols(cols), i(0), j(0) {}
+
+			inline bool operator()(coord_t iy, coord_t ix) {
+				cell_data[cursors[iy * cols + ix].fetch_add(1, std::memory_order_relaxed)] = std::pair<size_t, size_t>(i, j);
+				// Continue traversing the grid along the edge.
+				return true;
+			}
 
-		std::vector<std::pair<size_t, size_t>> &cell_data;
-		std::vector<Cell> 					   &cells;
-		size_t									cols;
-		size_t 									i;
-		size_t 									j;
-	} visitor(m_cell_data, m_cells, m_cols);
-
-	assert(visitor.i == 0);
-	for (; visitor.i < m_contours.size(); ++ visitor.i) {
-		const Slic3r::Points &pts = *m_contours[visitor.i];
-		for (visitor.j = 0; visitor.j < pts.size(); ++ visitor.j)
-			this->visit_cells_intersecting_line(pts[visitor.j], pts[(visitor.j + 1 == pts.size()) ? 0 : visitor.j + 1], visitor);
+			std::vector<std::pair<size_t, size_t>> &cell_data;
+			std::vector<std::atomic<size_t>>	   &cursors;
+			size_t									cols;
+			size_t 									i;
+			size_t 									j;
+		};
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, m_contours.size()),
+			[this, &cell_counters](const tbb::blocked_range<size_t> &range) {
+				Visitor visitor(m_cell_data, cell_counters, m_cols);
+				for (visitor.i = range.begin(); visitor.i < range.end(); ++ visitor.i) {
+					const Slic3r::Points &pts = *m_contours[visitor.i];
+					for (visitor.j = 0; visitor.j < pts.size(); ++ visitor.j)
+						this->visit_cells_intersecting_line(pts[visitor.j], pts[(visitor.j + 1 == pts.size()) ? 0 : visitor.j + 1], visitor);
+				}
+			});
 	}
+
+	// 7) Sort the edges of each cell by the contour and edge index, so that the cell data are ordered the same way
+	// as if the contours were rasterized sequentially. This keeps the grid queries deterministic.
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, m_cells.size()),
+		[this](const tbb::blocked_range<size_t> &range) {
+			for (size_t i = range.begin(); i < range.end(); ++ i) {
+				const Cell &cell = m_cells[i];
+				if (cell.end - cell.begin > 1)
+					std::sort(m_cell_data.begin() + cell.begin, m_cell_data.begin() + cell.end);
+			}
+		});
 }
 
 #if 0
@@ -659,6 +573,7 @@ struct PropagateDanielssonSingleVStep3 {
 
 void EdgeGrid::Grid::calculate_sdf()
 {
+	m_lazy_sdf.reset();
 	// 1) Initialize a signum and an unsigned vector to a zero iso surface.
 	size_t nrows = m_rows + 1;
 	size_t ncols = m_cols + 1;
@@ -976,6 +891,69 @@ void EdgeGrid::Grid::calculate_sdf()
 #endif /* SLIC3R_GUI */
 }
 
+struct EdgeGrid::Grid::LazySDF
+{
+	// Number of grid nodes along a side of a tile.
+	static constexpr size_t 				tile_size = 16;
+	size_t 									tile_cols = 0;
+	// Signed distance values at the grid nodes, (m_rows + 1) x (m_cols + 1).
+	std::vector<float> 						nodes;
+	// Was a tile evaluated already?
+	std::unique_ptr<std::atomic<bool>[]> 	tile_valid;
+	std::mutex 								mutex;
+};
+
+void EdgeGrid::Grid::enable_lazy_sdf()
+{
+	size_t nrows = m_rows + 1;
+	size_t ncols = m_cols + 1;
+	m_signed_distance_field.clear();
+	m_lazy_sdf = std::make_shared<LazySDF>();
+	m_lazy_sdf->tile_cols  = (ncols + LazySDF::tile_size - 1) / LazySDF::tile_size;
+	size_t num_tiles       = m_lazy_sdf->tile_cols * ((nrows + LazySDF::tile_size - 1) / LazySDF::tile_size);
+	m_lazy_sdf->nodes.assign(nrows * ncols, 0.f);
+	m_lazy_sdf->tile_valid.reset(new std::atomic<bool>[num_tiles]);
+	for (size_t i = 0; i < num_tiles; ++ i)
+		m_lazy_sdf->tile_valid[i].store(false, std::memory_order_relaxed);
+}
+
+float EdgeGrid::Grid::lazy_sdf_value(size_t row, size_t col) const
+{
+	assert(m_lazy_sdf);
+	LazySDF &sdf  = *m_lazy_sdf;
+	size_t 	 ncols = m_cols + 1;
+	size_t 	 tile  = (row / LazySDF::tile_size) * sdf.tile_cols + col / LazySDF::tile_size;
+	if (! sdf.tile_valid[tile].load(std::memory_order_acquire)) {
+		std::lock_guard<std::mutex> lock(sdf.mutex);
+		if (! sdf.tile_valid[tile].load(std::memory_order_relaxed)) {
+			// Evaluate all nodes of the tile by searching for the closest edge in an expanding neighborhood.
+			const coord_t max_radius = coord_t(m_bbox.size().cast<double>().norm()) + 2 * m_resolution;
+			size_t row0 = (row / LazySDF::tile_size) * LazySDF::tile_size;
+			size_t col0 = (col / LazySDF::tile_size) * LazySDF::tile_size;
+			size_t row1 = std::min(row0 + LazySDF::tile_size, m_rows + 1);
+			size_t col1 = std::min(col0 + LazySDF::tile_size, ncols);
+			for (size_t r = row0; r < row1; ++ r)
+				for (size_t c = col0; c < col1; ++ c) {
+					Point  pt(m_bbox.min(0) + coord_t(c) * m_resolution, m_bbox.min(1) + coord_t(r) * m_resolution);
+					float  d = float(max_radius);
+					for (coord_t radius = 2 * m_resolution;; radius *= 2) {
+						ClosestPointResult cp = this->closest_point(pt, radius);
+						if (cp.valid()) {
+							d = float(cp.distance);
+							break;
+						}
+						if (radius >= max_radius)
+							// No contour at all.
+							break;
+					}
+					sdf.nodes[r * ncols + c] = d;
+				}
+			sdf.tile_valid[tile].store(true, std::memory_order_release);
+		}
+	}
+	return sdf.nodes[row * ncols + col];
+}
+
 float EdgeGrid::Grid::signed_distance_bilinear(const Point &pt) const
 {
 	coord_t x = pt(0) - m_bbox.min(0);
@@ -1006,12 +984,20 @@ float EdgeGrid::Grid::signed_distance_bilinear(const Point &pt) const
 	assert(tx >= -1e-5 && tx < 1.f + 1e-5);
 	float   ty = float(ycl - cell_r * m_resolution) / float(m_resolution);
 	assert(ty >= -1e-5 && ty < 1.f + 1e-5);
-	size_t  addr = cell_r * (m_cols + 1) + cell_c;
-	float   f00 = m_signed_distance_field[addr];
-	float   f01 = m_signed_distance_field[addr+1];
-	addr += m_cols + 1;
-	float   f10 = m_signed_distance_field[addr];
-	float   f11 = m_signed_distance_field[addr+1];
+	float   f00, f01, f10, f11;
+	if (m_signed_distance_field.empty()) {
+		f00 = this->lazy_sdf_value(cell_r, cell_c);
+		f01 = this->lazy_sdf_value(cell_r, cell_c + 1);
+		f10 = this->lazy_sdf_value(cell_r + 1, cell_c);
+		f11 = this->lazy_sdf_value(cell_r + 1, cell_c + 1);
+	} else {
+		size_t addr = cell_r * (m_cols + 1) + cell_c;
+		f00 = m_signed_distance_field[addr];
+		f01 = m_signed_distance_field[addr+1];
+		addr += m_cols + 1;
+		f10 = m_signed_distance_field[addr];
+		f11 = m_signed_distance_field[addr+1];
+	}
 	float   f0  = (1.f - tx) * f00 + tx * f01;
 	float   f1  = (1.f - tx) * f10 + tx * f11;
 	float	f   = (1.f - ty) * f0 + ty * f1;
@@ -1269,7 +1255,7 @@ bool EdgeGrid::Grid::signed_distance(const Point &pt, coord_t search_radius, coo
 {
 	if (signed_distance_edges(pt, search_radius, result_min_dist))
 		return true;
-	if (m_signed_distance_field.empty())
+	if (m_signed_distance_field.empty() && ! m_lazy_sdf)
 		return false;
 	result_min_dist = signed_distance_bilinear(pt);
 	return true;
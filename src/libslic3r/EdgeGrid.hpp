@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <math.h>
+#include <memory>
 
 #include "Point.hpp"
 #include "BoundingBox.hpp"
@@ -45,7 +46,12 @@ public:
 	// The rough SDF is used by signed_distance() for distances outside of the search_radius.
 	void calculate_sdf();
 
-	// Return an estimate of the signed distance based on m_signed_distance_field grid.
+	// Instead of calculate_sdf(), let the signed distance field be calculated on demand in tiles of grid nodes
+	// the first time signed_distance() does not find an edge in its search radius. The nodes of a lazy tile store exact
+	// signed distances to the closest edge. Tiles are evaluated thread safely, so the grid may be queried from multiple threads.
+	void enable_lazy_sdf();
+
+	// Return an estimate of the signed distance based on m_signed_distance_field grid or on the lazily evaluated tiles.
 	float signed_distance_bilinear(const Point &pt) const;
 
 	// Calculate a signed distance to the contours in search_radius from the point.
@@ -286,6 +292,11 @@ protected:
 	// Distance field derived from the edge grid, seed filled by the Danielsson chamfer metric.
 	// May be empty.
 	std::vector<float>							m_signed_distance_field;
+
+	// Signed distance field evaluated on demand, see enable_lazy_sdf(). Shared by the copies of this grid.
+	struct LazySDF;
+	std::shared_ptr<LazySDF>					m_lazy_sdf;
+	float 										lazy_sdf_value(size_t row, size_t col) const;
 };
 
 #if 0
@@ -327,4 +327,12 @@ std::string ExtrusionEntity::role_to_string(ExtrusionRole role)
     return "";
 }
 
+ExtrusionRole ExtrusionEntity::string_to_role(const std::string_view role)
+{
+    for (int i = erNone; i < erCount; ++ i)
+        if (role == role_to_string(ExtrusionRole(i)))
+            return ExtrusionRole(i);
+    return erNone;
+}
+
 }
@@ -6,6 +6,7 @@
 #include "Polyline.hpp"
 
 #include <assert.h>
+#include <string_view>
 
 namespace Slic3r {
 
@@ -106,6 +107,8 @@ public:
     virtual double total_volume() const = 0;
 
     static std::string role_to_string(ExtrusionRole role);
+    // Inverse of role_to_string(), returns erNone for an unknown string.
+    static ExtrusionRole string_to_role(const std::string_view role);
 };
 
 typedef std::vector<ExtrusionEntity*> ExtrusionEntitiesPtr;
@@ -218,11 +221,25 @@ public:
     double total_volume() const override { double volume =0.; for (const auto& path : paths) volume += path.total_volume(); return volume; }
 };
 
+// Penalty of placing a seam at a loop vertex, independent of the position the loop is approached from.
+struct SeamPenalty {
+    // Penalty for a visible seam, depending on the angle at the vertex.
+    float visibility = 0.f;
+    // Penalty for a seam over an overhang of the lower layer.
+    float overhang   = 0.f;
+};
+
 // Single continuous extrusion loop, possibly with varying extrusion thickness, extrusion height or bridging / non bridging.
 class ExtrusionLoop : public ExtrusionEntity
 {
 public:
     ExtrusionPaths paths;
+    // Seam penalties at the vertices of the counter clockwise oriented polygon(), calculated by PrintObject::make_seams().
+    // Empty if not calculated, then the penalties are evaluated during G-code export.
+    std::vector<SeamPenalty> seam_penalties;
+    // Nozzle diameter the seam penalties were calculated for. If the loop is printed with another nozzle,
+    // for example when wiping into the object, the penalties are evaluated during G-code export.
+    float                    seam_penalties_nozzle_dmr = 0.f;
     
     ExtrusionLoop(ExtrusionLoopRole role = elrDefault) : m_loop_role(role) {}
     ExtrusionLoop(const ExtrusionPaths &paths, ExtrusionLoopRole role = elrDefault) : paths(paths), m_loop_role(role) {}
@@ -153,13 +153,32 @@ void SL1Archive::export_print(Zipper& zipper,
         zipper.add_entry("prusaslicer.ini");
         zipper << to_ini(slicerconf);
         
-        size_t i = 0;
-        for (const sla::EncodedRaster &rst : m_layers) {
-
-            std::string imgname = project + string_printf("%.5d", i++) + "." +
+        auto add_layer = [&zipper, &project](const sla::EncodedRaster &rst, size_t i) {
+            std::string imgname = project + string_printf("%.5d", i) + "." +
                                   rst.extension();
             
             zipper.add_entry(imgname.c_str(), rst.data(), rst.size());
+        };
+        
+        if (is_streaming()) {
+            // Rasterize the layers now and write each one into the archive
+            // as soon as it is encoded.
+            const std::vector<SLAPrint::PrintLayer> &layers = print.print_layers();
+            draw_layers(layers.size(),
+                        [&layers](sla::RasterBase &raster, size_t idx) {
+                            raster.draw(layers[idx].transformed_slices());
+                        },
+                        [&layers](size_t idx) {
+                            return layers[idx].same_slices(layers[idx - 1]);
+                        },
+                        [&add_layer](sla::EncodedRaster &&rst, size_t idx) {
+                            add_layer(rst, idx);
+                        },
+                        m_streaming_window);
+        } else {
+            size_t i = 0;
+            for (const sla::EncodedRaster &rst : m_layers)
+                add_layer(rst, i++);
         }
     } catch(std::exception& e) {
         BOOST_LOG_TRIVIAL(error) << e.what();
@@ -5,6 +5,7 @@
 #include "EdgeGrid.hpp"
 #include "Geometry.hpp"
 #include "GCode/PrintExtents.hpp"
+#include "GCode/SeamPlacer.hpp"
 #include "GCode/WipeTower.hpp"
 #include "ShortestPath.hpp"
 #include "Print.hpp"
@@ -30,6 +31,7 @@
 #include "SVG.hpp"
 
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
 
 #include <Shiny/Shiny.h>
 
@@ -291,7 +293,7 @@ std::string WipeTowerIntegration::append_tcr(GCode &gcodegen, const WipeTower::T
     std::string gcode;
 
     // Toolchangeresult.gcode assumes the wipe tower corner is at the origin (except for priming lines)
-    // We want to rotate and shift all extrusions (gcode postprocessing) and starting and ending position
+    // We want to rotate and shift all extrusions (when appending the gcode) and starting and ending position
     float alpha = m_wipe_tower_rotation/180.f * float(M_PI);
     Vec2f start_pos = tcr.start_pos;
     Vec2f end_pos = tcr.end_pos;
@@ -302,11 +304,6 @@ std::string WipeTowerIntegration::append_tcr(GCode &gcodegen, const WipeTower::T
         end_pos += m_wipe_tower_pos;
     }
 
-    Vec2f wipe_tower_offset = tcr.priming ? Vec2f::Zero() : m_wipe_tower_pos;
-    float wipe_tower_rotation = tcr.priming ? 0.f : alpha;
-
-    std::string tcr_rotated_gcode = post_process_wipe_tower_moves(tcr, wipe_tower_offset, wipe_tower_rotation);
-
     if (!tcr.priming) {
         // Move over the wipe tower.
         // Retract for a tool change, using the toolchange retract value and setting the priming extra length.
@@ -380,15 +377,16 @@ std::string WipeTowerIntegration::append_tcr(GCode &gcodegen, const WipeTower::T
         check_add_eol(start_filament_gcode_str);
     }
 
-    // Insert the end filament, toolchange, and start filament gcode into the generated gcode.
-    DynamicConfig config;
-    config.set_key_value("end_filament_gcode",   new ConfigOptionString(end_filament_gcode_str));
-    config.set_key_value("toolchange_gcode",     new ConfigOptionString(toolchange_gcode_str));
-    config.set_key_value("start_filament_gcode", new ConfigOptionString(start_filament_gcode_str));
-    std::string tcr_gcode, tcr_escaped_gcode = gcodegen.placeholder_parser_process("tcr_rotated_gcode", tcr_rotated_gcode, new_extruder_id, &config);
-    unescape_string_cstyle(tcr_escaped_gcode, tcr_gcode);
-    gcode += tcr_gcode;
-    check_add_eol(toolchange_gcode_str);
+    if (gcodegen.config().gcode_comments) {
+        // names the feature type of the wipe tower gcode
+        gcode += ";" + GCodeAnalyzer::Feature_Type_Tag + ExtrusionEntity::role_to_string(erWipeTower) + "\n";
+        gcodegen.m_last_feature_type = erWipeTower;
+    }
+
+    // Insert the wipe tower gcode with the end filament, toolchange, and start filament gcode into the generated gcode.
+    Vec2f wipe_tower_offset = tcr.priming ? Vec2f::Zero() : m_wipe_tower_pos;
+    float wipe_tower_rotation = tcr.priming ? 0.f : alpha;
+    append_wipe_tower_gcode(gcode, tcr, wipe_tower_offset, wipe_tower_rotation, end_filament_gcode_str, toolchange_gcode_str, start_filament_gcode_str);
 
 
     // A phony move to the end position at the wipe tower.
@@ -418,78 +416,59 @@ std::string WipeTowerIntegration::append_tcr(GCode &gcodegen, const WipeTower::T
     return gcode;
 }
 
-// This function postprocesses gcode_original, rotates and moves all G1 extrusions and returns resulting gcode
-// Starting position has to be supplied explicitely (otherwise it would fail in case first G1 command only contained one coordinate)
-std::string WipeTowerIntegration::post_process_wipe_tower_moves(const WipeTower::ToolChangeResult& tcr, const Vec2f& translation, float angle) const
+// This function appends the wipe tower gcode of tcr, rotates and moves all G1 moves and inserts the custom gcodes.
+// The moves are transformed at the positions recorded by the wipe tower generator, the gcode is not parsed.
+void WipeTowerIntegration::append_wipe_tower_gcode(std::string &gcode, const WipeTower::ToolChangeResult &tcr, const Vec2f &translation, float angle,
+    const std::string &end_filament_gcode, const std::string &toolchange_gcode, const std::string &start_filament_gcode) const
 {
-    Vec2f extruder_offset = m_extruder_offsets[tcr.initial_tool].cast<float>();
-
-    std::istringstream gcode_str(tcr.gcode);
-    std::string gcode_out;
-    std::string line;
-    Vec2f pos = tcr.start_pos;
-    Vec2f transformed_pos = pos;
-    Vec2f old_pos(-1000.1f, -1000.1f);
-
-    while (gcode_str) {
-        std::getline(gcode_str, line);  // we read the gcode line by line
-
-        // All G1 commands should be translated and rotated. X and Y coords are
-        // only pushed to the output when they differ from last time.
-        // WT generator can override this by appending the never_skip_tag
-        if (line.find("G1 ") == 0) {
-            bool never_skip = false;
-            auto it = line.find(WipeTower::never_skip_tag());
-            if (it != std::string::npos) {
-                // remove the tag and remember we saw it
-                never_skip = true;
-                line.erase(it, it+WipeTower::never_skip_tag().size());
-            }
-            std::ostringstream line_out;
-            std::istringstream line_str(line);
-            line_str >> std::noskipws;  // don't skip whitespace
-            char ch = 0;
-            while (line_str >> ch) {
-                if (ch == 'X' || ch =='Y')
-                    line_str >> (ch == 'X' ? pos.x() : pos.y());
-                else
-                    line_out << ch;
-            }
-
-            transformed_pos = Eigen::Rotation2Df(angle) * pos + translation;
-
-            if (transformed_pos != old_pos || never_skip) {
-                line = line_out.str();
-                std::ostringstream oss;
-                oss << std::fixed << std::setprecision(3) << "G1 ";
-                if (transformed_pos.x() != old_pos.x() || never_skip)
-                    oss << " X" << transformed_pos.x() - extruder_offset.x();
-                if (transformed_pos.y() != old_pos.y() || never_skip)
-                    oss << " Y" << transformed_pos.y() - extruder_offset.y();
-                oss << " ";
-                line.replace(line.find("G1 "), 3, oss.str());
-                old_pos = transformed_pos;
-            }
+    const Vec2f              initial_extruder_offset = m_extruder_offsets[tcr.initial_tool].cast<float>();
+    Vec2f                    extruder_offset         = initial_extruder_offset;
+    const Eigen::Rotation2Df rotation(angle);
+    Vec2f                    transformed_pos         = rotation * tcr.start_pos + translation;
+    // X and Y coordinates are only pushed to the output when they differ from last time.
+    Vec2f                    old_pos(-1000.1f, -1000.1f);
+    GCodeFormatter           out(gcode);
+
+    gcode.reserve(gcode.size() + tcr.gcode.size() + 24 * tcr.gcode_inserts.size() + end_filament_gcode.size() + toolchange_gcode.size() + start_filament_gcode.size());
+    size_t last = 0;
+    for (const WipeTower::GCodeInsert &insert : tcr.gcode_inserts) {
+        assert(insert.pos >= last && insert.pos <= tcr.gcode.size());
+        gcode.append(tcr.gcode, last, insert.pos - last);
+        last = insert.pos;
+        switch (insert.type) {
+        case WipeTower::GCodeInsert::MoveXY:
+        case WipeTower::GCodeInsert::MoveXYNeverSkip:
+        {
+            bool never_skip = insert.type == WipeTower::GCodeInsert::MoveXYNeverSkip;
+            transformed_pos = rotation * insert.xy + translation;
+            if (transformed_pos.x() != old_pos.x() || never_skip)
+                out.emit_axis("X", transformed_pos.x() - extruder_offset.x(), 3);
+            if (transformed_pos.y() != old_pos.y() || never_skip)
+                out.emit_axis("Y", transformed_pos.y() - extruder_offset.y(), 3);
+            old_pos = transformed_pos;
+            break;
         }
-
-        gcode_out += line + "\n";
-
-        // If this was a toolchange command, we should change current extruder offset
-        if (line == "[toolchange_gcode]") {
+        case WipeTower::GCodeInsert::EndFilamentGCode:
+            gcode += end_filament_gcode;
+            break;
+        case WipeTower::GCodeInsert::ToolChangeGCode:
+            gcode += toolchange_gcode;
+            // After the toolchange, we should change current extruder offset.
             extruder_offset = m_extruder_offsets[tcr.new_tool].cast<float>();
-
-            // If the extruder offset changed, add an extra move so everything is continuous
-            if (extruder_offset != m_extruder_offsets[tcr.initial_tool].cast<float>()) {
-                std::ostringstream oss;
-                oss << std::fixed << std::setprecision(3)
-                    << "G1 X" << transformed_pos.x() - extruder_offset.x()
-                    << " Y"   << transformed_pos.y() - extruder_offset.y()
-                    << "\n";
-                gcode_out += oss.str();
+            // If the extruder offset changed, add an extra move so everything is continuous.
+            if (extruder_offset != initial_extruder_offset) {
+                out.emit("G1")
+                   .emit_axis("X", transformed_pos.x() - extruder_offset.x(), 3)
+                   .emit_axis("Y", transformed_pos.y() - extruder_offset.y(), 3)
+                   .emit_eol();
             }
+            break;
+        case WipeTower::GCodeInsert::StartFilamentGCode:
+            gcode += start_filament_gcode;
+            break;
         }
     }
-    return gcode_out;
+    gcode.append(tcr.gcode, last, std::string::npos);
 }
 
 
@@ -1113,6 +1092,119 @@ std::vector<const PrintInstance*> sort_object_instances_by_model_order(const Pri
     return instances;
 }
 
+GCodeFileStatistics analyze_gcode_file(const std::string &path, const PrintConfig &config)
+{
+    GCodeTimeEstimator normal_time_estimator(GCodeTimeEstimator::Normal);
+    GCodeTimeEstimator silent_time_estimator(GCodeTimeEstimator::Silent);
+    bool               silent_time_estimator_enabled = false;
+    GCodeAnalyzer      analyzer;
+    DoExport::init_time_estimators(config, normal_time_estimator, silent_time_estimator, silent_time_estimator_enabled);
+    DoExport::init_gcode_analyzer(config, analyzer);
+
+    boost::system::error_code ec;
+    if (! boost::filesystem::is_regular_file(boost::filesystem::path(path), ec))
+        throw std::runtime_error(std::string("G-code analysis failed.\nCannot open file for reading: ") + path);
+    MappedGCodeFile mapped(path);
+
+    GCodeFileStatistics       stats;
+    stats.file_size = mapped.size();
+    std::map<float, GCodeFileStatistics::Extrusion> layers;
+    auto collect_moves = [&stats, &layers](const GCodeAnalyzer::TypeToMovesMap &moves_map) {
+        for (const auto &type_moves : moves_map)
+            for (const GCodeAnalyzer::GCodeMove &move : type_moves.second) {
+                if (move.data.extruder_id >= stats.filaments.size())
+                    stats.filaments.resize(move.data.extruder_id + 1);
+                stats.filaments[move.data.extruder_id].length_mm += move.delta_extruder;
+                double length = (move.end_position - move.start_position).norm();
+                // The analyzer reports the extrusions of an exported G-code as moves, because the extrusion width tags are stripped on export.
+                // Their extrusion roles are named by the feature type comments, which are kept if exported with gcode_comments.
+                if (type_moves.first == GCodeAnalyzer::GCodeMove::Extrude || (type_moves.first == GCodeAnalyzer::GCodeMove::Move && move.delta_extruder > 0.f)) {
+                    GCodeFileStatistics::Extrusion &role  = stats.extrusion_roles[move.data.extrusion_role];
+                    GCodeFileStatistics::Extrusion &layer = layers[move.end_position.z()];
+                    role.filament_mm  += move.delta_extruder;
+                    role.length_mm    += length;
+                    layer.filament_mm += move.delta_extruder;
+                    layer.length_mm   += length;
+                } else if (type_moves.first == GCodeAnalyzer::GCodeMove::Move)
+                    stats.travel_length_mm += length;
+                else if (type_moves.first == GCodeAnalyzer::GCodeMove::Tool_change)
+                    ++ stats.tool_changes;
+            }
+    };
+
+    // The analyzer and the time estimators are independent, each of them parses the memory mapped G-code in place.
+    // The analyzer is fed by chunks of whole lines, so that its moves are not held in memory at once.
+    tbb::parallel_invoke(
+        [&analyzer, &mapped, &collect_moves]() {
+            std::vector<const char*> chunks = mapped.split_lines(4 * 1024 * 1024);
+            for (size_t i = 0; i + 1 < chunks.size(); ++ i) {
+                analyzer.process_gcode(chunks[i], chunks[i + 1]);
+                collect_moves(analyzer.moves_map());
+                analyzer.clear_moves();
+            }
+        },
+        [&normal_time_estimator, &mapped]() { normal_time_estimator.add_gcode_block(mapped.begin(), mapped.end()); },
+        [&silent_time_estimator, silent_time_estimator_enabled, &mapped]() { if (silent_time_estimator_enabled) silent_time_estimator.add_gcode_block(mapped.begin(), mapped.end()); });
+
+    normal_time_estimator.calculate_time(false);
+    stats.normal_time      = normal_time_estimator.get_time();
+    stats.normal_time_dhms = normal_time_estimator.get_time_dhms();
+    if (silent_time_estimator_enabled) {
+        silent_time_estimator.calculate_time(false);
+        stats.has_silent_time  = true;
+        stats.silent_time      = silent_time_estimator.get_time();
+        stats.silent_time_dhms = silent_time_estimator.get_time_dhms();
+    }
+    for (size_t extruder_id = 0; extruder_id < stats.filaments.size(); ++ extruder_id) {
+        GCodeFileStatistics::Filament &filament = stats.filaments[extruder_id];
+        double diameter     = config.filament_diameter.get_at(extruder_id);
+        filament.volume_mm3 = filament.length_mm * 0.25 * PI * diameter * diameter;
+        // filament_density is in g/cm^3
+        filament.weight_g   = filament.volume_mm3 * 0.001 * config.filament_density.get_at(extruder_id);
+    }
+    stats.layers.reserve(layers.size());
+    for (const auto &z_layer : layers)
+        stats.layers.push_back({ z_layer.second, z_layer.first });
+    return stats;
+}
+
+std::string GCodeFileStatistics::to_json() const
+{
+    std::string out;
+    char        buf[256];
+    auto extrusion = [&buf](const Extrusion &extrusion) {
+        sprintf(buf, "\"filament_mm\": %.3f, \"length_mm\": %.3f", extrusion.filament_mm, extrusion.length_mm);
+        return std::string(buf);
+    };
+    sprintf(buf, "{\n  \"file_size\": %zu,\n  \"estimated_printing_time\": {\n    \"normal_mode\": { \"seconds\": %.3f, \"dhms\": \"%s\" }",
+        this->file_size, this->normal_time, this->normal_time_dhms.c_str());
+    out += buf;
+    if (this->has_silent_time) {
+        sprintf(buf, ",\n    \"silent_mode\": { \"seconds\": %.3f, \"dhms\": \"%s\" }", this->silent_time, this->silent_time_dhms.c_str());
+        out += buf;
+    }
+    out += "\n  },\n  \"filaments\": [";
+    for (size_t i = 0; i < this->filaments.size(); ++ i) {
+        sprintf(buf, "%s\n    { \"extruder\": %zu, \"length_mm\": %.3f, \"volume_mm3\": %.3f, \"weight_g\": %.3f }",
+            i == 0 ? "" : ",", i, this->filaments[i].length_mm, this->filaments[i].volume_mm3, this->filaments[i].weight_g);
+        out += buf;
+    }
+    out += "\n  ],\n  \"extrusion_roles\": [";
+    for (auto it = this->extrusion_roles.begin(); it != this->extrusion_roles.end(); ++ it) {
+        out += (it == this->extrusion_roles.begin()) ? "\n    { \"role\": \"" : ",\n    { \"role\": \"";
+        out += ExtrusionEntity::role_to_string(it->first) + "\", " + extrusion(it->second) + " }";
+    }
+    sprintf(buf, "\n  ],\n  \"travel_length_mm\": %.3f,\n  \"tool_changes\": %zu,\n  \"layers\": [", this->travel_length_mm, this->tool_changes);
+    out += buf;
+    for (size_t i = 0; i < this->layers.size(); ++ i) {
+        sprintf(buf, "%s\n    { \"z\": %.3f, ", i == 0 ? "" : ",", this->layers[i].z);
+        out += buf;
+        out += extrusion(this->layers[i]) + " }";
+    }
+    out += "\n  ]\n}\n";
+    return out;
+}
+
 void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thumbnail_cb)
 {
     PROFILE_FUNC();
@@ -1308,6 +1400,11 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
     if (m_enable_analyzer)
         // adds tag for analyzer
         _write_format(file, ";%s%d\n", GCodeAnalyzer::Extrusion_Role_Tag.c_str(), erCustom);
+    if (m_config.gcode_comments) {
+        // names the feature type of the custom gcode
+        _write_format(file, ";%s%s\n", GCodeAnalyzer::Feature_Type_Tag.c_str(), ExtrusionEntity::role_to_string(erCustom).c_str());
+        m_last_feature_type = erCustom;
+    }
 
     // Write the custom start G-code
     _writeln(file, start_gcode);
@@ -1461,6 +1558,11 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
     if (m_enable_analyzer)
         // adds tag for analyzer
         _write_format(file, ";%s%d\n", GCodeAnalyzer::Extrusion_Role_Tag.c_str(), erCustom);
+    if (m_config.gcode_comments) {
+        // names the feature type of the custom gcode
+        _write_format(file, ";%s%s\n", GCodeAnalyzer::Feature_Type_Tag.c_str(), ExtrusionEntity::role_to_string(erCustom).c_str());
+        m_last_feature_type = erCustom;
+    }
 
     // Process filament-specific gcode in extruder order.
     {
@@ -1495,9 +1597,12 @@ void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thu
     print.throw_if_canceled();
 
     // calculates estimated printing time
-    m_normal_time_estimator.calculate_time(false);
     if (m_silent_time_estimator_enabled)
-        m_silent_time_estimator.calculate_time(false);
+        tbb::parallel_invoke(
+            [this]() { m_normal_time_estimator.calculate_time(false); },
+            [this]() { m_silent_time_estimator.calculate_time(false); });
+    else
+        m_normal_time_estimator.calculate_time(false);
 
     // Get filament stats.
     _write(file, DoExport::update_print_stats_and_format_filament_stats(
@@ -2161,7 +2266,7 @@ void GCode::process_layer(
     } // for objects
 
     // Extrude the skirt, brim, support, perimeters, infill ordered by the extruders.
-    std::vector<std::unique_ptr<EdgeGrid::Grid>> lower_layer_edge_grids(layers.size());
+    std::vector<std::shared_ptr<const EdgeGrid::Grid>> lower_layer_edge_grids(layers.size());
     for (unsigned int extruder_id : layer_tools.extruders)
     {
         gcode += (layer_tools.has_wipe_tower && m_wipe_tower) ?
@@ -2384,47 +2489,6 @@ std::string GCode::change_layer(coordf_t print_z)
     return gcode;
 }
 
-// Return a value in <0, 1> of a cubic B-spline kernel centered around zero.
-// The B-spline is re-scaled so it has value 1 at zero.
-static inline float bspline_kernel(float x)
-{
-    x = std::abs(x);
-	if (x < 1.f) {
-		return 1.f - (3.f / 2.f) * x * x + (3.f / 4.f) * x * x * x;
-	}
-	else if (x < 2.f) {
-		x -= 1.f;
-		float x2 = x * x;
-		float x3 = x2 * x;
-		return (1.f / 4.f) - (3.f / 4.f) * x + (3.f / 4.f) * x2 - (1.f / 4.f) * x3;
-	}
-	else
-        return 0;
-}
-
-static float extrudate_overlap_penalty(float nozzle_r, float weight_zero, float overlap_distance)
-{
-    // The extrudate is not fully supported by the lower layer. Fit a polynomial penalty curve.
-    // Solved by sympy package:
-/*
-from sympy import *
-(x,a,b,c,d,r,z)=symbols('x a b c d r z')
-p = a + b*x + c*x*x + d*x*x*x
-p2 = p.subs(solve([p.subs(x, -r), p.diff(x).subs(x, -r), p.diff(x,x).subs(x, -r), p.subs(x, 0)-z], [a, b, c, d]))
-from sympy.plotting import plot
-plot(p2.subs(r,0.2).subs(z,1.), (x, -1, 3), adaptive=False, nb_of_points=400)
-*/
-    if (overlap_distance < - nozzle_r) {
-        // The extrudate is fully supported by the lower layer. This is the ideal case, therefore zero penalty.
-        return 0.f;
-    } else {
-        float x  = overlap_distance / nozzle_r;
-        float x2 = x * x;
-        float x3 = x2 * x;
-        return weight_zero * (1.f + 3.f * x + 3.f * x2 + x3);
-    }
-}
-
 static Points::iterator project_point_to_polygon_and_insert(Polygon &polygon, const Point &pt, double eps)
 {
     assert(polygon.points.size() >= 2);
@@ -2485,97 +2549,34 @@ static Points::iterator project_point_to_polygon_and_insert(Polygon &polygon, co
     return polygon.points.begin() + i_min;
 }
 
-std::vector<float> polygon_parameter_by_length(const Polygon &polygon)
+std::shared_ptr<const EdgeGrid::Grid> GCode::layer_edge_grid(const Layer &layer)
 {
-    // Parametrize the polygon by its length.
-    std::vector<float> lengths(polygon.points.size()+1, 0.);
-    for (size_t i = 1; i < polygon.points.size(); ++ i)
-        lengths[i] = lengths[i-1] + (polygon.points[i] - polygon.points[i-1]).cast<float>().norm();
-    lengths.back() = lengths[lengths.size()-2] + (polygon.points.front() - polygon.points.back()).cast<float>().norm();
-    return lengths;
-}
-
-std::vector<float> polygon_angles_at_vertices(const Polygon &polygon, const std::vector<float> &lengths, float min_arm_length)
-{
-    assert(polygon.points.size() + 1 == lengths.size());
-    if (min_arm_length > 0.25f * lengths.back())
-        min_arm_length = 0.25f * lengths.back();
-
-    // Find the initial prev / next point span.
-    size_t idx_prev = polygon.points.size();
-    size_t idx_curr = 0;
-    size_t idx_next = 1;
-    while (idx_prev > idx_curr && lengths.back() - lengths[idx_prev] < min_arm_length)
-        -- idx_prev;
-    while (idx_next < idx_prev && lengths[idx_next] < min_arm_length)
-        ++ idx_next;
-
-    std::vector<float> angles(polygon.points.size(), 0.f);
-    for (; idx_curr < polygon.points.size(); ++ idx_curr) {
-        // Move idx_prev up until the distance between idx_prev and idx_curr is lower than min_arm_length.
-        if (idx_prev >= idx_curr) {
-            while (idx_prev < polygon.points.size() && lengths.back() - lengths[idx_prev] + lengths[idx_curr] > min_arm_length)
-                ++ idx_prev;
-            if (idx_prev == polygon.points.size())
-                idx_prev = 0;
-        }
-        while (idx_prev < idx_curr && lengths[idx_curr] - lengths[idx_prev] > min_arm_length)
-            ++ idx_prev;
-        // Move idx_prev one step back.
-        if (idx_prev == 0)
-            idx_prev = polygon.points.size() - 1;
-        else
-            -- idx_prev;
-        // Move idx_next up until the distance between idx_curr and idx_next is greater than min_arm_length.
-        if (idx_curr <= idx_next) {
-            while (idx_next < polygon.points.size() && lengths[idx_next] - lengths[idx_curr] < min_arm_length)
-                ++ idx_next;
-            if (idx_next == polygon.points.size())
-                idx_next = 0;
-        }
-        while (idx_next < idx_curr && lengths.back() - lengths[idx_curr] + lengths[idx_next] < min_arm_length)
-            ++ idx_next;
-        // Calculate angle between idx_prev, idx_curr, idx_next.
-        const Point &p0 = polygon.points[idx_prev];
-        const Point &p1 = polygon.points[idx_curr];
-        const Point &p2 = polygon.points[idx_next];
-        const Point  v1 = p1 - p0;
-        const Point  v2 = p2 - p1;
-		int64_t dot   = int64_t(v1(0))*int64_t(v2(0)) + int64_t(v1(1))*int64_t(v2(1));
-		int64_t cross = int64_t(v1(0))*int64_t(v2(1)) - int64_t(v1(1))*int64_t(v2(0));
-		float angle = float(atan2(double(cross), double(dot)));
-        angles[idx_curr] = angle;
-    }
-
-    return angles;
+    if (layer.lslices_edge_grid)
+        // Created by PrintObject::make_seams().
+        return layer.lslices_edge_grid;
+    std::pair<const Layer*, std::shared_ptr<const EdgeGrid::Grid>> &cached = m_layer_edge_grids[layer.object()];
+    if (cached.first != &layer) {
+        // Layers of prismatic parts of an object share the same slices, reuse the grid of the layer below if possible.
+        // The grid references the contours of the layer it was created for, which stay valid for the whole G-code export.
+        if (cached.first == nullptr || cached.first->lslices != layer.lslices) {
+            const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
+            auto grid = std::make_shared<EdgeGrid::Grid>();
+            grid->create(layer.lslices, distance_field_resolution);
+            // Most of the queries are answered from the edges close to the loop, the signed distance field is only needed
+            // away from the lower layer contours. Calculate it on demand.
+            grid->enable_lazy_sdf();
+            cached.second = std::move(grid);
+        }
+        cached.first = &layer;
+    }
+    return cached.second;
 }
 
-std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, std::shared_ptr<const EdgeGrid::Grid> *lower_layer_edge_grid)
 {
     // get a copy; don't modify the orientation of the original loop object otherwise
     // next copies (if any) would not detect the correct orientation
 
-    if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr) {
-        if (! *lower_layer_edge_grid) {
-            // Create the distance field for a layer below.
-            const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
-            *lower_layer_edge_grid = make_unique<EdgeGrid::Grid>();
-            (*lower_layer_edge_grid)->create(m_layer->lower_layer->lslices, distance_field_resolution);
-            (*lower_layer_edge_grid)->calculate_sdf();
-            #if 0
-            {
-                static int iRun = 0;
-                BoundingBox bbox = (*lower_layer_edge_grid)->bbox();
-                bbox.min(0) -= scale_(5.f);
-                bbox.min(1) -= scale_(5.f);
-                bbox.max(0) += scale_(5.f);
-                bbox.max(1) += scale_(5.f);
-                EdgeGrid::save_png(*(*lower_layer_edge_grid), bbox, scale_(0.1f), debug_out_path("GCode_extrude_loop_edge_grid-%d.png", iRun++));
-            }
-            #endif
-        }
-    }
-  
     // extrude all loops ccw
     bool was_clockwise = loop.make_counter_clockwise();
     
@@ -2593,6 +2594,19 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
         const coordf_t nozzle_dmr = EXTRUDER_CONFIG(nozzle_diameter);
         const coord_t  nozzle_r   = coord_t(scale_(0.5 * nozzle_dmr) + 0.5);
 
+        // Position independent penalties for visible seams and overhangs at the vertices of the loop.
+        std::vector<SeamPenalty> seam_penalties;
+        if (loop.seam_penalties.size() == polygon.points.size() && loop.seam_penalties_nozzle_dmr == float(nozzle_dmr)) {
+            // Penalties were calculated by PrintObject::make_seams().
+            seam_penalties = std::move(loop.seam_penalties);
+        } else {
+            if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr && ! *lower_layer_edge_grid)
+                // Create the distance field for a layer below.
+                *lower_layer_edge_grid = this->layer_edge_grid(*m_layer->lower_layer);
+            seam_penalties = seam_penalties_at_vertices(polygon, polygon_parameter_by_length(polygon), was_clockwise, float(nozzle_dmr),
+                (lower_layer_edge_grid == nullptr) ? nullptr : lower_layer_edge_grid->get());
+        }
+
         // Retrieve the last start position for this object.
         float last_pos_weight = 1.f;
 
@@ -2612,43 +2626,29 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
 
         // Insert a projection of last_pos into the polygon.
         size_t last_pos_proj_idx;
+        bool   last_pos_proj_inserted;
         {
+            size_t num_points = polygon.points.size();
             Points::iterator it = project_point_to_polygon_and_insert(polygon, last_pos, 0.1 * nozzle_r);
             last_pos_proj_idx = it - polygon.points.begin();
+            last_pos_proj_inserted = polygon.points.size() > num_points;
         }
 
         // Parametrize the polygon by its length.
         std::vector<float> lengths = polygon_parameter_by_length(polygon);
 
+        if (last_pos_proj_inserted) {
+            // Calculate the penalties of the inserted projection point exactly, and update the angles of its neighbors.
+            if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr && ! *lower_layer_edge_grid)
+                *lower_layer_edge_grid = this->layer_edge_grid(*m_layer->lower_layer);
+            insert_seam_penalty(seam_penalties, polygon, lengths, last_pos_proj_idx, was_clockwise, float(nozzle_dmr),
+                (lower_layer_edge_grid == nullptr) ? nullptr : lower_layer_edge_grid->get());
+        }
+
         // For each polygon point, store a penalty.
-        // First calculate the angles, store them as penalties. The angles are caluculated over a minimum arm length of nozzle_r.
-        std::vector<float> penalties = polygon_angles_at_vertices(polygon, lengths, float(nozzle_r));
-        // No penalty for reflex points, slight penalty for convex points, high penalty for flat surfaces.
-        const float penaltyConvexVertex = 1.f;
-        const float penaltyFlatSurface  = 5.f;
-        const float penaltyOverhangHalf = 10.f;
-        // Penalty for visible seams.
+        std::vector<float> penalties(polygon.points.size(), 0.f);
         for (size_t i = 0; i < polygon.points.size(); ++ i) {
-            float ccwAngle = penalties[i];
-            if (was_clockwise)
-                ccwAngle = - ccwAngle;
-            float penalty = 0;
-//            if (ccwAngle <- float(PI/3.))
-            if (ccwAngle <- float(0.6 * PI))
-                // Sharp reflex vertex. We love that, it hides the seam perfectly.
-                penalty = 0.f;
-//            else if (ccwAngle > float(PI/3.))
-            else if (ccwAngle > float(0.6 * PI))
-                // Seams on sharp convex vertices are more visible than on reflex vertices.
-                penalty = penaltyConvexVertex;
-            else if (ccwAngle < 0.f) {
-                // Interpolate penalty between maximum and zero.
-                penalty = penaltyFlatSurface * bspline_kernel(ccwAngle * float(PI * 2. / 3.));
-            } else {
-                assert(ccwAngle >= 0.f);
-                // Interpolate penalty between maximum and the penalty for a convex vertex.
-                penalty = penaltyConvexVertex + (penaltyFlatSurface - penaltyConvexVertex) * bspline_kernel(ccwAngle * float(PI * 2. / 3.));
-            }
+            float penalty = seam_penalties[i].visibility;
             // Give a negative penalty for points close to the last point or the prefered seam location.
             //float dist_to_last_pos_proj = last_pos_proj.distance_to(polygon.points[i]);
             float dist_to_last_pos_proj = (i < last_pos_proj_idx) ? 
@@ -2656,30 +2656,8 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
                 std::min(lengths[i] - lengths[last_pos_proj_idx], lengths.back() - lengths[i] + lengths[last_pos_proj_idx]);
             float dist_max = 0.1f * lengths.back(); // 5.f * nozzle_dmr
             penalty -= last_pos_weight * bspline_kernel(dist_to_last_pos_proj / dist_max);
-            penalties[i] = std::max(0.f, penalty);
-        }
-
-        // Penalty for overhangs.
-        if (lower_layer_edge_grid && (*lower_layer_edge_grid)) {
-            // Use the edge grid distance field structure over the lower layer to calculate overhangs.
-            coord_t nozzle_r = coord_t(floor(scale_(0.5 * nozzle_dmr) + 0.5));
-            coord_t search_r = coord_t(floor(scale_(0.8 * nozzle_dmr) + 0.5));
-            for (size_t i = 0; i < polygon.points.size(); ++ i) {
-                const Point &p = polygon.points[i];
-                coordf_t dist;
-                // Signed distance is positive outside the object, negative inside the object.
-                // The point is considered at an overhang, if it is more than nozzle radius
-                // outside of the lower layer contour.
-                #ifdef NDEBUG // to suppress unused variable warning in release mode
-                    (*lower_layer_edge_grid)->signed_distance(p, search_r, dist);
-                #else
-                    bool found = (*lower_layer_edge_grid)->signed_distance(p, search_r, dist);
-                #endif
-                // If the approximate Signed Distance Field was initialized over lower_layer_edge_grid,
-                // then the signed distnace shall always be known.
-                assert(found); 
-                penalties[i] += extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dist));
-            }
+            // Penalty for overhangs.
+            penalties[i] = std::max(0.f, penalty) + seam_penalties[i].overhang;
         }
 
         // Find a point with a minimum penalty.
@@ -2835,7 +2813,7 @@ std::string GCode::extrude_multi_path(ExtrusionMultiPath multipath, std::string
     return gcode;
 }
 
-std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid)
+std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, std::shared_ptr<const EdgeGrid::Grid> *lower_layer_edge_grid)
 {
     if (const ExtrusionPath* path = dynamic_cast<const ExtrusionPath*>(&entity))
         return this->extrude_path(*path, description, speed);
@@ -2863,7 +2841,7 @@ std::string GCode::extrude_path(ExtrusionPath path, std::string description, dou
 }
 
 // Extrude perimeters: Decide where to put seams (hide or align seams).
-std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid)
+std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::shared_ptr<const EdgeGrid::Grid> &lower_layer_edge_grid)
 {
     std::string gcode;
     for (const ObjectByExtruder::Island::Region &region : by_region)
@@ -2937,12 +2915,20 @@ void GCode::_write(FILE* file, const char *what)
         // apply analyzer, if enabled
         const char* gcode = m_enable_analyzer ? m_analyzer.process_gcode(what).c_str() : what;
 
+        size_t      len   = ::strlen(gcode);
         // writes string to file
-        fwrite(gcode, 1, ::strlen(gcode), file);
+        fwrite(gcode, 1, len, file);
         // updates time estimator and gcode lines vector
-        m_normal_time_estimator.add_gcode_block(gcode);
-        if (m_silent_time_estimator_enabled)
-            m_silent_time_estimator.add_gcode_block(gcode);
+        if (m_silent_time_estimator_enabled && len > 4096)
+            // The normal and silent mode estimators are independent, let them parse and plan the G-code of a whole layer concurrently.
+            tbb::parallel_invoke(
+                [this, gcode]() { m_normal_time_estimator.add_gcode_block(gcode); },
+                [this, gcode]() { m_silent_time_estimator.add_gcode_block(gcode); });
+        else {
+            m_normal_time_estimator.add_gcode_block(gcode);
+            if (m_silent_time_estimator_enabled)
+                m_silent_time_estimator.add_gcode_block(gcode);
+        }
     }
 }
 
@@ -3081,6 +3067,13 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
         }
     }
 
+    // names the feature type for G-code viewers and analyze_gcode_file()
+    if (m_config.gcode_comments && path.role() != m_last_feature_type)
+    {
+        m_last_feature_type = path.role();
+        gcode += ";" + GCodeAnalyzer::Feature_Type_Tag + ExtrusionEntity::role_to_string(m_last_feature_type) + "\n";
+    }
+
     // adds analyzer tags and updates analyzer's tracking data
     if (m_enable_analyzer)
     {
@@ -3129,15 +3122,19 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
     }
 
     // F is mm per minute.
-    gcode += m_writer.set_speed(F, "", comment);
+    m_writer.set_speed(gcode, F, "", comment);
     double path_length = 0.;
     {
         std::string comment = m_config.gcode_comments ? description : "";
-        for (const Line &line : path.polyline.lines()) {
-            const double line_length = line.length() * SCALING_FACTOR;
+        // Append the extrusions directly to the output, a single G1 line is roughly 40 characters long.
+        gcode.reserve(gcode.size() + 40 * path.polyline.points.size());
+        for (size_t i = 1; i < path.polyline.points.size(); ++ i) {
+            const Point &p1 = path.polyline.points[i - 1];
+            const Point &p2 = path.polyline.points[i];
+            const double line_length = (p2 - p1).cast<double>().norm() * SCALING_FACTOR;
             path_length += line_length;
-            gcode += m_writer.extrude_to_xy(
-                this->point_to_gcode(line.b),
+            m_writer.extrude_to_xy(gcode,
+                this->point_to_gcode(p2),
                 e_per_mm * line_length,
                 comment);
         }
@@ -3190,7 +3187,7 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
     Lines lines = travel.lines();
     if (! lines.empty()) {
         for (const Line &line : lines)
-    	    gcode += m_writer.travel_to_xy(this->point_to_gcode(line.b), comment);    
+    	    m_writer.travel_to_xy(gcode, this->point_to_gcode(line.b), comment);    
         this->set_last_pos(lines.back().b);
     }
     return gcode;
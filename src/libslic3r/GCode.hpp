@@ -18,6 +18,7 @@
 #include "GCode/Analyzer.hpp"
 #include "GCode/ThumbnailData.hpp"
 
+#include <map>
 #include <memory>
 #include <string>
 
@@ -116,8 +117,9 @@ private:
     WipeTowerIntegration& operator=(const WipeTowerIntegration&);
     std::string append_tcr(GCode &gcodegen, const WipeTower::ToolChangeResult &tcr, int new_extruder_id, double z = -1.) const;
 
-    // Postprocesses gcode: rotates and moves G1 extrusions and returns result
-    std::string post_process_wipe_tower_moves(const WipeTower::ToolChangeResult& tcr, const Vec2f& translation, float angle) const;
+    // Appends the wipe tower gcode with the G1 moves rotated and moved to the print bed coordinates and with the custom gcodes inserted.
+    void append_wipe_tower_gcode(std::string &gcode, const WipeTower::ToolChangeResult &tcr, const Vec2f &translation, float angle,
+        const std::string &end_filament_gcode, const std::string &toolchange_gcode, const std::string &start_filament_gcode) const;
 
     // Left / right edges of the wipe tower, for the planning of wipe moves.
     const float                                                  m_left;
@@ -153,6 +155,7 @@ public:
         m_volumetric_speed(0),
         m_last_pos_defined(false),
         m_last_extrusion_role(erNone),
+        m_last_feature_type(erNone),
         m_last_mm3_per_mm(GCodeAnalyzer::Default_mm3_per_mm),
         m_last_width(GCodeAnalyzer::Default_Width),
         m_last_height(GCodeAnalyzer::Default_Height),
@@ -229,8 +232,8 @@ private:
     void            set_extruders(const std::vector<unsigned int> &extruder_ids);
     std::string     preamble();
     std::string     change_layer(coordf_t print_z);
-    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
-    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
+    std::string     extrude_entity(const ExtrusionEntity &entity, std::string description = "", double speed = -1., std::shared_ptr<const EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
+    std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., std::shared_ptr<const EdgeGrid::Grid> *lower_layer_edge_grid = nullptr);
     std::string     extrude_multi_path(ExtrusionMultiPath multipath, std::string description = "", double speed = -1.);
     std::string     extrude_path(ExtrusionPath path, std::string description = "", double speed = -1.);
 
@@ -297,7 +300,10 @@ private:
 		// For sequential print, the instance of the object to be printing has to be defined.
 		const size_t                     				 single_object_instance_idx);
 
-    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid);
+    // Edge grid with a signed distance field over the slices of a layer, used by extrude_loop() to avoid placing seams over overhangs.
+    // The grid is reused for the following layers of the same object as long as their slices are identical.
+    std::shared_ptr<const EdgeGrid::Grid> layer_edge_grid(const Layer &layer);
+    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::shared_ptr<const EdgeGrid::Grid> &lower_layer_edge_grid);
     std::string     extrude_infill(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, bool ironing);
     std::string     extrude_support(const ExtrusionEntityCollection &support_fills);
 
@@ -341,9 +347,13 @@ private:
     // In non-sequential mode, all its copies will be printed.
     const Layer*                        m_layer;
     std::map<const PrintObject*,Point>  m_seam_position;
+    // Last edge grid created by layer_edge_grid() per object and the layer it was created for.
+    std::map<const PrintObject*, std::pair<const Layer*, std::shared_ptr<const EdgeGrid::Grid>>> m_layer_edge_grids;
     double                              m_volumetric_speed;
     // Support for the extrusion role markers. Which marker is active?
     ExtrusionRole                       m_last_extrusion_role;
+    // Support for the feature type comments, which are exported with gcode_comments. Which feature type was named last?
+    ExtrusionRole                       m_last_feature_type;
     // Support for G-Code Analyzer
     double                              m_last_mm3_per_mm;
     float                               m_last_width;
@@ -413,6 +423,47 @@ private:
 
 std::vector<const PrintInstance*> sort_object_instances_by_model_order(const Print& print);
 
+// Statistics of an existing G-code file, collected by the time estimators and the G-code analyzer.
+struct GCodeFileStatistics
+{
+    struct Extrusion {
+        // Length of the filament pushed into the extruder.
+        double filament_mm { 0. };
+        // Length of the extrusion moves.
+        double length_mm   { 0. };
+    };
+    struct Layer : Extrusion {
+        float  z;
+    };
+    struct Filament {
+        double length_mm   { 0. };
+        double volume_mm3  { 0. };
+        double weight_g    { 0. };
+    };
+
+    size_t                              file_size           { 0 };
+    float                               normal_time         { 0.f };
+    std::string                         normal_time_dhms;
+    // Only estimated for the Marlin firmware with the silent mode enabled.
+    bool                                has_silent_time     { false };
+    float                               silent_time         { 0.f };
+    std::string                         silent_time_dhms;
+    // Indexed by the extruder ID.
+    std::vector<Filament>               filaments;
+    std::map<ExtrusionRole, Extrusion>  extrusion_roles;
+    // Sorted by Z.
+    std::vector<Layer>                  layers;
+    double                              travel_length_mm    { 0. };
+    size_t                              tool_changes        { 0 };
+
+    // Machine readable output of the G-code analysis.
+    std::string to_json() const;
+};
+
+// Stream an existing G-code file through the time estimators and the G-code analyzer configured from the printer config
+// the same way as for the G-code export. Throws std::runtime_error if the file cannot be read.
+GCodeFileStatistics analyze_gcode_file(const std::string &path, const PrintConfig &config);
+
 }
 
 #endif
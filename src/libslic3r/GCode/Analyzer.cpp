@@ -9,6 +9,8 @@
 
 #include <boost/log/trivial.hpp>
 
+#include <tbb/parallel_for.h>
+
 #include "Analyzer.hpp"
 #include "PreviewData.hpp"
 
@@ -32,6 +34,7 @@ const std::string GCodeAnalyzer::Color_Change_Tag = "_ANALYZER_COLOR_CHANGE";
 const std::string GCodeAnalyzer::Pause_Print_Tag = "_ANALYZER_PAUSE_PRINT";
 const std::string GCodeAnalyzer::Custom_Code_Tag = "_ANALYZER_CUSTOM_CODE";
 const std::string GCodeAnalyzer::End_Pause_Print_Or_Custom_Code_Tag = "_ANALYZER_END_PAUSE_PRINT_OR_CUSTOM_CODE";
+const std::string GCodeAnalyzer::Feature_Type_Tag = "TYPE:";
 
 const float GCodeAnalyzer::Default_mm3_per_mm = 0.0f;
 const float GCodeAnalyzer::Default_Width = 0.0f;
@@ -146,11 +149,22 @@ const std::string& GCodeAnalyzer::process_gcode(const std::string& gcode)
 
     m_parser.parse_buffer(gcode,
         [this](GCodeReader& reader, const GCodeReader::GCodeLine& line)
-    { this->_process_gcode_line(reader, line); });
+    {
+        if (this->_process_gcode_line(reader, line))
+            // puts the line back into the gcode
+            m_process_output += line.raw() + "\n";
+    });
 
     return m_process_output;
 }
 
+void GCodeAnalyzer::process_gcode(const char* begin, const char* end)
+{
+    m_parser.parse_buffer(begin, end,
+        [this](GCodeReader& reader, const GCodeReader::GCodeLine& line)
+    { this->_process_gcode_line(reader, line); });
+}
+
 void GCodeAnalyzer::calc_gcode_preview_data(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
 {
     // resets preview data
@@ -174,16 +188,16 @@ bool GCodeAnalyzer::is_valid_extrusion_role(ExtrusionRole role)
     return ((erPerimeter <= role) && (role < erMixed));
 }
 
-void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line)
+bool GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLine& line)
 {
     // processes 'special' comments contained in line
     if (_process_tags(line))
     {
 #if 0
         // DEBUG ONLY: puts the line back into the gcode
-        m_process_output += line.raw() + "\n";
+        return true;
 #endif
-        return;
+        return false;
     }
 
     // sets new start position/extrusion
@@ -191,7 +205,7 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
     _set_start_extrusion(_get_axis_position(E));
 
     // processes 'normal' gcode lines
-    std::string cmd = line.cmd();
+    std::string_view cmd = line.cmd();
     if (cmd.length() > 1)
     {
         switch (::toupper(cmd[0]))
@@ -303,8 +317,7 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
         }
     }
 
-    // puts the line back into the gcode
-    m_process_output += line.raw() + "\n";
+    return true;
 }
 
 void GCodeAnalyzer::_processG1(const GCodeReader::GCodeLine& line)
@@ -575,11 +588,11 @@ void GCodeAnalyzer::_reset_cached_position()
     }
 }
 
-void GCodeAnalyzer::_processT(const std::string& cmd)
+void GCodeAnalyzer::_processT(std::string_view cmd)
 {
     if (cmd.length() > 1)
     {
-        unsigned int id = (unsigned int)::strtol(cmd.substr(1).c_str(), nullptr, 10);
+        unsigned int id = (unsigned int)::strtol(std::string(cmd.substr(1)).c_str(), nullptr, 10);
         if (_get_extruder_id() != id)
         {
             if (id >= m_extruders_count)
@@ -607,7 +620,14 @@ void GCodeAnalyzer::_processT(const GCodeReader::GCodeLine& line)
 
 bool GCodeAnalyzer::_process_tags(const GCodeReader::GCodeLine& line)
 {
-    std::string comment = line.comment();
+    std::string_view comment = line.comment();
+
+    // feature type comment, kept in the gcode
+    if (comment.substr(0, Feature_Type_Tag.length()) == Feature_Type_Tag)
+    {
+        _process_feature_type_tag(comment);
+        return false;
+    }
 
     // extrusion role tag
     size_t pos = comment.find(Extrusion_Role_Tag);
@@ -646,7 +666,7 @@ bool GCodeAnalyzer::_process_tags(const GCodeReader::GCodeLine& line)
     if (pos != comment.npos)
     {
         pos = comment.find_last_of(",T");
-        unsigned extruder = pos == comment.npos ? 0 : std::stoi(comment.substr(pos + 1, comment.npos));
+        unsigned extruder = pos == comment.npos ? 0 : std::stoi(std::string(comment.substr(pos + 1)));
         _process_color_change_tag(extruder);
         return true;
     }
@@ -678,9 +698,9 @@ bool GCodeAnalyzer::_process_tags(const GCodeReader::GCodeLine& line)
     return false;
 }
 
-void GCodeAnalyzer::_process_extrusion_role_tag(const std::string& comment, size_t pos)
+void GCodeAnalyzer::_process_extrusion_role_tag(std::string_view comment, size_t pos)
 {
-    int role = (int)::strtol(comment.substr(pos + Extrusion_Role_Tag.length()).c_str(), nullptr, 10);
+    int role = (int)::strtol(std::string(comment.substr(pos + Extrusion_Role_Tag.length())).c_str(), nullptr, 10);
     if (_is_valid_extrusion_role(role))
         _set_extrusion_role((ExtrusionRole)role);
     else
@@ -689,19 +709,28 @@ void GCodeAnalyzer::_process_extrusion_role_tag(const std::string& comment, size
     }
 }
 
-void GCodeAnalyzer::_process_mm3_per_mm_tag(const std::string& comment, size_t pos)
+void GCodeAnalyzer::_process_feature_type_tag(std::string_view comment)
 {
-    _set_mm3_per_mm((float)::strtod(comment.substr(pos + Mm3_Per_Mm_Tag.length()).c_str(), nullptr));
+    std::string_view type = comment.substr(Feature_Type_Tag.length());
+    while (! type.empty() && ::isspace((unsigned char)type.back()))
+        type.remove_suffix(1);
+    // feature types of other slicers are not known and set erNone
+    _set_extrusion_role(ExtrusionEntity::string_to_role(type));
 }
 
-void GCodeAnalyzer::_process_width_tag(const std::string& comment, size_t pos)
+void GCodeAnalyzer::_process_mm3_per_mm_tag(std::string_view comment, size_t pos)
 {
-    _set_width((float)::strtod(comment.substr(pos + Width_Tag.length()).c_str(), nullptr));
+    _set_mm3_per_mm((float)::strtod(std::string(comment.substr(pos + Mm3_Per_Mm_Tag.length())).c_str(), nullptr));
 }
 
-void GCodeAnalyzer::_process_height_tag(const std::string& comment, size_t pos)
+void GCodeAnalyzer::_process_width_tag(std::string_view comment, size_t pos)
 {
-    _set_height((float)::strtod(comment.substr(pos + Height_Tag.length()).c_str(), nullptr));
+    _set_width((float)::strtod(std::string(comment.substr(pos + Width_Tag.length())).c_str(), nullptr));
+}
+
+void GCodeAnalyzer::_process_height_tag(std::string_view comment, size_t pos)
+{
+    _set_height((float)::strtod(std::string(comment.substr(pos + Height_Tag.length())).c_str(), nullptr));
 }
 
 void GCodeAnalyzer::_process_color_change_tag(unsigned extruder)
@@ -931,115 +960,99 @@ bool GCodeAnalyzer::_is_valid_extrusion_role(int value) const
 
 void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
 {
-    struct Helper
-    {
-        static GCodePreviewData::Extrusion::Layer& get_layer_at_z(GCodePreviewData::Extrusion::LayersList& layers, float z)
-        {
-            //FIXME this has a terrible time complexity
-            for (GCodePreviewData::Extrusion::Layer& layer : layers)
-            {
-                // if layer found, return it
-                if (layer.z == z)
-                    return layer;
-            }
-
-            // if layer not found, create and return it
-            layers.emplace_back(z, GCodePreviewData::Extrusion::Paths());
-            return layers.back();
-        }
-
-        static void store_polyline(const Polyline& polyline, const Metadata& data, float z, GCodePreviewData& preview_data)
-        {
-            // if the polyline is valid, create the extrusion path from it and store it
-            if (polyline.is_valid())
-            {
-				auto& paths = get_layer_at_z(preview_data.extrusion.layers, z).paths;
-				paths.emplace_back(GCodePreviewData::Extrusion::Path());
-				GCodePreviewData::Extrusion::Path &path = paths.back();
-                path.polyline = polyline;
-				path.extrusion_role = data.extrusion_role;
-                path.mm3_per_mm = data.mm3_per_mm;
-                path.width = data.width;
-				path.height = data.height;
-                path.feedrate = data.feedrate;
-                path.extruder_id = data.extruder_id;
-                path.cp_color_id = data.cp_color_id;
-                path.fan_speed = data.fan_speed;
-            }
-        }
-    };
-
     TypeToMovesMap::iterator extrude_moves = m_moves_map.find(GCodeMove::Extrude);
     if (extrude_moves == m_moves_map.end())
         return;
-
-    Metadata data;
-    float z = FLT_MAX;
-    Polyline polyline;
-    Vec3f position(FLT_MAX, FLT_MAX, FLT_MAX);
-    float volumetric_rate = FLT_MAX;
-    GCodePreviewData::Range height_range;
-    GCodePreviewData::Range width_range;
-    GCodePreviewData::MultiRange<GCodePreviewData::FeedrateKind> feedrate_range;
-    GCodePreviewData::Range volumetric_rate_range;
-    GCodePreviewData::Range fan_speed_range;
-
-    // to avoid to call the callback too often
-    unsigned int cancel_callback_threshold = (unsigned int)std::max((int)extrude_moves->second.size() / 25, 1);
-    unsigned int cancel_callback_curr = 0;
-
-    // constructs the polylines while traversing the moves
-    for (const GCodeMove& move : extrude_moves->second)
+    const GCodeMovesList &moves = extrude_moves->second;
+
+    // Split the moves into runs of consecutive moves starting at the same z. A path never spans two runs.
+    // The runs at the same z are collected into a single layer, in case of sequential prints they are not consecutive.
+    std::vector<std::pair<size_t, size_t>> runs;
+    std::vector<float>                     zs;
+    for (size_t i = 0; i < moves.size();) {
+        size_t j = i + 1;
+        for (float z = moves[i].start_position.z(); j < moves.size() && moves[j].start_position.z() == z; ++ j) ;
+        runs.emplace_back(i, j);
+        zs.emplace_back(moves[i].start_position.z());
+        i = j;
+    }
+    std::vector<std::vector<size_t>> layer_runs;
     {
-        // to avoid to call the callback too often
-        cancel_callback_curr = (cancel_callback_curr + 1) % cancel_callback_threshold;
-        if (cancel_callback_curr == 0)
-            cancel_callback();
-
-        if ((data != move.data) || (z != move.start_position.z()) || (position != move.start_position) || (volumetric_rate != move.data.feedrate * move.data.mm3_per_mm))
-        {
-            // store current polyline
-            polyline.remove_duplicate_points();
-            Helper::store_polyline(polyline, data, z, preview_data);
-
-            // reset current polyline
-            polyline = Polyline();
-
-            // add both vertices of the move
-            polyline.append(Point(scale_(move.start_position.x()), scale_(move.start_position.y())));
-            polyline.append(Point(scale_(move.end_position.x()), scale_(move.end_position.y())));
-
-            // update current values
-            data = move.data;
-            z = (float)move.start_position.z();
-            volumetric_rate = move.data.feedrate * move.data.mm3_per_mm;
-            height_range.update_from(move.data.height);
-            width_range.update_from(move.data.width);
-            feedrate_range.update_from(move.data.feedrate, GCodePreviewData::FeedrateKind::EXTRUSION);
-            volumetric_rate_range.update_from(volumetric_rate);
-            fan_speed_range.update_from(move.data.fan_speed);
-        }
-        else
-            // append end vertex of the move to current polyline
-            polyline.append(Point(scale_(move.end_position.x()), scale_(move.end_position.y())));
-
-        // update current values
-        position = move.end_position;
+        std::vector<float> run_zs = zs;
+        sort_remove_duplicates(zs);
+        layer_runs.assign(zs.size(), std::vector<size_t>());
+        for (size_t run_id = 0; run_id < runs.size(); ++ run_id)
+            layer_runs[std::lower_bound(zs.begin(), zs.end(), run_zs[run_id]) - zs.begin()].emplace_back(run_id);
     }
 
-    // store last polyline
-    polyline.remove_duplicate_points();
-    Helper::store_polyline(polyline, data, z, preview_data);
+    GCodePreviewData::Extrusion::LayersList &layers = preview_data.extrusion.layers;
+    assert(layers.empty());
+    layers.reserve(zs.size());
+    for (float z : zs)
+        layers.emplace_back(z);
+    // Color mapping ranges collected per layer, to be merged once the layers are built.
+    std::vector<GCodePreviewData::Ranges> layer_ranges(zs.size());
+
+    // Constructs the paths of each layer while traversing the moves. The layers are independent, build them in parallel.
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, zs.size()),
+        [&moves, &runs, &layer_runs, &layers, &layer_ranges, &cancel_callback](const tbb::blocked_range<size_t> &range) {
+        for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+            cancel_callback();
+            GCodePreviewData::Extrusion::Layer &layer  = layers[layer_id];
+            GCodePreviewData::Ranges           &ranges = layer_ranges[layer_id];
+            GCodePreviewData::Extrusion::Path   path;
+            size_t                              first_point = 0;
+            auto close_path = [&layer, &path, &first_point]() {
+                // Store the path only if it is valid, that is if it has at least two distinct points.
+                if (layer.points.size() - first_point >= 2)
+                    layer.close_path(path);
+                else
+                    layer.points.resize(first_point);
+            };
+            for (size_t run_id : layer_runs[layer_id]) {
+                const GCodeMove *prev = nullptr;
+                for (size_t i = runs[run_id].first; i < runs[run_id].second; ++ i) {
+                    const GCodeMove &move = moves[i];
+                    if (prev == nullptr || prev->data != move.data || prev->end_position != move.start_position) {
+                        if (prev != nullptr)
+                            close_path();
+                        // Start a new path with the start vertex of the move.
+                        first_point         = layer.points.size();
+                        path.extrusion_role = move.data.extrusion_role;
+                        path.mm3_per_mm     = move.data.mm3_per_mm;
+                        path.width          = move.data.width;
+                        path.height         = move.data.height;
+                        path.feedrate       = move.data.feedrate;
+                        path.extruder_id    = move.data.extruder_id;
+                        path.cp_color_id    = move.data.cp_color_id;
+                        path.fan_speed      = move.data.fan_speed;
+                        layer.points.emplace_back(scale_(move.start_position.x()), scale_(move.start_position.y()));
+                        ranges.height.update_from(move.data.height);
+                        ranges.width.update_from(move.data.width);
+                        ranges.feedrate.update_from(move.data.feedrate, GCodePreviewData::FeedrateKind::EXTRUSION);
+                        ranges.volumetric_rate.update_from(move.data.feedrate * move.data.mm3_per_mm);
+                        ranges.fan_speed.update_from(move.data.fan_speed);
+                    }
+                    // Append the end vertex of the move to the current path, skipping duplicate vertices.
+                    Point pt(scale_(move.end_position.x()), scale_(move.end_position.y()));
+                    if (pt != layer.points.back())
+                        layer.points.emplace_back(pt);
+                    prev = &move;
+                }
+                if (prev != nullptr)
+                    close_path();
+            }
+        }
+    });
 
     // updates preview ranges data
-    preview_data.ranges.height.update_from(height_range);
-    preview_data.ranges.width.update_from(width_range);
-    preview_data.ranges.feedrate.update_from(feedrate_range);
-    preview_data.ranges.volumetric_rate.update_from(volumetric_rate_range);
-    preview_data.ranges.fan_speed.update_from(fan_speed_range);
-
-    // we need to sort the layers by their z as they can be shuffled in case of sequential prints
-    std::sort(preview_data.extrusion.layers.begin(), preview_data.extrusion.layers.end(), [](const GCodePreviewData::Extrusion::Layer& l1, const GCodePreviewData::Extrusion::Layer& l2)->bool { return l1.z < l2.z; });
+    for (const GCodePreviewData::Ranges &ranges : layer_ranges) {
+        preview_data.ranges.height.update_from(ranges.height);
+        preview_data.ranges.width.update_from(ranges.width);
+        preview_data.ranges.feedrate.update_from(ranges.feedrate);
+        preview_data.ranges.volumetric_rate.update_from(ranges.volumetric_rate);
+        preview_data.ranges.fan_speed.update_from(ranges.fan_speed);
+    }
 }
 
 void GCodeAnalyzer::_calc_gcode_preview_travel(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
@@ -23,6 +23,9 @@ public:
     static const std::string Pause_Print_Tag;
     static const std::string Custom_Code_Tag;
     static const std::string End_Pause_Print_Or_Custom_Code_Tag;
+    // Names the extrusion role of the following moves by ExtrusionEntity::role_to_string().
+    // Unlike the tags above, the feature type comments are kept in the gcode exported with gcode_comments.
+    static const std::string Feature_Type_Tag;
 
     static const float Default_mm3_per_mm;
     static const float Default_Width;
@@ -137,6 +140,14 @@ public:
 
     // Adds the gcode contained in the given string to the analysis and returns it after removing the workcodes
     const std::string& process_gcode(const std::string& gcode);
+    // Adds the gcode contained in the given buffer to the analysis, for example a chunk of a memory mapped file.
+    // The buffer does not need to be zero terminated and the processed gcode is not collected.
+    void process_gcode(const char* begin, const char* end);
+
+    // Moves collected by process_gcode() so far
+    const TypeToMovesMap& moves_map() const { return m_moves_map; }
+    // Drops the moves collected so far while keeping the state of the analyzer, so that a long gcode may be analyzed by chunks
+    void clear_moves() { for (auto& it : m_moves_map) it.second.clear(); }
 
     // Calculates all data needed for gcode visualization
     // throws CanceledException through print->throw_if_canceled() (sent by the caller as callback).
@@ -148,8 +159,8 @@ public:
     static bool is_valid_extrusion_role(ExtrusionRole role);
 
 private:
-    // Processes the given gcode line
-    void _process_gcode_line(GCodeReader& reader, const GCodeReader::GCodeLine& line);
+    // Processes the given gcode line, returns false if the line is a tag to be removed from the gcode
+    bool _process_gcode_line(GCodeReader& reader, const GCodeReader::GCodeLine& line);
 
     // Move
     void _processG1(const GCodeReader::GCodeLine& line);
@@ -200,7 +211,7 @@ private:
     void _processM402(const GCodeReader::GCodeLine& line);
 
     // Processes T line (Select Tool)
-    void _processT(const std::string& command);
+    void _processT(std::string_view command);
     void _processT(const GCodeReader::GCodeLine& line);
 
     // Processes the tags
@@ -208,16 +219,19 @@ private:
     bool _process_tags(const GCodeReader::GCodeLine& line);
 
     // Processes extrusion role tag
-    void _process_extrusion_role_tag(const std::string& comment, size_t pos);
+    void _process_extrusion_role_tag(std::string_view comment, size_t pos);
+
+    // Processes feature type comment
+    void _process_feature_type_tag(std::string_view comment);
 
     // Processes mm3_per_mm tag
-    void _process_mm3_per_mm_tag(const std::string& comment, size_t pos);
+    void _process_mm3_per_mm_tag(std::string_view comment, size_t pos);
 
     // Processes width tag
-    void _process_width_tag(const std::string& comment, size_t pos);
+    void _process_width_tag(std::string_view comment, size_t pos);
 
     // Processes height tag
-    void _process_height_tag(const std::string& comment, size_t pos);
+    void _process_height_tag(std::string_view comment, size_t pos);
 
     // Processes color change tag
     void _process_color_change_tag(unsigned extruder);
@@ -1,8 +1,8 @@
 #include "../GCode.hpp"
 #include "CoolingBuffer.hpp"
-#include <boost/algorithm/string/predicate.hpp>
-#include <boost/algorithm/string/replace.hpp>
 #include <boost/log/trivial.hpp>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <float.h>
 
@@ -50,7 +50,7 @@ struct CoolingLine
     };
 
     CoolingLine(unsigned int type, size_t  line_start, size_t  line_end) :
-        type(type), line_start(line_start), line_end(line_end),
+        type(type), line_start(line_start), line_end(line_end), comment_start(line_end), feedrate_start(size_t(-1)),
         length(0.f), feedrate(0.f), time(0.f), time_max(0.f), slowdown(false) {}
 
     bool adjustable(bool slowdown_external_perimeters) const {
@@ -68,6 +68,10 @@ struct CoolingLine
     size_t  line_start;
     // End of this line at the G-code snippet.
     size_t  line_end;
+    // Start of the comment of this line (the first ';') at the G-code snippet, line_end if there is no comment.
+    size_t  comment_start;
+    // Start of the value of the first F word of this G0 / G1 line at the G-code snippet, size_t(-1) if there is none.
+    size_t  feedrate_start;
     // XY Euclidian length of this segment.
     float   length;
     // Current feedrate, possibly adjusted.
@@ -286,6 +290,22 @@ std::string CoolingBuffer::process_layer(const std::string &gcode, size_t layer_
     return this->apply_layer_cooldown(gcode, layer_id, layer_time_stretched, per_extruder_adjustments);
 }
 
+// Does the text span <begin, end) start with prefix?
+static inline bool starts_with(const char *begin, const char *end, const char *prefix)
+{
+    for (; *prefix != 0; ++ begin, ++ prefix)
+        if (begin == end || *begin != *prefix)
+            return false;
+    return true;
+}
+
+// Does the text span <begin, end) contain the string str?
+static inline bool contains(const char *begin, const char *end, const char *str)
+{
+    size_t len = strlen(str);
+    return size_t(end - begin) >= len && std::search(begin, end, str, str + len) != end;
+}
+
 // Parse the layer G-code for the moves, which could be adjusted.
 // Return the list of parsed lines, bucketed by an extruder.
 std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const
@@ -322,27 +342,32 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
     {
         while (*line_end != '\n' && *line_end != 0)
             ++ line_end;
-        // sline will not contain the trailing '\n'.
-        std::string sline(line_start, line_end);
+        // sline_end points to the end of the line, not including the trailing '\n'.
+        // The line is tokenized in place, the type and the text spans of its F word and of its comment are stored
+        // into CoolingLine, so that apply_layer_cooldown() does not need to parse the line again.
+        const char *sline_end = line_end;
         // CoolingLine will contain the trailing '\n'.
         if (*line_end == '\n')
             ++ line_end;
         CoolingLine line(0, line_start - gcode.c_str(), line_end - gcode.c_str());
-        if (boost::starts_with(sline, "G0 "))
+        const char *comment = std::find(line_start, sline_end, ';');
+        line.comment_start = comment - gcode.c_str();
+        if (starts_with(line_start, sline_end, "G0 "))
             line.type = CoolingLine::TYPE_G0;
-        else if (boost::starts_with(sline, "G1 "))
+        else if (starts_with(line_start, sline_end, "G1 "))
             line.type = CoolingLine::TYPE_G1;
-        else if (boost::starts_with(sline, "G92 "))
+        else if (starts_with(line_start, sline_end, "G92 "))
             line.type = CoolingLine::TYPE_G92;
         if (line.type) {
             // G0, G1 or G92
             // Parse the G-code line.
-            std::vector<float> new_pos(current_pos);
-            const char *c = sline.data() + 3;
+            float new_pos[5];
+            std::copy(current_pos.begin(), current_pos.end(), new_pos);
+            const char *c = line_start + 3;
             for (;;) {
                 // Skip whitespaces.
-                for (; *c == ' ' || *c == '\t'; ++ c);
-                if (*c == 0 || *c == ';')
+                for (; c != sline_end && (*c == ' ' || *c == '\t'); ++ c);
+                if (c == sline_end || *c == ';')
                     break;
                 // Parse the axis.
                 size_t axis = (*c >= 'X' && *c <= 'Z') ? (*c - 'X') :
@@ -352,21 +377,24 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     if (axis == 4) {
                         // Convert mm/min to mm/sec.
                         new_pos[4] /= 60.f;
+                        if (line.feedrate_start == size_t(-1))
+                            line.feedrate_start = c - gcode.c_str();
                         if ((line.type & CoolingLine::TYPE_G92) == 0)
                             // This is G0 or G1 line and it sets the feedrate. This mark is used for reducing the duplicate F calls.
                             line.type |= CoolingLine::TYPE_HAS_F;
                     }
                 }
                 // Skip this word.
-                for (; *c != ' ' && *c != '\t' && *c != 0; ++ c);
+                for (; c != sline_end && *c != ' ' && *c != '\t'; ++ c);
             }
-            bool external_perimeter = boost::contains(sline, ";_EXTERNAL_PERIMETER");
-            bool wipe               = boost::contains(sline, ";_WIPE");
+            // The cooling markers are G-code comments, look for them in the comment only.
+            bool external_perimeter = contains(comment, sline_end, ";_EXTERNAL_PERIMETER");
+            bool wipe               = contains(comment, sline_end, ";_WIPE");
             if (external_perimeter)
                 line.type |= CoolingLine::TYPE_EXTERNAL_PERIMETER;
             if (wipe)
                 line.type |= CoolingLine::TYPE_WIPE;
-            if (boost::contains(sline, ";_EXTRUDE_SET_SPEED") && ! wipe) {
+            if (contains(comment, sline_end, ";_EXTRUDE_SET_SPEED") && ! wipe) {
                 line.type |= CoolingLine::TYPE_ADJUSTABLE;
                 active_speed_modifier = adjustment->lines.size();
             }
@@ -411,12 +439,12 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     line.type = 0;
                 }
             }
-            current_pos = std::move(new_pos);
-        } else if (boost::starts_with(sline, ";_EXTRUDE_END")) {
+            std::copy(new_pos, new_pos + 5, current_pos.begin());
+        } else if (starts_with(line_start, sline_end, ";_EXTRUDE_END")) {
             line.type = CoolingLine::TYPE_EXTRUDE_END;
             active_speed_modifier = size_t(-1);
-        } else if (boost::starts_with(sline, toolchange_prefix)) {
-            unsigned int new_extruder = (unsigned int)atoi(sline.c_str() + toolchange_prefix.size());
+        } else if (starts_with(line_start, sline_end, toolchange_prefix.c_str())) {
+            unsigned int new_extruder = (unsigned int)atoi(line_start + toolchange_prefix.size());
             // Only change extruder in case the number is meaningful. User could provide an out-of-range index through custom gcodes - those shall be ignored.
             if (new_extruder < map_extruder_to_per_extruder_adjustment.size()) {
                 if (new_extruder != current_extruder) {
@@ -429,21 +457,21 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
             else {
                 // Only log the error in case of MM printer. Single extruder printers likely ignore any T anyway.
                 if (map_extruder_to_per_extruder_adjustment.size() > 1)
-                    BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << sline;
+                    BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << std::string(line_start, sline_end);
             }
 
-        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_START")) {
+        } else if (starts_with(line_start, sline_end, ";_BRIDGE_FAN_START")) {
             line.type = CoolingLine::TYPE_BRIDGE_FAN_START;
-        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_END")) {
+        } else if (starts_with(line_start, sline_end, ";_BRIDGE_FAN_END")) {
             line.type = CoolingLine::TYPE_BRIDGE_FAN_END;
-        } else if (boost::starts_with(sline, "G4 ")) {
-            // Parse the wait time.
+        } else if (starts_with(line_start, sline_end, "G4 ")) {
+            // Parse the wait time, S in seconds or P in milliseconds.
             line.type = CoolingLine::TYPE_G4;
-            size_t pos_S = sline.find('S', 3);
-            size_t pos_P = sline.find('P', 3);
+            const char *pos_S = std::find(line_start + 3, comment, 'S');
+            const char *pos_P = std::find(line_start + 3, comment, 'P');
             line.time = line.time_max = float(
-                (pos_S > 0) ? atof(sline.c_str() + pos_S + 1) :
-                (pos_P > 0) ? atof(sline.c_str() + pos_P + 1) * 0.001 : 0.);
+                (pos_S != comment) ? atof(pos_S + 1) :
+                (pos_P != comment) ? atof(pos_P + 1) * 0.001 : 0.);
         }
         if (line.type != 0)
             adjustment->lines.emplace_back(std::move(line));
@@ -736,14 +764,18 @@ std::string CoolingBuffer::apply_layer_cooldown(
         } else if (line->type & CoolingLine::TYPE_EXTRUDE_END) {
             // Just remove this comment.
         } else if (line->type & (CoolingLine::TYPE_ADJUSTABLE | CoolingLine::TYPE_EXTERNAL_PERIMETER | CoolingLine::TYPE_WIPE | CoolingLine::TYPE_HAS_F)) {
-            // Find the start of a comment, or roll to the end of line.
-            const char *end = line_start;
-            for (; end < line_end && *end != ';'; ++ end);
-            // Find the 'F' word.
-            const char *fpos            = strstr(line_start + 2, " F") + 2;
+            // The start of a comment, or the end of line.
+            const char *end = gcode.c_str() + line->comment_start;
+            if (line->feedrate_start == size_t(-1)) {
+                // There is no F word to adjust, keep the line as it is.
+                new_gcode.append(line_start, line_end - line_start);
+                pos = line_end;
+                continue;
+            }
+            // The value of the 'F' word.
+            const char *fpos            = gcode.c_str() + line->feedrate_start;
             int         new_feedrate    = current_feedrate;
             bool        modify          = false;
-            assert(fpos != nullptr);
             if (line->slowdown) {
                 modify       = true;
                 new_feedrate = int(floor(60. * line->feedrate + 0.5));
@@ -789,13 +821,23 @@ std::string CoolingBuffer::apply_layer_cooldown(
             if (end < line_end) {
                 if (line->type & (CoolingLine::TYPE_ADJUSTABLE | CoolingLine::TYPE_EXTERNAL_PERIMETER | CoolingLine::TYPE_WIPE)) {
                     // Process comments, remove ";_EXTRUDE_SET_SPEED", ";_EXTERNAL_PERIMETER", ";_WIPE"
-                    std::string comment(end, line_end);
-                    boost::replace_all(comment, ";_EXTRUDE_SET_SPEED", "");
-                    if (line->type & CoolingLine::TYPE_EXTERNAL_PERIMETER)
-                        boost::replace_all(comment, ";_EXTERNAL_PERIMETER", "");
-                    if (line->type & CoolingLine::TYPE_WIPE)
-                        boost::replace_all(comment, ";_WIPE", "");
-                    new_gcode += comment;
+                    static const std::string marker_set_speed         = ";_EXTRUDE_SET_SPEED";
+                    static const std::string marker_external_perimeter = ";_EXTERNAL_PERIMETER";
+                    static const std::string marker_wipe              = ";_WIPE";
+                    auto skip_marker = [line_end](const char *c, const std::string &marker) {
+                        return size_t(line_end - c) >= marker.size() && std::equal(marker.begin(), marker.end(), c) ? c + marker.size() : c;
+                    };
+                    for (const char *c = end; c < line_end;) {
+                        const char *next = skip_marker(c, marker_set_speed);
+                        if (next == c && (line->type & CoolingLine::TYPE_EXTERNAL_PERIMETER))
+                            next = skip_marker(c, marker_external_perimeter);
+                        if (next == c && (line->type & CoolingLine::TYPE_WIPE))
+                            next = skip_marker(c, marker_wipe);
+                        if (next == c)
+                            new_gcode += *c ++;
+                        else
+                            c = next;
+                    }
                 } else {
                     // Just attach the rest of the source line.
                     new_gcode.append(end, line_end - end);
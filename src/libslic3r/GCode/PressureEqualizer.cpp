@@ -7,6 +7,8 @@
 
 #include "PressureEqualizer.hpp"
 
+#include <boost/log/trivial.hpp>
+
 namespace Slic3r {
 
 PressureEqualizer::PressureEqualizer(const Slic3r::GCodeConfig *config) : 
@@ -113,15 +115,13 @@ const char* PressureEqualizer::process(const char *szGCode, bool flush)
         assert(circular_buffer_items == 0);
         circular_buffer_pos = 0;
 
-#if 1 
-        printf("Statistics: \n"); 
-        printf("Minimum volumetric extrusion rate: %f\n", m_stat.volumetric_extrusion_rate_min);
-        printf("Maximum volumetric extrusion rate: %f\n", m_stat.volumetric_extrusion_rate_max);
         if (m_stat.extrusion_length > 0)
             m_stat.volumetric_extrusion_rate_avg /= m_stat.extrusion_length;
-        printf("Average volumetric extrusion rate: %f\n", m_stat.volumetric_extrusion_rate_avg);
+        BOOST_LOG_TRIVIAL(debug) << "PressureEqualizer: volumetric extrusion rate"
+                                 << " min " << m_stat.volumetric_extrusion_rate_min
+                                 << " max " << m_stat.volumetric_extrusion_rate_max
+                                 << " avg " << m_stat.volumetric_extrusion_rate_avg << " mm^3/min";
         m_stat.reset();
-#endif
     } 
 
     return output_buffer.data();
@@ -200,7 +200,12 @@ bool PressureEqualizer::process_line(const char *line, const size_t len, GCodeLi
     // Parse the G-code line, store the result into the buf.
     switch (toupper(*line ++)) {
     case 'G': {
-        int gcode = parse_int(line);
+        char *endptr = nullptr;
+        int gcode = int(strtol(line, &endptr, 10));
+        if (endptr == line || ! is_ws_or_eol(*endptr))
+            // Not an integer G-code number, for example a G29.1 of a custom G-code. Ignore the line.
+            break;
+        line = endptr;
         eatws(line);
         switch (gcode) {
         case 0:
@@ -262,14 +267,8 @@ bool PressureEqualizer::process_line(const char *line, const size_t len, GCodeLi
                     buf.volumetric_extrusion_rate_start = rate;
                     buf.volumetric_extrusion_rate_end   = rate;
                     m_stat.update(rate, sqrt(len2));
-                    if (rate < 40.f) {
-                    	printf("Extremely low flow rate: %f. Line %d, Length: %f, extrusion: %f Old position: (%f, %f, %f), new position: (%f, %f, %f)\n", 
-                            rate, 
-                            int(line_idx),
-                            sqrt(len2), sqrt((diff[3]*diff[3])/len2),
-                            m_current_pos[0], m_current_pos[1], m_current_pos[2],
-                            new_pos[0], new_pos[1], new_pos[2]);
-                    }
+                    if (rate < 40.f)
+                        BOOST_LOG_TRIVIAL(trace) << "PressureEqualizer: Extremely low flow rate " << rate << " at line " << line_idx;
                 }
             } else if (changed[0] || changed[1] || changed[2]) {
                 // Moving without extrusion.
@@ -323,16 +322,10 @@ bool PressureEqualizer::process_line(const char *line, const size_t len, GCodeLi
         }
         break;
     }
-    case 'M': {
-        int mcode = parse_int(line);
-        eatws(line);
-        switch (mcode) {
-        default:
-            // Ignore the rest of the M-codes.
+    case 'M':
+        // Ignore the M-codes. They are not parsed, as the custom G-codes contain M-codes
+        // with decimal numbers, for example M862.3.
         break;
-        }
-        break;
-    }
     case 'T':
     {
         // Activate an extruder head.
@@ -396,8 +389,8 @@ void PressureEqualizer::output_gcode_line(GCodeLine &line)
         float l_steady = 0.f;
         if (t_acc < t_total) {
             // One may achieve higher print speeds if part of the segment is not speed limited.
-            float l_acc    = t_acc * feed_avg;
-            float l_steady = l - l_acc;
+            l_acc    = t_acc * feed_avg;
+            l_steady = l - l_acc;
             if (l_steady < 0.5f * m_max_segment_length) {
                 l_acc    = l;
                 l_steady = 0.f;
@@ -428,15 +421,16 @@ void PressureEqualizer::output_gcode_line(GCodeLine &line)
                 }
                 push_line_to_output(line, pos_start[4], comment);
                 comment = NULL;
-                memcpy(line.pos_start, line.pos_end, sizeof(float)*5);
-                memcpy(pos_start, line.pos_end, sizeof(float)*5);
+                // Decelerate from the start feed rate over the rest of the segment.
+                memcpy(line.pos_start, line.pos_end, sizeof(float)*4);
+                memcpy(pos_start, line.pos_end, sizeof(float)*4);
             }
         }
-        // Split the segment into pieces.
-        for (size_t i = 1; i < nSegments; ++ i) {
+        // Split the segment into pieces, the last piece ends exactly at the end of the accelerated / decelerated part.
+        for (size_t i = 1; i <= nSegments; ++ i) {
             float t = float(i) / float(nSegments);
             for (size_t j = 0; j < 4; ++ j) {
-                line.pos_end[j] = pos_start[j] + (pos_end[j] - pos_start[j]) * t;
+                line.pos_end[j] = (i == nSegments) ? pos_end[j] : pos_start[j] + (pos_end[j] - pos_start[j]) * t;
                 line.pos_provided[j] = true;
             } 
             // Interpolate the feed rate at the center of the segment.
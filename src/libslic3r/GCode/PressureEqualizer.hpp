@@ -9,6 +9,17 @@ namespace Slic3r {
 
 // Processes a G-code. Finds changes in the volumetric extrusion speed and adjusts the transitions
 // between these paths to limit fast changes in the volumetric extrusion speed.
+//
+// Note: The pressure equalizer is currently disabled. It is not compiled (see libslic3r/CMakeLists.txt) and HAS_PRESSURE_EQUALIZER
+// is not defined, therefore PrintConfig does not define the max_volumetric_extrusion_rate_slope_positive
+// and max_volumetric_extrusion_rate_slope_negative options, which the equalizer is configured with.
+// Before it is revived, the following shall be considered:
+// - The G-code lines are kept in a circular buffer of the last 100 lines, and each new line adjusts the extrusion rate slopes
+//   backwards over the whole buffer. The output of a line depends on the 100 lines following it, likely over a layer boundary.
+//   Therefore layers could only be processed in parallel if each layer block was extended by the head of the next layer
+//   and the tail of the previous layer, with the overlapping lines dropped from the output.
+// - The G-code is parsed from text, which the G-code generator formatted just before. The extrusion segments could be handed over
+//   in a structured form instead, however the custom G-code sections would still have to be parsed.
 class PressureEqualizer
 {
 public:
@@ -54,7 +65,7 @@ private:
         float positive;
         float negative;
     };
-    enum { numExtrusionRoles = erSupportMaterialInterface + 1 };
+    enum { numExtrusionRoles = erCount };
     ExtrusionRateSlope              m_max_volumetric_extrusion_rate_slopes[numExtrusionRoles];
     float                           m_max_volumetric_extrusion_rate_slope_positive;
     float                           m_max_volumetric_extrusion_rate_slope_negative;
@@ -20,10 +20,49 @@ std::vector<unsigned char> Color::as_bytes() const
     return ret;
 }
 
-GCodePreviewData::Extrusion::Layer::Layer(float z, const Paths& paths)
-    : z(z)
-    , paths(paths)
-{
+GCodePreviewData::Extrusion::Path GCodePreviewData::Extrusion::Layer::path(size_t idx) const
+{
+    Path path;
+    path.points_begin   = this->points.data() + (idx == 0 ? 0 : this->path_ends[idx - 1]);
+    path.points_end     = this->points.data() + this->path_ends[idx];
+    path.extrusion_role = ExtrusionRole(this->extrusion_roles[idx]);
+    path.mm3_per_mm     = this->mm3_per_mm[idx];
+    path.width          = this->widths[idx];
+    path.height         = this->heights[idx];
+    path.feedrate       = this->feedrates[idx];
+    path.extruder_id    = this->extruder_ids[idx];
+    path.cp_color_id    = this->cp_color_ids[idx];
+    path.fan_speed      = this->fan_speeds[idx];
+    return path;
+}
+
+void GCodePreviewData::Extrusion::Layer::close_path(const Path &path)
+{
+    assert(path.extrusion_role < 256);
+    this->path_ends.emplace_back(uint32_t(this->points.size()));
+    this->extrusion_roles.emplace_back((unsigned char)path.extrusion_role);
+    this->mm3_per_mm.emplace_back(path.mm3_per_mm);
+    this->widths.emplace_back(path.width);
+    this->heights.emplace_back(path.height);
+    this->feedrates.emplace_back(path.feedrate);
+    this->extruder_ids.emplace_back(path.extruder_id);
+    this->cp_color_ids.emplace_back(path.cp_color_id);
+    this->fan_speeds.emplace_back(path.fan_speed);
+}
+
+size_t GCodePreviewData::Extrusion::Layer::memory_used() const
+{
+    return
+        SLIC3R_STDVEC_MEMSIZE(this->points,          Point) +
+        SLIC3R_STDVEC_MEMSIZE(this->path_ends,       uint32_t) +
+        SLIC3R_STDVEC_MEMSIZE(this->extrusion_roles, unsigned char) +
+        SLIC3R_STDVEC_MEMSIZE(this->mm3_per_mm,      float) +
+        SLIC3R_STDVEC_MEMSIZE(this->widths,          float) +
+        SLIC3R_STDVEC_MEMSIZE(this->heights,         float) +
+        SLIC3R_STDVEC_MEMSIZE(this->feedrates,       float) +
+        SLIC3R_STDVEC_MEMSIZE(this->extruder_ids,    uint32_t) +
+        SLIC3R_STDVEC_MEMSIZE(this->cp_color_ids,    uint32_t) +
+        SLIC3R_STDVEC_MEMSIZE(this->fan_speeds,      float);
 }
 
 GCodePreviewData::Travel::Polyline::Polyline(EType type, EDirection direction, float feedrate, unsigned int extruder_id, const Polyline3& polyline)
@@ -159,11 +198,8 @@ size_t GCodePreviewData::Extrusion::memory_used() const
 {
     size_t out = sizeof(*this);
     out += SLIC3R_STDVEC_MEMSIZE(this->layers, Layer);
-    for (const Layer &layer : this->layers) {
-        out += SLIC3R_STDVEC_MEMSIZE(layer.paths, Path);
-        for (const Path &path : layer.paths)
-			out += SLIC3R_STDVEC_MEMSIZE(path.polyline.points, Point);
-    }
+    for (const Layer &layer : this->layers)
+        out += layer.memory_used();
 	return out;
 }
 
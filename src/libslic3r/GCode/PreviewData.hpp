@@ -234,10 +234,13 @@ public:
         static const std::string Default_Extrusion_Role_Names[erCount];
         static const EViewType Default_View_Type;
 
+		// Read only view of a single extrusion path stored in a Layer.
 		class Path
 		{
 		public:
-		    Polyline 		polyline;
+		    // Vertices of the path, pointing into Layer::points.
+		    const Point    *points_begin;
+		    const Point    *points_end;
 		    ExtrusionRole 	extrusion_role;
 		    // Volumetric velocity. mm^3 of plastic per mm of linear head motion. Used by the G-code generator.
 		    float			mm3_per_mm;
@@ -253,15 +256,38 @@ public:
 		    uint32_t	 	cp_color_id;
 		    // Fan speed for the extrusion, used for visualization purposes.
 		    float 			fan_speed;
+
+		    size_t          size() const { return points_end - points_begin; }
 		};
-		using Paths = std::vector<Path>;
 
+        // Extrusion paths of a single layer stored column wise: the vertices of all the paths in a single array
+        // and the attributes of the paths in parallel arrays indexed by the path index.
+        // Compared to a Polyline with its attributes per path, this saves a heap allocation and the vector overhead per path.
         struct Layer
         {
             float z;
-            Paths paths;
-
-            Layer(float z, const Paths& paths);
+            // Vertices of all the paths of this layer. Path i spans points [path_ends[i - 1], path_ends[i]), the first path starts at zero.
+            Points                      points;
+            std::vector<uint32_t>       path_ends;
+            std::vector<unsigned char>  extrusion_roles;
+            std::vector<float>          mm3_per_mm;
+            std::vector<float>          widths;
+            std::vector<float>          heights;
+            std::vector<float>          feedrates;
+            std::vector<uint32_t>       extruder_ids;
+            std::vector<uint32_t>       cp_color_ids;
+            std::vector<float>          fan_speeds;
+
+            explicit Layer(float z) : z(z) {}
+
+            size_t paths_count() const { return path_ends.size(); }
+            Path   path(size_t idx) const;
+            // Close the path formed by the points appended to this->points since the end of the previous path.
+            // The attributes are taken from the path, its vertex pointers are ignored.
+            void   close_path(const Path &path);
+
+            // Return an estimate of the memory consumed by this layer.
+            size_t memory_used() const;
         };
 
         typedef std::vector<Layer> LayersList;
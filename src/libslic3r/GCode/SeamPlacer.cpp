@@ -0,0 +1,265 @@
+#include "SeamPlacer.hpp"
+
+#include "../EdgeGrid.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace Slic3r {
+
+static float extrudate_overlap_penalty(float nozzle_r, float weight_zero, float overlap_distance)
+{
+    // The extrudate is not fully supported by the lower layer. Fit a polynomial penalty curve.
+    // Solved by sympy package:
+/*
+from sympy import *
+(x,a,b,c,d,r,z)=symbols('x a b c d r z')
+p = a + b*x + c*x*x + d*x*x*x
+p2 = p.subs(solve([p.subs(x, -r), p.diff(x).subs(x, -r), p.diff(x,x).subs(x, -r), p.subs(x, 0)-z], [a, b, c, d]))
+from sympy.plotting import plot
+plot(p2.subs(r,0.2).subs(z,1.), (x, -1, 3), adaptive=False, nb_of_points=400)
+*/
+    if (overlap_distance < - nozzle_r) {
+        // The extrudate is fully supported by the lower layer. This is the ideal case, therefore zero penalty.
+        return 0.f;
+    } else {
+        float x  = overlap_distance / nozzle_r;
+        float x2 = x * x;
+        float x3 = x2 * x;
+        return weight_zero * (1.f + 3.f * x + 3.f * x2 + x3);
+    }
+}
+
+std::vector<float> polygon_parameter_by_length(const Polygon &polygon)
+{
+    // Parametrize the polygon by its length.
+    std::vector<float> lengths(polygon.points.size()+1, 0.);
+    for (size_t i = 1; i < polygon.points.size(); ++ i)
+        lengths[i] = lengths[i-1] + (polygon.points[i] - polygon.points[i-1]).cast<float>().norm();
+    lengths.back() = lengths[lengths.size()-2] + (polygon.points.front() - polygon.points.back()).cast<float>().norm();
+    return lengths;
+}
+
+std::vector<float> polygon_angles_at_vertices(const Polygon &polygon, const std::vector<float> &lengths, float min_arm_length)
+{
+    assert(polygon.points.size() + 1 == lengths.size());
+    if (min_arm_length > 0.25f * lengths.back())
+        min_arm_length = 0.25f * lengths.back();
+
+    // Find the initial prev / next point span.
+    size_t idx_prev = polygon.points.size();
+    size_t idx_curr = 0;
+    size_t idx_next = 1;
+    while (idx_prev > idx_curr && lengths.back() - lengths[idx_prev] < min_arm_length)
+        -- idx_prev;
+    while (idx_next < idx_prev && lengths[idx_next] < min_arm_length)
+        ++ idx_next;
+
+    std::vector<float> angles(polygon.points.size(), 0.f);
+    for (; idx_curr < polygon.points.size(); ++ idx_curr) {
+        // Move idx_prev up until the distance between idx_prev and idx_curr is lower than min_arm_length.
+        if (idx_prev >= idx_curr) {
+            while (idx_prev < polygon.points.size() && lengths.back() - lengths[idx_prev] + lengths[idx_curr] > min_arm_length)
+                ++ idx_prev;
+            if (idx_prev == polygon.points.size())
+                idx_prev = 0;
+        }
+        while (idx_prev < idx_curr && lengths[idx_curr] - lengths[idx_prev] > min_arm_length)
+            ++ idx_prev;
+        // Move idx_prev one step back.
+        if (idx_prev == 0)
+            idx_prev = polygon.points.size() - 1;
+        else
+            -- idx_prev;
+        // Move idx_next up until the distance between idx_curr and idx_next is greater than min_arm_length.
+        if (idx_curr <= idx_next) {
+            while (idx_next < polygon.points.size() && lengths[idx_next] - lengths[idx_curr] < min_arm_length)
+                ++ idx_next;
+            if (idx_next == polygon.points.size())
+                idx_next = 0;
+        }
+        while (idx_next < idx_curr && lengths.back() - lengths[idx_curr] + lengths[idx_next] < min_arm_length)
+            ++ idx_next;
+        // Calculate angle between idx_prev, idx_curr, idx_next.
+        const Point &p0 = polygon.points[idx_prev];
+        const Point &p1 = polygon.points[idx_curr];
+        const Point &p2 = polygon.points[idx_next];
+        const Point  v1 = p1 - p0;
+        const Point  v2 = p2 - p1;
+		int64_t dot   = int64_t(v1(0))*int64_t(v2(0)) + int64_t(v1(1))*int64_t(v2(1));
+		int64_t cross = int64_t(v1(0))*int64_t(v2(1)) - int64_t(v1(1))*int64_t(v2(0));
+		float angle = float(atan2(double(cross), double(dot)));
+        angles[idx_curr] = angle;
+    }
+
+    return angles;
+}
+
+float polygon_angle_at_vertex(const Polygon &polygon, const std::vector<float> &lengths, size_t idx, float min_arm_length)
+{
+    assert(polygon.points.size() + 1 == lengths.size());
+    assert(idx < polygon.points.size());
+    if (min_arm_length > 0.25f * lengths.back())
+        min_arm_length = 0.25f * lengths.back();
+
+    const size_t num_points = polygon.points.size();
+    // The closest vertex before idx, which is more than min_arm_length away.
+    size_t idx_prev = idx;
+    do {
+        idx_prev = (idx_prev == 0) ? num_points - 1 : idx_prev - 1;
+    } while (idx_prev != idx && ((idx_prev < idx) ? lengths[idx] - lengths[idx_prev] : lengths.back() - lengths[idx_prev] + lengths[idx]) <= min_arm_length);
+    // The closest vertex after idx, which is at least min_arm_length away.
+    size_t idx_next = idx;
+    do {
+        idx_next = (idx_next + 1 == num_points) ? 0 : idx_next + 1;
+    } while (idx_next != idx && ((idx_next > idx) ? lengths[idx_next] - lengths[idx] : lengths.back() - lengths[idx] + lengths[idx_next]) < min_arm_length);
+
+    // Calculate angle between idx_prev, idx, idx_next.
+    const Point &p0 = polygon.points[idx_prev];
+    const Point &p1 = polygon.points[idx];
+    const Point &p2 = polygon.points[idx_next];
+    const Point  v1 = p1 - p0;
+    const Point  v2 = p2 - p1;
+    int64_t dot   = int64_t(v1(0))*int64_t(v2(0)) + int64_t(v1(1))*int64_t(v2(1));
+    int64_t cross = int64_t(v1(0))*int64_t(v2(1)) - int64_t(v1(1))*int64_t(v2(0));
+    return float(atan2(double(cross), double(dot)));
+}
+
+// Penalty for a visible seam at a vertex with a counter clockwise angle ccwAngle.
+static float seam_visibility_penalty(float ccwAngle)
+{
+    // No penalty for reflex points, slight penalty for convex points, high penalty for flat surfaces.
+    const float penaltyConvexVertex = 1.f;
+    const float penaltyFlatSurface  = 5.f;
+    float penalty = 0;
+//    if (ccwAngle <- float(PI/3.))
+    if (ccwAngle <- float(0.6 * PI))
+        // Sharp reflex vertex. We love that, it hides the seam perfectly.
+        penalty = 0.f;
+//    else if (ccwAngle > float(PI/3.))
+    else if (ccwAngle > float(0.6 * PI))
+        // Seams on sharp convex vertices are more visible than on reflex vertices.
+        penalty = penaltyConvexVertex;
+    else if (ccwAngle < 0.f) {
+        // Interpolate penalty between maximum and zero.
+        penalty = penaltyFlatSurface * bspline_kernel(ccwAngle * float(PI * 2. / 3.));
+    } else {
+        assert(ccwAngle >= 0.f);
+        // Interpolate penalty between maximum and the penalty for a convex vertex.
+        penalty = penaltyConvexVertex + (penaltyFlatSurface - penaltyConvexVertex) * bspline_kernel(ccwAngle * float(PI * 2. / 3.));
+    }
+    return penalty;
+}
+
+// Penalty for a seam at an overhang, using the edge grid distance field structure over the lower layer.
+static float seam_overhang_penalty(const Point &p, float nozzle_dmr, const EdgeGrid::Grid &lower_layer_edge_grid)
+{
+    const float penaltyOverhangHalf = 10.f;
+    coord_t nozzle_r = coord_t(floor(scale_(0.5 * nozzle_dmr) + 0.5));
+    coord_t search_r = coord_t(floor(scale_(0.8 * nozzle_dmr) + 0.5));
+    coordf_t dist;
+    // Signed distance is positive outside the object, negative inside the object.
+    // The point is considered at an overhang, if it is more than nozzle radius
+    // outside of the lower layer contour.
+    #ifdef NDEBUG // to suppress unused variable warning in release mode
+        lower_layer_edge_grid.signed_distance(p, search_r, dist);
+    #else
+        bool found = lower_layer_edge_grid.signed_distance(p, search_r, dist);
+    #endif
+    // If the approximate Signed Distance Field was initialized over lower_layer_edge_grid,
+    // then the signed distnace shall always be known.
+    assert(found);
+    return extrudate_overlap_penalty(float(nozzle_r), penaltyOverhangHalf, float(dist));
+}
+
+std::vector<SeamPenalty> seam_penalties_at_vertices(
+    const Polygon &polygon, const std::vector<float> &lengths, bool was_clockwise, float nozzle_dmr, const EdgeGrid::Grid *lower_layer_edge_grid)
+{
+    const coord_t nozzle_r = coord_t(scale_(0.5 * nozzle_dmr) + 0.5);
+
+    // First calculate the angles. The angles are caluculated over a minimum arm length of nozzle_r.
+    std::vector<float>       angles = polygon_angles_at_vertices(polygon, lengths, float(nozzle_r));
+    std::vector<SeamPenalty> penalties(polygon.points.size());
+    // Penalty for visible seams.
+    for (size_t i = 0; i < polygon.points.size(); ++ i)
+        penalties[i].visibility = seam_visibility_penalty(was_clockwise ? - angles[i] : angles[i]);
+
+    // Penalty for overhangs.
+    if (lower_layer_edge_grid != nullptr)
+        for (size_t i = 0; i < polygon.points.size(); ++ i)
+            penalties[i].overhang = seam_overhang_penalty(polygon.points[i], nozzle_dmr, *lower_layer_edge_grid);
+
+    return penalties;
+}
+
+SeamPenalty seam_penalty_at_vertex(
+    const Polygon &polygon, const std::vector<float> &lengths, size_t idx, bool was_clockwise, float nozzle_dmr, const EdgeGrid::Grid *lower_layer_edge_grid)
+{
+    const coord_t nozzle_r = coord_t(scale_(0.5 * nozzle_dmr) + 0.5);
+    const float   angle    = polygon_angle_at_vertex(polygon, lengths, idx, float(nozzle_r));
+    SeamPenalty   penalty;
+    penalty.visibility = seam_visibility_penalty(was_clockwise ? - angle : angle);
+    if (lower_layer_edge_grid != nullptr)
+        penalty.overhang = seam_overhang_penalty(polygon.points[idx], nozzle_dmr, *lower_layer_edge_grid);
+    return penalty;
+}
+
+void insert_seam_penalty(
+    std::vector<SeamPenalty> &penalties, const Polygon &polygon, const std::vector<float> &lengths, size_t idx, bool was_clockwise, float nozzle_dmr, const EdgeGrid::Grid *lower_layer_edge_grid)
+{
+    assert(penalties.size() + 1 == polygon.points.size());
+    penalties.insert(penalties.begin() + idx, seam_penalty_at_vertex(polygon, lengths, idx, was_clockwise, nozzle_dmr, lower_layer_edge_grid));
+
+    // The angles of the vertices close to the inserted point may be measured over the inserted point now.
+    // Their overhang penalties do not change.
+    const size_t  num_points     = polygon.points.size();
+    const coord_t nozzle_r       = coord_t(scale_(0.5 * nozzle_dmr) + 0.5);
+    const float   min_arm_length = std::min(float(nozzle_r), 0.25f * lengths.back());
+    auto distance = [&lengths](size_t from, size_t to) {
+        return (from <= to) ? lengths[to] - lengths[from] : lengths.back() - lengths[from] + lengths[to];
+    };
+    auto update = [&](size_t i) {
+        float angle = polygon_angle_at_vertex(polygon, lengths, i, float(nozzle_r));
+        penalties[i].visibility = seam_visibility_penalty(was_clockwise ? - angle : angle);
+    };
+    const size_t idx_prev = (idx == 0) ? num_points - 1 : idx - 1;
+    const size_t idx_next = (idx + 1 == num_points) ? 0 : idx + 1;
+    for (size_t i = idx_prev; i != idx && distance(i, idx_prev) <= min_arm_length; i = (i == 0) ? num_points - 1 : i - 1)
+        update(i);
+    for (size_t i = idx_next; i != idx && distance(idx_next, i) <= min_arm_length; i = (i + 1 == num_points) ? 0 : i + 1)
+        update(i);
+}
+
+void make_seam_penalties(ExtrusionEntityCollection &collection, float nozzle_dmr, const EdgeGrid::Grid *lower_layer_edge_grid)
+{
+    for (ExtrusionEntity *ee : collection.entities) {
+        if (ee->is_collection()) {
+            make_seam_penalties(*static_cast<ExtrusionEntityCollection*>(ee), nozzle_dmr, lower_layer_edge_grid);
+        } else if (ExtrusionLoop *loop = dynamic_cast<ExtrusionLoop*>(ee); loop != nullptr) {
+            // Evaluate the penalties over the counter clockwise oriented copy of the loop, the same way GCode::extrude_loop() does.
+            Polygon polygon       = loop->polygon();
+            bool    was_clockwise = polygon.is_clockwise();
+            if (was_clockwise) {
+                // Reverse the same way ExtrusionLoop::reverse() does, keeping the first point.
+                std::reverse(polygon.points.begin() + 1, polygon.points.end());
+            }
+            loop->seam_penalties            = seam_penalties_at_vertices(polygon, polygon_parameter_by_length(polygon), was_clockwise, nozzle_dmr, lower_layer_edge_grid);
+            loop->seam_penalties_nozzle_dmr = nozzle_dmr;
+        }
+    }
+}
+
+void clear_seam_penalties(ExtrusionEntityCollection &collection)
+{
+    for (ExtrusionEntity *ee : collection.entities) {
+        if (ee->is_collection())
+            clear_seam_penalties(*static_cast<ExtrusionEntityCollection*>(ee));
+        else if (ExtrusionLoop *loop = dynamic_cast<ExtrusionLoop*>(ee); loop != nullptr) {
+            loop->seam_penalties.clear();
+            loop->seam_penalties.shrink_to_fit();
+        }
+    }
+}
+
+} // namespace Slic3r
@@ -0,0 +1,67 @@
+// Seam placement penalties of extrusion loops.
+// The position independent part of the penalties is calculated for the perimeters of all layers in parallel
+// by PrintObject::make_seams(), the G-code export only adds the penalty of the distance to the preferred seam position.
+
+#ifndef slic3r_SeamPlacer_hpp_
+#define slic3r_SeamPlacer_hpp_
+
+#include "../libslic3r.h"
+#include "../ExtrusionEntity.hpp"
+#include "../ExtrusionEntityCollection.hpp"
+#include "../Polygon.hpp"
+
+#include <vector>
+
+namespace Slic3r {
+
+namespace EdgeGrid {
+    class Grid;
+}
+
+// Return a value in <0, 1> of a cubic B-spline kernel centered around zero.
+// The B-spline is re-scaled so it has value 1 at zero.
+inline float bspline_kernel(float x)
+{
+    x = std::abs(x);
+	if (x < 1.f) {
+		return 1.f - (3.f / 2.f) * x * x + (3.f / 4.f) * x * x * x;
+	}
+	else if (x < 2.f) {
+		x -= 1.f;
+		float x2 = x * x;
+		float x3 = x2 * x;
+		return (1.f / 4.f) - (3.f / 4.f) * x + (3.f / 4.f) * x2 - (1.f / 4.f) * x3;
+	}
+	else
+        return 0;
+}
+
+// Parametrize the polygon by its length. The last value is the length of the closed polygon.
+std::vector<float> polygon_parameter_by_length(const Polygon &polygon);
+// Angles at the polygon vertices, calculated over a minimum arm length of min_arm_length.
+std::vector<float> polygon_angles_at_vertices(const Polygon &polygon, const std::vector<float> &lengths, float min_arm_length);
+// Angle at a single polygon vertex, the same as polygon_angles_at_vertices() calculates for that vertex.
+float polygon_angle_at_vertex(const Polygon &polygon, const std::vector<float> &lengths, size_t idx, float min_arm_length);
+
+// Calculate the position independent seam penalties at the vertices of a counter clockwise oriented loop polygon.
+// was_clockwise: the loop was oriented clockwise before it was made counter clockwise, thus it is a hole.
+// lower_layer_edge_grid: edge grid with a signed distance field over the lower layer to penalize overhangs, may be null.
+std::vector<SeamPenalty> seam_penalties_at_vertices(
+    const Polygon &polygon, const std::vector<float> &lengths, bool was_clockwise, float nozzle_dmr, const EdgeGrid::Grid *lower_layer_edge_grid);
+
+// Calculate the position independent seam penalty at a single vertex, the same as seam_penalties_at_vertices() calculates for that vertex.
+SeamPenalty seam_penalty_at_vertex(
+    const Polygon &polygon, const std::vector<float> &lengths, size_t idx, bool was_clockwise, float nozzle_dmr, const EdgeGrid::Grid *lower_layer_edge_grid);
+// Update the penalties of a loop polygon after the vertex idx was inserted into it, so that they are the same
+// as seam_penalties_at_vertices() would calculate for the polygon with the vertex inserted.
+void insert_seam_penalty(
+    std::vector<SeamPenalty> &penalties, const Polygon &polygon, const std::vector<float> &lengths, size_t idx, bool was_clockwise, float nozzle_dmr, const EdgeGrid::Grid *lower_layer_edge_grid);
+
+// Calculate the position independent seam penalties of all loops of an extrusion entity collection, recursively.
+void make_seam_penalties(ExtrusionEntityCollection &collection, float nozzle_dmr, const EdgeGrid::Grid *lower_layer_edge_grid);
+// Drop the seam penalties of all loops of an extrusion entity collection, recursively.
+void clear_seam_penalties(ExtrusionEntityCollection &collection);
+
+} // namespace Slic3r
+
+#endif /* slic3r_SeamPlacer_hpp_ */
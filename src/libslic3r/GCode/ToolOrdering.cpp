@@ -13,6 +13,9 @@
 
 #include <cassert>
 #include <limits>
+#include <optional>
+
+#include <tbb/parallel_for.h>
 
 #include <libslic3r.h>
 
@@ -89,7 +92,7 @@ ToolOrdering::ToolOrdering(const PrintObject &object, unsigned int first_extrude
     }
 
     // Collect extruders reuqired to print the layers.
-    this->collect_extruders(object, std::vector<std::pair<double, unsigned int>>());
+    this->collect_extruders({ &object }, std::vector<std::pair<double, unsigned int>>());
 
     // Reorder the extruders to minimize tool switches.
     this->reorder_extruders(first_extruder);
@@ -141,8 +144,7 @@ ToolOrdering::ToolOrdering(const Print &print, unsigned int first_extruder, bool
 	}
 
     // Collect extruders reuqired to print the layers.
-    for (auto object : print.objects())
-        this->collect_extruders(*object, per_layer_extruder_switches);
+    this->collect_extruders(std::vector<const PrintObject*>(print.objects().begin(), print.objects().end()), per_layer_extruder_switches);
 
     // Reorder the extruders to minimize tool switches.
     this->reorder_extruders(first_extruder);
@@ -168,103 +170,128 @@ void ToolOrdering::initialize_layers(std::vector<coordf_t> &zs)
 }
 
 // Collect extruders reuqired to print layers.
-void ToolOrdering::collect_extruders(const PrintObject &object, const std::vector<std::pair<double, unsigned int>> &per_layer_extruder_switches)
+// The object and support layers are first assigned to their LayerTools by merging the sorted print_z sequences,
+// then the LayerTools are processed in parallel, each of them visiting just the layers printed at its print_z.
+void ToolOrdering::collect_extruders(const std::vector<const PrintObject*> &objects, const std::vector<std::pair<double, unsigned int>> &per_layer_extruder_switches)
 {
-    // Collect the support extruders.
-    for (auto support_layer : object.support_layers()) {
-        LayerTools   &layer_tools = this->tools_for_layer(support_layer->print_z);
-        ExtrusionRole role = support_layer->support_fills.role();
-        bool         has_support        = role == erMixed || role == erSupportMaterial;
-        bool         has_interface      = role == erMixed || role == erSupportMaterialInterface;
-        unsigned int extruder_support   = object.config().support_material_extruder.value;
-        unsigned int extruder_interface = object.config().support_material_interface_extruder.value;
-        if (has_support)
-            layer_tools.extruders.push_back(extruder_support);
-        if (has_interface)
-            layer_tools.extruders.push_back(extruder_interface);
-        if (has_support || has_interface)
-            layer_tools.has_support = true;
+    // Index of the LayerTools closest to print_z, searching upwards from idx. Both the LayerTools and the queried print_z are sorted,
+    // thus the whole sequence of layers of an object is mapped in linear time. Returns the same result as tools_for_layer().
+    auto next_layer_tools = [this](size_t idx, coordf_t print_z) {
+        for (; idx + 1 < m_layer_tools.size() && std::abs(m_layer_tools[idx + 1].print_z - print_z) < std::abs(m_layer_tools[idx].print_z - print_z); ++ idx) ;
+        assert(std::abs(m_layer_tools[idx].print_z - print_z) < EPSILON);
+        return idx;
+    };
+    std::vector<std::vector<std::pair<const PrintObject*, const SupportLayer*>>> support_layers(m_layer_tools.size());
+    for (LayerTools &layer_tools : m_layer_tools)
+        layer_tools.object_layers.clear();
+    for (const PrintObject *object : objects) {
+        size_t idx = 0;
+        for (const SupportLayer *support_layer : object->support_layers())
+            support_layers[idx = next_layer_tools(idx, support_layer->print_z)].emplace_back(object, support_layer);
+        idx = 0;
+        for (const Layer *layer : object->layers())
+            m_layer_tools[idx = next_layer_tools(idx, layer->print_z)].object_layers.emplace_back(layer);
     }
 
-    // Extruder overrides are ordered by print_z.
-    std::vector<std::pair<double, unsigned int>>::const_iterator it_per_layer_extruder_override;
-	it_per_layer_extruder_override = per_layer_extruder_switches.begin();
-    unsigned int extruder_override = 0;
-
-    // Collect the object extruders.
-    for (auto layer : object.layers()) {
-        LayerTools &layer_tools = this->tools_for_layer(layer->print_z);
-
-        // Override extruder with the next 
-    	for (; it_per_layer_extruder_override != per_layer_extruder_switches.end() && it_per_layer_extruder_override->first < layer->print_z + EPSILON; ++ it_per_layer_extruder_override)
-    		extruder_override = (int)it_per_layer_extruder_override->second;
-
-        // Store the current extruder override (set to zero if no overriden), so that layer_tools.wiping_extrusions().is_overridable_and_mark() will use it.
-        layer_tools.extruder_override = extruder_override;
-
-        // What extruders are required to print this object layer?
-        for (size_t region_id = 0; region_id < object.region_volumes.size(); ++ region_id) {
-            const LayerRegion *layerm = (region_id < layer->regions().size()) ? layer->regions()[region_id] : nullptr;
-            if (layerm == nullptr)
-                continue;
-            const PrintRegion &region = *object.print()->regions()[region_id];
-
-            if (! layerm->perimeters.entities.empty()) {
-                bool something_nonoverriddable = true;
-
-                if (m_print_config_ptr) { // in this case complete_objects is false (see ToolOrdering constructors)
-                    something_nonoverriddable = false;
-                    for (const auto& eec : layerm->perimeters.entities) // let's check if there are nonoverriddable entities
-                        if (!layer_tools.wiping_extrusions().is_overriddable_and_mark(dynamic_cast<const ExtrusionEntityCollection&>(*eec), *m_print_config_ptr, object, region))
-                            something_nonoverriddable = true;
-                }
-
-                if (something_nonoverriddable)
-               		layer_tools.extruders.emplace_back((extruder_override == 0) ? region.config().perimeter_extruder.value : extruder_override);
-
-                layer_tools.has_object = true;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, m_layer_tools.size()),
+        [this, &support_layers, &per_layer_extruder_switches](const tbb::blocked_range<size_t> &range) {
+        for (size_t layer_tools_idx = range.begin(); layer_tools_idx < range.end(); ++ layer_tools_idx) {
+            LayerTools &layer_tools = m_layer_tools[layer_tools_idx];
+
+            // Collect the support extruders.
+            for (const std::pair<const PrintObject*, const SupportLayer*> &support_layer : support_layers[layer_tools_idx]) {
+                const PrintObject &object = *support_layer.first;
+                ExtrusionRole role = support_layer.second->support_fills.role();
+                bool         has_support        = role == erMixed || role == erSupportMaterial;
+                bool         has_interface      = role == erMixed || role == erSupportMaterialInterface;
+                unsigned int extruder_support   = object.config().support_material_extruder.value;
+                unsigned int extruder_interface = object.config().support_material_interface_extruder.value;
+                if (has_support)
+                    layer_tools.extruders.push_back(extruder_support);
+                if (has_interface)
+                    layer_tools.extruders.push_back(extruder_interface);
+                if (has_support || has_interface)
+                    layer_tools.has_support = true;
             }
 
-            bool has_infill       = false;
-            bool has_solid_infill = false;
-            bool something_nonoverriddable = false;
-            for (const ExtrusionEntity *ee : layerm->fills.entities) {
-                // fill represents infill extrusions of a single island.
-                const auto *fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
-                ExtrusionRole role = fill->entities.empty() ? erNone : fill->entities.front()->role();
-                if (is_solid_infill(role))
-                    has_solid_infill = true;
-                else if (role != erNone)
-                    has_infill = true;
-
-                if (m_print_config_ptr) {
-                    if (! layer_tools.wiping_extrusions().is_overriddable_and_mark(*fill, *m_print_config_ptr, object, region))
-                        something_nonoverriddable = true;
-                }
+            if (! layer_tools.object_layers.empty()) {
+                // Override extruder with the last extruder switch at or below this layer. Extruder overrides are ordered by print_z.
+                auto it_per_layer_extruder_override = std::lower_bound(per_layer_extruder_switches.begin(), per_layer_extruder_switches.end(), layer_tools.print_z + EPSILON,
+                    [](const std::pair<double, unsigned int> &extruder_switch, double print_z) { return extruder_switch.first < print_z; });
+                // Store the current extruder override (set to zero if no overriden), so that layer_tools.wiping_extrusions().is_overridable_and_mark() will use it.
+                layer_tools.extruder_override = (it_per_layer_extruder_override == per_layer_extruder_switches.begin()) ? 0 : std::prev(it_per_layer_extruder_override)->second;
             }
+            unsigned int extruder_override = layer_tools.extruder_override;
+
+            // Collect the object extruders.
+            for (const Layer *layer : layer_tools.object_layers) {
+                const PrintObject &object = *layer->object();
+                // What extruders are required to print this object layer?
+                for (size_t region_id = 0; region_id < object.region_volumes.size(); ++ region_id) {
+                    const LayerRegion *layerm = (region_id < layer->regions().size()) ? layer->regions()[region_id] : nullptr;
+                    if (layerm == nullptr)
+                        continue;
+                    const PrintRegion &region = *object.print()->regions()[region_id];
+                    std::optional<WipingExtrusions::RegionExtruders> region_extruders;
+                    if (m_print_config_ptr) // in this case complete_objects is false (see ToolOrdering constructors)
+                        region_extruders.emplace(layer_tools, *m_print_config_ptr, object, region);
+
+                    if (! layerm->perimeters.entities.empty()) {
+                        bool something_nonoverriddable = true;
+
+                        if (region_extruders) {
+                            something_nonoverriddable = false;
+                            for (const auto& eec : layerm->perimeters.entities) // let's check if there are nonoverriddable entities
+                                if (!layer_tools.wiping_extrusions().is_overriddable_and_mark(dynamic_cast<const ExtrusionEntityCollection&>(*eec), *layer, region_id, true, *region_extruders))
+                                    something_nonoverriddable = true;
+                        }
+
+                        if (something_nonoverriddable)
+                            layer_tools.extruders.emplace_back((extruder_override == 0) ? region.config().perimeter_extruder.value : extruder_override);
+
+                        layer_tools.has_object = true;
+                    }
 
-            if (something_nonoverriddable || !m_print_config_ptr) {
-            	if (extruder_override == 0) {
-	                if (has_solid_infill)
-	                    layer_tools.extruders.emplace_back(region.config().solid_infill_extruder);
-	                if (has_infill)
-	                    layer_tools.extruders.emplace_back(region.config().infill_extruder);
-            	} else if (has_solid_infill || has_infill)
-            		layer_tools.extruders.emplace_back(extruder_override);
+                    bool has_infill       = false;
+                    bool has_solid_infill = false;
+                    bool something_nonoverriddable = false;
+                    for (const ExtrusionEntity *ee : layerm->fills.entities) {
+                        // fill represents infill extrusions of a single island.
+                        const auto *fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
+                        ExtrusionRole role = fill->entities.empty() ? erNone : fill->entities.front()->role();
+                        if (is_solid_infill(role))
+                            has_solid_infill = true;
+                        else if (role != erNone)
+                            has_infill = true;
+
+                        if (region_extruders) {
+                            if (! layer_tools.wiping_extrusions().is_overriddable_and_mark(*fill, *layer, region_id, false, *region_extruders))
+                                something_nonoverriddable = true;
+                        }
+                    }
+
+                    if (something_nonoverriddable || !m_print_config_ptr) {
+                        if (extruder_override == 0) {
+                            if (has_solid_infill)
+                                layer_tools.extruders.emplace_back(region.config().solid_infill_extruder);
+                            if (has_infill)
+                                layer_tools.extruders.emplace_back(region.config().infill_extruder);
+                        } else if (has_solid_infill || has_infill)
+                            layer_tools.extruders.emplace_back(extruder_override);
+                    }
+                    if (has_solid_infill || has_infill)
+                        layer_tools.has_object = true;
+                }
             }
-            if (has_solid_infill || has_infill)
-                layer_tools.has_object = true;
-        }
-    }
 
-    for (auto& layer : m_layer_tools) {
-        // Sort and remove duplicates
-        sort_remove_duplicates(layer.extruders);
+            // Sort and remove duplicates
+            sort_remove_duplicates(layer_tools.extruders);
 
-        // make sure that there are some tools for each object layer (e.g. tall wiping object will result in empty extruders vector)
-        if (layer.extruders.empty() && layer.has_object)
-            layer.extruders.emplace_back(0); // 0="dontcare" extruder - it will be taken care of in reorder_extruders
-    }
+            // make sure that there are some tools for each object layer (e.g. tall wiping object will result in empty extruders vector)
+            if (layer_tools.extruders.empty() && layer_tools.has_object)
+                layer_tools.extruders.emplace_back(0); // 0="dontcare" extruder - it will be taken care of in reorder_extruders
+        }
+    });
 }
 
 // Reorder extruders to minimize layer changes.
@@ -600,21 +627,44 @@ int WipingExtrusions::last_nonsoluble_extruder_on_layer(const PrintConfig& print
     return (-1);
 }
 
+WipingExtrusions::RegionExtruders::RegionExtruders(const LayerTools &layer_tools, const PrintConfig &print_config, const PrintObject &object, const PrintRegion &region) :
+    perimeter_soluble   (print_config.filament_soluble.get_at(layer_tools.perimeter_extruder(region))),
+    infill_soluble      (print_config.filament_soluble.get_at(layer_tools.infill_extruder(region))),
+    solid_infill_soluble(print_config.filament_soluble.get_at(layer_tools.solid_infill_extruder(region))),
+    wipe_into_objects   (object.config().wipe_into_objects),
+    wipe_into_infill    (region.config().wipe_into_infill)
+{}
+
 // Decides whether this entity could be overridden
-bool WipingExtrusions::is_overriddable(const ExtrusionEntityCollection& eec, const PrintConfig& print_config, const PrintObject& object, const PrintRegion& region) const
+bool WipingExtrusions::is_overriddable(const ExtrusionEntityCollection& eec, const RegionExtruders &region_extruders) const
 {
-    if (print_config.filament_soluble.get_at(m_layer_tools->extruder(eec, region)))
+    // Same extruder as returned by LayerTools::extruder(eec, region).
+    ExtrusionRole role = eec.role();
+    if (is_infill(role) ?
+            (is_solid_infill(eec.entities.front()->role()) ? region_extruders.solid_infill_soluble : region_extruders.infill_soluble) :
+            region_extruders.perimeter_soluble)
         return false;
 
-    if (object.config().wipe_into_objects)
+    if (region_extruders.wipe_into_objects)
         return true;
 
-    if (!region.config().wipe_into_infill || eec.role() != erInternalInfill)
+    if (!region_extruders.wipe_into_infill || role != erInternalInfill)
         return false;
 
     return true;
 }
 
+bool WipingExtrusions::is_overriddable_and_mark(const ExtrusionEntityCollection& eec, const Layer &layer, size_t region_id, bool perimeter, const RegionExtruders &region_extruders)
+{
+    if (! this->is_overriddable(eec, region_extruders))
+        return false;
+    if (overriddable_regions.empty() || overriddable_regions.back().layer != &layer || overriddable_regions.back().region_id != region_id)
+        overriddable_regions.push_back({ &layer, region_id });
+    (perimeter ? overriddable_regions.back().perimeters : overriddable_regions.back().fills).emplace_back(&eec, eec.total_volume());
+    this->something_overridable = true;
+    return true;
+}
+
 // Following function iterates through all extrusions on the layer, remembers those that could be used for wiping after toolchange
 // and returns volume that is left to be wiped on the wipe tower.
 float WipingExtrusions::mark_wiping_extrusions(const Print& print, unsigned int old_extruder, unsigned int new_extruder, float volume_to_wipe)
@@ -625,9 +675,16 @@ float WipingExtrusions::mark_wiping_extrusions(const Print& print, unsigned int
     if (! this->something_overridable || volume_to_wipe <= 0. || print.config().filament_soluble.get_at(old_extruder) || print.config().filament_soluble.get_at(new_extruder))
         return std::max(0.f, volume_to_wipe); // Soluble filament cannot be wiped in a random infill, neither the filament after it
 
-    // we will sort objects so that dedicated for wiping are at the beginning:
-    PrintObjectPtrs object_list = print.objects();
-    std::sort(object_list.begin(), object_list.end(), [](const PrintObject* a, const PrintObject* b) { return a->config().wipe_into_objects; });
+    // Ranges of overriddable_regions belonging to a single object layer,
+    // we will sort them so that the layers of objects dedicated for wiping are at the beginning:
+    std::vector<std::pair<size_t, size_t>> layer_list;
+    for (size_t i = 0; i < overriddable_regions.size(); ++ i)
+        if (i == 0 || overriddable_regions[i].layer != overriddable_regions[i - 1].layer)
+            layer_list.emplace_back(i, i + 1);
+        else
+            ++ layer_list.back().second;
+    auto is_dedicated = [this](const std::pair<size_t, size_t> &range) { return overriddable_regions[range.first].layer->object()->config().wipe_into_objects.value; };
+    std::stable_partition(layer_list.begin(), layer_list.end(), is_dedicated);
 
     // We will now iterate through
     //  - first the dedicated objects to mark perimeters or infills (depending on infill_first)
@@ -636,61 +693,45 @@ float WipingExtrusions::mark_wiping_extrusions(const Print& print, unsigned int
     // this is controlled by the following variable:
     bool perimeters_done = false;
 
-    for (int i=0 ; i<(int)object_list.size() + (perimeters_done ? 0 : 1); ++i) {
-        if (!perimeters_done && (i==(int)object_list.size() || !object_list[i]->config().wipe_into_objects)) { // we passed the last dedicated object in list
+    for (int i=0 ; i<(int)layer_list.size() + (perimeters_done ? 0 : 1); ++i) {
+        if (!perimeters_done && (i==(int)layer_list.size() || !is_dedicated(layer_list[i]))) { // we passed the last dedicated object in list
             perimeters_done = true;
             i=-1;   // let's go from the start again
             continue;
         }
 
-        const PrintObject* object = object_list[i];
-
-        // Finds this layer:
-        const Layer* this_layer = object->get_layer_at_printz(lt.print_z, EPSILON);
-        if (this_layer == nullptr)
-        	continue;
+        const PrintObject* object = overriddable_regions[layer_list[i].first].layer->object();
         size_t num_of_copies = object->instances().size();
 
         // iterate through copies (aka PrintObject instances) first, so that we mark neighbouring infills to minimize travel moves
         for (unsigned int copy = 0; copy < num_of_copies; ++copy) {
 
-            for (size_t region_id = 0; region_id < object->region_volumes.size(); ++ region_id) {
-                const auto& region = *object->print()->regions()[region_id];
-
-                if (!region.config().wipe_into_infill && !object->config().wipe_into_objects)
-                    continue;
+            for (size_t region_idx = layer_list[i].first; region_idx < layer_list[i].second; ++ region_idx) {
+                const OverriddableRegion &overriddable = overriddable_regions[region_idx];
+                const auto& region = *object->print()->regions()[overriddable.region_id];
 
                 bool wipe_into_infill_only = ! object->config().wipe_into_objects && region.config().wipe_into_infill;
                 if (print.config().infill_first != perimeters_done || wipe_into_infill_only) {
-                    for (const ExtrusionEntity* ee : this_layer->regions()[region_id]->fills.entities) {                      // iterate through all infill Collections
-                        auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
-
-                        if (!is_overriddable(*fill, print.config(), *object, region))
-                            continue;
-
-                        if (wipe_into_infill_only && ! print.config().infill_first)
-                            // In this case we must check that the original extruder is used on this layer before the one we are overridding
-                            // (and the perimeters will be finished before the infill is printed):
-                            if (!lt.is_extruder_order(lt.perimeter_extruder(region), new_extruder))
-                                continue;
-
-                        if ((!is_entity_overridden(fill, copy) && fill->total_volume() > min_infill_volume)) {     // this infill will be used to wipe this extruder
-                            set_extruder_override(fill, copy, new_extruder, num_of_copies);
-                            if ((volume_to_wipe -= float(fill->total_volume())) <= 0.f)
-                            	// More material was purged already than asked for.
-	                            return 0.f;
+                    // In case of wipe_into_infill_only && ! infill_first we must check that the original extruder is used on this layer
+                    // before the one we are overridding (and the perimeters will be finished before the infill is printed):
+                    if (! wipe_into_infill_only || print.config().infill_first || lt.is_extruder_order(lt.perimeter_extruder(region), new_extruder))
+                        for (const std::pair<const ExtrusionEntityCollection*, double> &fill : overriddable.fills) {                      // iterate through all infill Collections
+                            if ((!is_entity_overridden(fill.first, copy) && fill.second > min_infill_volume)) {     // this infill will be used to wipe this extruder
+                                set_extruder_override(fill.first, copy, new_extruder, num_of_copies);
+                                if ((volume_to_wipe -= float(fill.second)) <= 0.f)
+                                	// More material was purged already than asked for.
+	                                return 0.f;
+                            }
                         }
-                    }
                 }
 
                 // Now the same for perimeters - see comments above for explanation:
                 if (object->config().wipe_into_objects && print.config().infill_first == perimeters_done)
                 {
-                    for (const ExtrusionEntity* ee : this_layer->regions()[region_id]->perimeters.entities) {
-                        auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
-                        if (is_overriddable(*fill, print.config(), *object, region) && !is_entity_overridden(fill, copy) && fill->total_volume() > min_infill_volume) {
-                            set_extruder_override(fill, copy, new_extruder, num_of_copies);
-                            if ((volume_to_wipe -= float(fill->total_volume())) <= 0.f)
+                    for (const std::pair<const ExtrusionEntityCollection*, double> &perimeter : overriddable.perimeters) {
+                        if (!is_entity_overridden(perimeter.first, copy) && perimeter.second > min_infill_volume) {
+                            set_extruder_override(perimeter.first, copy, new_extruder, num_of_copies);
+                            if ((volume_to_wipe -= float(perimeter.second)) <= 0.f)
                             	// More material was purged already than asked for.
 	                            return 0.f;
                         }
@@ -719,25 +760,19 @@ void WipingExtrusions::ensure_perimeters_infills_order(const Print& print)
     unsigned int first_nonsoluble_extruder = first_nonsoluble_extruder_on_layer(print.config());
     unsigned int last_nonsoluble_extruder = last_nonsoluble_extruder_on_layer(print.config());
 
-    for (const PrintObject* object : print.objects()) {
-        // Finds this layer:
-        const Layer* this_layer = object->get_layer_at_printz(lt.print_z, EPSILON);
-        if (this_layer == nullptr)
-        	continue;
+    for (size_t layer_begin = 0; layer_begin < overriddable_regions.size();) {
+        const PrintObject* object = overriddable_regions[layer_begin].layer->object();
         size_t num_of_copies = object->instances().size();
+        size_t layer_end = layer_begin + 1;
+        for (; layer_end < overriddable_regions.size() && overriddable_regions[layer_end].layer == overriddable_regions[layer_begin].layer; ++ layer_end) ;
 
         for (size_t copy = 0; copy < num_of_copies; ++copy) {    // iterate through copies first, so that we mark neighbouring infills to minimize travel moves
-            for (size_t region_id = 0; region_id < object->region_volumes.size(); ++ region_id) {
-                const auto& region = *object->print()->regions()[region_id];
-
-                if (!region.config().wipe_into_infill && !object->config().wipe_into_objects)
-                    continue;
+            for (size_t region_idx = layer_begin; region_idx < layer_end; ++ region_idx) {
+                const OverriddableRegion &overriddable = overriddable_regions[region_idx];
+                const auto& region = *object->print()->regions()[overriddable.region_id];
 
-                for (const ExtrusionEntity* ee : this_layer->regions()[region_id]->fills.entities) {                      // iterate through all infill Collections
-                    auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
-
-                    if (!is_overriddable(*fill, print.config(), *object, region)
-                     || is_entity_overridden(fill, copy) )
+                for (const std::pair<const ExtrusionEntityCollection*, double> &fill : overriddable.fills) {                      // iterate through all infill Collections
+                    if (is_entity_overridden(fill.first, copy))
                         continue;
 
                     // This infill could have been overridden but was not - unless we do something, it could be
@@ -748,7 +783,7 @@ void WipingExtrusions::ensure_perimeters_infills_order(const Print& print)
                     || object->config().wipe_into_objects  // in this case the perimeter is overridden, so we can override by the last one safely
                     || lt.is_extruder_order(lt.perimeter_extruder(region), last_nonsoluble_extruder    // !infill_first, but perimeter is already printed when last extruder prints
                     || ! lt.has_extruder(lt.infill_extruder(region)))) // we have to force override - this could violate infill_first (FIXME)
-                        set_extruder_override(fill, copy, (print.config().infill_first ? first_nonsoluble_extruder : last_nonsoluble_extruder), num_of_copies);
+                        set_extruder_override(fill.first, copy, (print.config().infill_first ? first_nonsoluble_extruder : last_nonsoluble_extruder), num_of_copies);
                     else {
                         // In this case we can (and should) leave it to be printed normally.
                         // Force overriding would mean it gets printed before its perimeter.
@@ -756,13 +791,12 @@ void WipingExtrusions::ensure_perimeters_infills_order(const Print& print)
                 }
 
                 // Now the same for perimeters - see comments above for explanation:
-                for (const ExtrusionEntity* ee : this_layer->regions()[region_id]->perimeters.entities) {                      // iterate through all perimeter Collections
-                    auto* fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
-                    if (is_overriddable(*fill, print.config(), *object, region) && ! is_entity_overridden(fill, copy))
-                        set_extruder_override(fill, copy, (print.config().infill_first ? last_nonsoluble_extruder : first_nonsoluble_extruder), num_of_copies);
-                }
+                for (const std::pair<const ExtrusionEntityCollection*, double> &perimeter : overriddable.perimeters)                      // iterate through all perimeter Collections
+                    if (! is_entity_overridden(perimeter.first, copy))
+                        set_extruder_override(perimeter.first, copy, (print.config().infill_first ? last_nonsoluble_extruder : first_nonsoluble_extruder), num_of_copies);
             }
         }
+        layer_begin = layer_end;
     }
 }
 
@@ -13,6 +13,7 @@ namespace Slic3r {
 
 class Print;
 class PrintObject;
+class Layer;
 class LayerTools;
 namespace CustomGCode { struct Item; }
 class PrintRegion;
@@ -41,12 +42,23 @@ public:
 
     void ensure_perimeters_infills_order(const Print& print);
 
-    bool is_overriddable(const ExtrusionEntityCollection& ee, const PrintConfig& print_config, const PrintObject& object, const PrintRegion& region) const;
-    bool is_overriddable_and_mark(const ExtrusionEntityCollection& ee, const PrintConfig& print_config, const PrintObject& object, const PrintRegion& region) {
-    	bool out = this->is_overriddable(ee, print_config, object, region);
-    	this->something_overridable |= out;
-    	return out;
-    }
+    // Extruders assigned to a region of an object layer and whether they print a soluble filament.
+    // Resolved once per LayerRegion instead of once per extrusion entity.
+    struct RegionExtruders
+    {
+        RegionExtruders(const LayerTools &layer_tools, const PrintConfig &print_config, const PrintObject &object, const PrintRegion &region);
+
+        bool perimeter_soluble;
+        bool infill_soluble;
+        bool solid_infill_soluble;
+        bool wipe_into_objects;
+        bool wipe_into_infill;
+    };
+
+    bool is_overriddable(const ExtrusionEntityCollection& ee, const RegionExtruders &region_extruders) const;
+    // If the extrusion could be overridden, remember it for mark_wiping_extrusions() and ensure_perimeters_infills_order(),
+    // so that these do not have to evaluate all the extrusions of the layer again for each tool change.
+    bool is_overriddable_and_mark(const ExtrusionEntityCollection& ee, const Layer &layer, size_t region_id, bool perimeter, const RegionExtruders &region_extruders);
 
     void set_layer_tools_ptr(const LayerTools* lt) { m_layer_tools = lt; }
 
@@ -63,7 +75,18 @@ private:
         return it == entity_map.end() ? false : it->second[copy_id] != -1;
     }
 
+    // Extrusions of a single region of an object layer, which could be overridden, with their volumes.
+    struct OverriddableRegion
+    {
+        const Layer *layer;
+        size_t       region_id;
+        std::vector<std::pair<const ExtrusionEntityCollection*, double>> fills;
+        std::vector<std::pair<const ExtrusionEntityCollection*, double>> perimeters;
+    };
+
     std::map<const ExtrusionEntity*, ExtruderPerCopy> entity_map;  // to keep track of who prints what
+    // Overriddable extrusions grouped by object layer, then by region, filled in by is_overriddable_and_mark().
+    std::vector<OverriddableRegion> overriddable_regions;
     bool something_overridable = false;
     bool something_overridden = false;
     const LayerTools* m_layer_tools = nullptr;    // so we know which LayerTools object this belongs to
@@ -107,6 +130,8 @@ public:
     // and to support the wipe tower partitions above this one.
     size_t                      wipe_tower_partitions = 0;
     coordf_t 					wipe_tower_layer_height = 0.;
+    // Object layers printed at this print_z, in the order of Print::objects().
+    std::vector<const Layer*>   object_layers;
     // Custom G-code (color change, extruder switch, pause) to be performed before this layer starts to print.
     const CustomGCode::Item    *custom_gcode = nullptr;
 
@@ -166,7 +191,7 @@ public:
 
 private:
     void				initialize_layers(std::vector<coordf_t> &zs);
-    void 				collect_extruders(const PrintObject &object, const std::vector<std::pair<double, unsigned int>> &per_layer_extruder_switches);
+    void 				collect_extruders(const std::vector<const PrintObject*> &objects, const std::vector<std::pair<double, unsigned int>> &per_layer_extruder_switches);
     void				reorder_extruders(unsigned int last_extruder_id);
     void 				fill_wipe_tower_partitions(const PrintConfig &config, coordf_t object_bottom_z, coordf_t max_layer_height);
     void 				collect_extruder_statistics(bool prime_multi_material);
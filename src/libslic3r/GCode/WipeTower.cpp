@@ -36,6 +36,10 @@ TODO LIST
 namespace Slic3r
 {
 
+// The XY positions passed to the G-code generator are rounded to the resolution of the G-code,
+// so that the G-code generator skips exactly the axes, which did not change in the printed G-code.
+static inline float round_to_gcode(float v) { return float(std::round(double(v) * 1000.) / 1000.); }
+
 class WipeTowerWriter
 {
 public:
@@ -84,6 +88,7 @@ public:
         m_internal_angle = internal_angle;
 		m_start_pos = this->rotate(pos);
 		m_current_pos = pos;
+		m_gcode_pos = m_start_pos;
 		return *this;
 	}
 
@@ -122,6 +127,7 @@ public:
 	}
 
 	const std::string&   gcode() const { return m_gcode; }
+	const std::vector<WipeTower::GCodeInsert>& gcode_inserts() const { return m_gcode_inserts; }
 	const std::vector<WipeTower::Extrusion>& extrusions() const { return m_extrusions; }
 	float                x()     const { return m_current_pos.x(); }
 	float                y()     const { return m_current_pos.y(); }
@@ -161,11 +167,16 @@ public:
 		}
 
 		m_gcode += "G1";
-        if (std::abs(rot.x() - rotated_current_pos.x()) > (float)EPSILON)
-			m_gcode += set_format_X(rot.x());
-
-        if (std::abs(rot.y() - rotated_current_pos.y()) > (float)EPSILON)
-			m_gcode += set_format_Y(rot.y());
+        bool move_x = std::abs(rot.x() - rotated_current_pos.x()) > (float)EPSILON;
+        bool move_y = std::abs(rot.y() - rotated_current_pos.y()) > (float)EPSILON;
+        if (move_x || move_y) {
+            // The X and Y coordinates are inserted by the G-code generator, which transforms them to the print bed coordinates.
+            if (move_x)
+                m_gcode_pos.x() = round_to_gcode(rot.x());
+            if (move_y)
+                m_gcode_pos.y() = round_to_gcode(rot.y());
+            m_gcode_inserts.emplace_back(m_gcode.size(), WipeTower::GCodeInsert::MoveXY, m_gcode_pos);
+        }
 
 
 		if (e != 0.f)
@@ -393,6 +404,23 @@ public:
 
 	WipeTowerWriter& append(const std::string& text) { m_gcode += text; return *this; }
 
+	// Placeholder for one of the custom G-codes, which are inserted by the G-code generator.
+	WipeTowerWriter& custom_gcode(WipeTower::GCodeInsert::Type type)
+	{
+		m_gcode_inserts.emplace_back(m_gcode.size(), type);
+		return *this;
+	}
+
+	// Travel to where we assume we are, emitting both coordinates, even if the G-code generator thinks the extruder is there already.
+	WipeTowerWriter& travel_to_current_pos()
+	{
+		m_gcode_pos = this->pos_rotated();
+		m_gcode += "G1";
+		m_gcode_inserts.emplace_back(m_gcode.size(), WipeTower::GCodeInsert::MoveXYNeverSkip, m_gcode_pos);
+		m_gcode += "\n";
+		return *this;
+	}
+
 private:
 	Vec2f         m_start_pos;
 	Vec2f         m_current_pos;
@@ -403,6 +431,9 @@ private:
 	float 	  	  m_extrusion_flow;
 	bool		  m_preview_suppressed;
 	std::string   m_gcode;
+	std::vector<WipeTower::GCodeInsert> m_gcode_inserts;
+	// Last position emitted into m_gcode_inserts, in the wipe tower coordinates.
+	Vec2f         m_gcode_pos = Vec2f::Zero();
 	std::vector<WipeTower::Extrusion> m_extrusions;
 	float         m_elapsed_time;
 	float   	  m_internal_angle = 0.f;
@@ -416,21 +447,6 @@ private:
     GCodeFlavor   m_gcode_flavor;
     const std::vector<WipeTower::FilamentParameters>& m_filpar;
 
-	std::string   set_format_X(float x)
-	{
-		char buf[64];
-		sprintf(buf, " X%.3f", x);
-		m_current_pos.x() = x;
-		return buf;
-	}
-
-	std::string   set_format_Y(float y) {
-		char buf[64];
-		sprintf(buf, " Y%.3f", y);
-		m_current_pos.y() = y;
-		return buf;
-	}
-
 	std::string   set_format_Z(float z) {
 		char buf[64];
 		sprintf(buf, " Z%.3f", z);
@@ -632,6 +648,7 @@ std::vector<WipeTower::ToolChangeResult> WipeTower::prime(
         result.print_z 	  	= this->m_z_pos;
         result.layer_height = this->m_layer_height;
         result.gcode   	  	= writer.gcode();
+        result.gcode_inserts = writer.gcode_inserts();
         result.elapsed_time = writer.elapsed_time();
         result.extrusions 	= writer.extrusions();
         result.start_pos  	= writer.start_pos_rotated();
@@ -766,6 +783,7 @@ WipeTower::ToolChangeResult WipeTower::tool_change(size_t tool, bool last_in_lay
 	result.print_z 	  	= this->m_z_pos;
 	result.layer_height = this->m_layer_height;
 	result.gcode   	  	= writer.gcode();
+	result.gcode_inserts = writer.gcode_inserts();
 	result.elapsed_time = writer.elapsed_time();
 	result.extrusions 	= writer.extrusions();
 	result.start_pos  	= writer.start_pos_rotated();
@@ -830,6 +848,7 @@ WipeTower::ToolChangeResult WipeTower::toolchange_Brim(bool sideOnly, float y_of
 	result.print_z 	  	= this->m_z_pos;
 	result.layer_height = this->m_layer_height;
 	result.gcode   	  	= writer.gcode();
+	result.gcode_inserts = writer.gcode_inserts();
 	result.elapsed_time = writer.elapsed_time();
 	result.extrusions 	= writer.extrusions();
 	result.start_pos  	= writer.start_pos_rotated();
@@ -1007,19 +1026,17 @@ void WipeTower::toolchange_Change(
 
     // This is where we want to place the custom gcodes. We will use placeholders for this.
     // These will be substituted by the actual gcodes when the gcode is generated.
-    writer.append("[end_filament_gcode]\n");
-    writer.append("[toolchange_gcode]\n");
+    writer.custom_gcode(GCodeInsert::EndFilamentGCode)
+          .custom_gcode(GCodeInsert::ToolChangeGCode);
 
     // Travel to where we assume we are. Custom toolchange or some special T code handling (parking extruder etc)
-    // gcode could have left the extruder somewhere, we cannot just start extruding. We should also inform the
-    // postprocessor that we absolutely want to have this in the gcode, even if it thought it is the same as before.
-    Vec2f current_pos = writer.pos_rotated();
-    writer.append(std::string("G1 X") + std::to_string(current_pos.x()) +  " Y" + std::to_string(current_pos.y()) + never_skip_tag() + "\n");
+    // gcode could have left the extruder somewhere, we cannot just start extruding.
+    writer.travel_to_current_pos();
 
     // The toolchange Tn command will be inserted later, only in case that the user does
     // not provide a custom toolchange gcode.
 	writer.set_tool(new_tool); // This outputs nothing, the writer just needs to know the tool has changed.
-    writer.append("[start_filament_gcode]\n");
+    writer.custom_gcode(GCodeInsert::StartFilamentGCode);
 
 	writer.flush_planner_queue();
 	m_current_tool = new_tool;
@@ -1225,6 +1242,7 @@ WipeTower::ToolChangeResult WipeTower::finish_layer()
 	result.print_z 	  	= this->m_z_pos;
 	result.layer_height = this->m_layer_height;
 	result.gcode   	  	= writer.gcode();
+	result.gcode_inserts = writer.gcode_inserts();
 	result.elapsed_time = writer.elapsed_time();
 	result.extrusions 	= writer.extrusions();
 	result.start_pos 	= writer.start_pos_rotated();
@@ -1369,10 +1387,15 @@ void WipeTower::generate(std::vector<std::vector<WipeTower::ToolChangeResult>> &
             if ( ! layer.tool_changes.empty() ) { // we will merge it to the last toolchange
                 auto& last_toolchange = layer_result.back();
                 if (last_toolchange.end_pos != finish_layer_toolchange.start_pos) {
-                    char buf[2048];     // Add a travel move from tc1.end_pos to tc2.start_pos.
-					sprintf(buf, "G1 X%.3f Y%.3f F7200\n", finish_layer_toolchange.start_pos.x(), finish_layer_toolchange.start_pos.y());
-					last_toolchange.gcode += buf;
+                    // Add a travel move from tc1.end_pos to tc2.start_pos.
+                    last_toolchange.gcode += "G1";
+                    last_toolchange.gcode_inserts.emplace_back(last_toolchange.gcode.size(), GCodeInsert::MoveXY,
+                        Vec2f(round_to_gcode(finish_layer_toolchange.start_pos.x()), round_to_gcode(finish_layer_toolchange.start_pos.y())));
+                    last_toolchange.gcode += " F7200\n";
 				}
+                for (GCodeInsert &insert : finish_layer_toolchange.gcode_inserts)
+                    insert.pos += last_toolchange.gcode.size();
+                last_toolchange.gcode_inserts.insert(last_toolchange.gcode_inserts.end(), finish_layer_toolchange.gcode_inserts.begin(), finish_layer_toolchange.gcode_inserts.end());
                 last_toolchange.gcode += finish_layer_toolchange.gcode;
                 last_toolchange.extrusions.insert(last_toolchange.extrusions.end(), finish_layer_toolchange.extrusions.begin(), finish_layer_toolchange.extrusions.end());
                 last_toolchange.end_pos = finish_layer_toolchange.end_pos;
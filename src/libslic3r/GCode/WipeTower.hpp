@@ -21,8 +21,6 @@ enum GCodeFlavor : unsigned char;
 class WipeTower
 {
 public:
-    static const std::string never_skip_tag() { return "_GCODE_WIPE_TOWER_NEVER_SKIP_TAG"; }
-
     struct Extrusion
     {
 		Extrusion(const Vec2f &pos, float width, unsigned int tool) : pos(pos), width(width), tool(tool) {}
@@ -35,13 +33,37 @@ public:
 		unsigned int    tool;
 	};
 
+	// Position in ToolChangeResult::gcode, at which the G-code generator inserts either the X and Y coordinates of a move
+	// transformed from the wipe tower coordinates to the print bed coordinates, or one of the custom G-codes.
+	struct GCodeInsert
+	{
+		enum Type : unsigned char {
+			// X and Y coordinates of a G1 move. Only the coordinates, which changed after the transformation, are emitted.
+			MoveXY,
+			// X and Y coordinates of a G1 move, emitted even if the G-code generator thinks the extruder is there already.
+			MoveXYNeverSkip,
+			EndFilamentGCode,
+			ToolChangeGCode,
+			StartFilamentGCode,
+		};
+		GCodeInsert(size_t pos, Type type, const Vec2f &xy = Vec2f::Zero()) : pos(pos), type(type), xy(xy) {}
+		// Offset into ToolChangeResult::gcode.
+		size_t			pos;
+		Type			type;
+		// Position of a move in the wipe tower coordinates.
+		Vec2f			xy;
+	};
+
 	struct ToolChangeResult
 	{
 		// Print heigh of this tool change.
 		float					print_z;
 		float 					layer_height;
-		// G-code section to be directly included into the output G-code.
+		// G-code section to be included into the output G-code. The G-code generator inserts the custom G-codes
+		// and the X and Y coordinates of the moves at gcode_inserts, without parsing the G-code.
 		std::string				gcode;
+		// Sorted by GCodeInsert::pos.
+		std::vector<GCodeInsert> gcode_inserts;
 		// For path preview.
 		std::vector<Extrusion> 	extrusions;
 		// Initial position, at which the wipe tower starts its action.
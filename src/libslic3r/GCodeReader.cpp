@@ -1,10 +1,13 @@
 #include "GCodeReader.hpp"
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
-#include <fstream>
+#include <boost/filesystem/operations.hpp>
 #include <iostream>
 #include <iomanip>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include <Shiny/Shiny.h>
 
 namespace Slic3r {
@@ -21,6 +24,31 @@ void GCodeReader::apply_config(const DynamicPrintConfig &config)
     m_extrusion_axis = m_config.get_extrusion_axis()[0];
 }
 
+// Parse a plain decimal number such as "-12.345", which covers the numbers written by the G-code generators.
+// Numbers of up to 15 digits are converted exactly: the integer mantissa and the power of ten are exact doubles,
+// thus their quotient is rounded the same way as by strtod(). Anything else is passed to strtod(), which is much slower.
+static double parse_axis_value(const char *c, char **pend)
+{
+    static constexpr const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+    const char *p        = c;
+    bool        negative = *p == '-';
+    if (*p == '-' || *p == '+')
+        ++ p;
+    uint64_t    mantissa = 0;
+    int         digits   = 0;
+    int         decimals = 0;
+    for (; *p >= '0' && *p <= '9'; ++ p, ++ digits)
+        mantissa = mantissa * 10 + uint64_t(*p - '0');
+    if (*p == '.')
+        for (++ p; *p >= '0' && *p <= '9'; ++ p, ++ digits, ++ decimals)
+            mantissa = mantissa * 10 + uint64_t(*p - '0');
+    if (digits == 0 || digits > 15 || *p == 'e' || *p == 'E' || *p == 'x' || *p == 'X')
+        return strtod(c, pend);
+    *pend = const_cast<char*>(p);
+    double v = double(mantissa) / pow10[decimals];
+    return negative ? - v : v;
+}
+
 const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command)
 {
     PROFILE_FUNC();
@@ -57,7 +85,7 @@ const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline,
             if (axis != NUM_AXES_WITH_UNKNOWN) {
                 // Try to parse the numeric value.
                 char   *pend = nullptr;
-                double  v = strtod(++ c, &pend);
+                double  v = parse_axis_value(++ c, &pend);
                 if (pend != nullptr && is_end_of_word(*pend)) {
                     // The axis value has been parsed correctly.
                     if (axis != UNKNOWN_AXIS)
@@ -111,12 +139,50 @@ void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, co
     }
 }
 
+MappedGCodeFile::MappedGCodeFile(const std::string &path)
+{
+    boost::system::error_code ec;
+    uintmax_t size = boost::filesystem::file_size(path, ec);
+    if (! ec && size > 0) {
+        try {
+            m_file   = boost::interprocess::file_mapping(path.c_str(), boost::interprocess::read_only);
+            m_region = boost::interprocess::mapped_region(m_file, boost::interprocess::read_only);
+        } catch (const boost::interprocess::interprocess_exception &) {
+            m_region = boost::interprocess::mapped_region();
+        }
+    }
+}
+
+std::vector<const char*> MappedGCodeFile::split_lines(size_t chunk_size) const
+{
+    std::vector<const char*> chunks { this->begin() };
+    while (size_t(this->end() - chunks.back()) > chunk_size) {
+        const char *eol = static_cast<const char*>(memchr(chunks.back() + chunk_size, '\n', this->end() - chunks.back() - chunk_size));
+        if (eol == nullptr)
+            break;
+        chunks.emplace_back(eol + 1);
+    }
+    chunks.emplace_back(this->end());
+    return chunks;
+}
+
 void GCodeReader::parse_file(const std::string &file, callback_t callback)
 {
-    std::ifstream f(file);
-    std::string line;
-    while (std::getline(f, line))
-        this->parse_line(line, callback);
+    MappedGCodeFile mapped(file);
+    this->parse_buffer(mapped.begin(), mapped.end(), callback);
+}
+
+void GCodeReader::parse_file_parallel(const std::string &file, callback_t callback) const
+{
+    MappedGCodeFile mapped(file);
+    std::vector<const char*> chunks = mapped.split_lines(4 * 1024 * 1024);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size() - 1, 1),
+        [this, &chunks, &callback](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i) {
+                GCodeReader reader(*this);
+                reader.parse_buffer(chunks[i], chunks[i + 1], callback);
+            }
+        });
 }
 
 bool GCodeReader::GCodeLine::has(char axis) const
@@ -158,7 +224,7 @@ bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
         if (*c == axis) {
             // Try to parse the numeric value.
             char   *pend = nullptr;
-            double  v = strtod(++ c, &pend);
+            double  v = parse_axis_value(++ c, &pend);
             if (pend != nullptr && is_end_of_word(*pend)) {
                 // The axis value has been parsed correctly.
                 value = float(v);
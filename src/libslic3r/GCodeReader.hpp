@@ -4,8 +4,13 @@
 #include "libslic3r.h"
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
 #include "PrintConfig.hpp"
 
 namespace Slic3r {
@@ -18,12 +23,13 @@ public:
         void reset() { m_mask = 0; memset(m_axis, 0, sizeof(m_axis)); m_raw.clear(); }
 
         const std::string&  raw() const { return m_raw; }
-        const std::string   cmd() const { 
+        // The command and the comment are views into raw(), they are valid until the line is reset or modified.
+        std::string_view    cmd() const { 
             const char *cmd = GCodeReader::skip_whitespaces(m_raw.c_str());
-            return std::string(cmd, GCodeReader::skip_word(cmd));
+            return std::string_view(cmd, GCodeReader::skip_word(cmd) - cmd);
         }
-        const std::string   comment() const
-            { size_t pos = m_raw.find(';'); return (pos == std::string::npos) ? "" : m_raw.substr(pos + 1); }
+        std::string_view    comment() const
+            { size_t pos = m_raw.find(';'); return (pos == std::string::npos) ? std::string_view() : std::string_view(m_raw).substr(pos + 1); }
 
         bool  has(Axis axis) const { return (m_mask & (1 << int(axis))) != 0; }
         float value(Axis axis) const { return m_axis[axis]; }
@@ -92,6 +98,28 @@ public:
     void parse_buffer(const std::string &buffer)
         { this->parse_buffer(buffer, [](GCodeReader&, const GCodeReader::GCodeLine&){}); }
 
+    // Parse a buffer, which does not need to be zero terminated, for example a memory mapped file.
+    // The lines terminated by a newline are parsed in place, only the last unterminated line is copied.
+    template<typename Callback>
+    void parse_buffer(const char *begin, const char *end, Callback callback)
+    {
+        GCodeLine   gline;
+        const char *ptr = begin;
+        // The parser stops at a newline, thus it never reads past the last one.
+        const char *last_eol = end;
+        while (last_eol != begin && last_eol[-1] != '\n')
+            -- last_eol;
+        while (ptr < last_eol) {
+            gline.reset();
+            ptr = this->parse_line(ptr, gline, callback);
+            if (ptr < last_eol && *ptr == 0)
+                // The parser stops at a zero character, skip the rest of the line the same way.
+                ptr = static_cast<const char*>(memchr(ptr, '\n', last_eol - ptr)) + 1;
+        }
+        if (ptr < end)
+            this->parse_line(std::string(ptr, end), callback);
+    }
+
     template<typename Callback>
     const char* parse_line(const char *ptr, GCodeLine &gline, Callback &callback)
     {
@@ -106,7 +134,13 @@ public:
     void parse_line(const std::string &line, Callback callback)
         { GCodeLine gline; this->parse_line(line.c_str(), gline, callback); }
 
+    // Parse a file sequentially. The file is memory mapped and parsed in place.
     void parse_file(const std::string &file, callback_t callback);
+    // Parse a file by chunks of lines in parallel. The callback is called concurrently from multiple threads,
+    // each chunk is parsed by its own copy of this reader in order, but its position is only tracked from the start
+    // of the chunk. Thus only statistics, which do not depend on the machine state, should be collected this way,
+    // for example the number of lines of a given command or the lengths of relative extrusions.
+    void parse_file_parallel(const std::string &file, callback_t callback) const;
 
     float& x()       { return m_position[X]; }
     float  x() const { return m_position[X]; }
@@ -147,6 +181,26 @@ private:
     bool        m_verbose;
 };
 
+// Read only memory mapping of a G-code file. A file, which does not exist or which is empty, is mapped as an empty buffer,
+// the same way as a file, which failed to open, was read by std::ifstream as an empty file.
+class MappedGCodeFile {
+public:
+    MappedGCodeFile(const std::string &path);
+
+    const char* begin() const { return static_cast<const char*>(m_region.get_address()); }
+    const char* end()   const { return this->begin() + m_region.get_size(); }
+    size_t      size()  const { return m_region.get_size(); }
+
+    // Split the file into chunks of whole lines of at least chunk_size bytes, except for the last one.
+    // Returns the boundaries of the chunks, starting with begin() and ending with end().
+    std::vector<const char*> split_lines(size_t chunk_size) const;
+
+private:
+    boost::interprocess::file_mapping  m_file;
+    boost::interprocess::mapped_region m_region;
+};
+
+
 } /* namespace Slic3r */
 
 #endif /* slic3r_GCodeReader_hpp_ */
@@ -180,6 +180,13 @@ namespace Slic3r {
         }
     }
 
+    void GCodeTimeEstimator::add_gcode_block(const char *begin, const char *end)
+    {
+        PROFILE_FUNC();
+        m_parser.parse_buffer(begin, end, [this](GCodeReader &reader, const GCodeReader::GCodeLine &line)
+        { this->_process_gcode_line(reader, line); });
+    }
+
     void GCodeTimeEstimator::calculate_time(bool start_from_beginning)
     {
         PROFILE_FUNC();
@@ -763,6 +770,7 @@ namespace Slic3r {
         set_axis_origin(X, 0.0f);
         set_axis_origin(Y, 0.0f);
         set_axis_origin(Z, 0.0f);
+        set_axis_origin(E, 0.0f);
 
         if (get_e_local_positioning_type() == Absolute)
             set_axis_position(E, 0.0f);
@@ -797,7 +805,6 @@ namespace Slic3r {
         _recalculate_trapezoids();
 
         size_t n_blocks_process = m_blocks.size() - keep_last_n_blocks;
-        m_g1_times.reserve(m_g1_times.size() + n_blocks_process);
         for (size_t i = 0; i < n_blocks_process; ++ i)
         {
             Block& block = m_blocks[i];
@@ -835,7 +842,7 @@ namespace Slic3r {
         if (_process_tags(line))
             return;
 
-        std::string cmd = line.cmd();
+        std::string_view cmd = line.cmd();
         if (cmd.length() > 1)
         {
             switch (::toupper(cmd[0]))
@@ -1446,10 +1453,10 @@ namespace Slic3r {
 
     void GCodeTimeEstimator::_processT(const GCodeReader::GCodeLine& line)
     {
-        std::string cmd = line.cmd();
+        std::string_view cmd = line.cmd();
         if (cmd.length() > 1)
         {
-            unsigned int id = (unsigned int)::strtol(cmd.substr(1).c_str(), nullptr, 10);
+            unsigned int id = (unsigned int)::strtol(std::string(cmd.substr(1)).c_str(), nullptr, 10);
             if (get_extruder_id() != id)
             {
                 // Specific to the MK3 MMU2: The initial extruder ID is set to -1 indicating
@@ -1464,7 +1471,7 @@ namespace Slic3r {
 
     bool GCodeTimeEstimator::_process_tags(const GCodeReader::GCodeLine& line)
     {
-        std::string comment = line.comment();
+        std::string_view comment = line.comment();
 
         // Color_Change_Tag
         size_t pos = comment.find(Color_Change_Tag);
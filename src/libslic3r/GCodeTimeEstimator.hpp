@@ -249,6 +249,8 @@ namespace Slic3r {
 
         void add_gcode_block(const char *ptr);
         void add_gcode_block(const std::string &str) { this->add_gcode_block(str.c_str()); }
+        // Adds the gcode contained in the given buffer, which does not need to be zero terminated, for example a chunk of a memory mapped file
+        void add_gcode_block(const char *begin, const char *end);
 
         // Calculates the time estimate from the gcode lines added using add_gcode_line() or add_gcode_block()
         // start_from_beginning:
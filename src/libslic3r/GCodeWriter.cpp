@@ -1,20 +1,56 @@
 #include "GCodeWriter.hpp"
 #include "CustomGCode.hpp"
 #include <algorithm>
-#include <iomanip>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <assert.h>
+#include <cmath>
+#include <cstdio>
 
 #define FLAVOR_IS(val) this->config.gcode_flavor == val
 #define FLAVOR_IS_NOT(val) this->config.gcode_flavor != val
-#define COMMENT(comment) if (this->config.gcode_comments && !comment.empty()) gcode << " ; " << comment;
-#define PRECISION(val, precision) std::fixed << std::setprecision(precision) << val
-#define XYZF_NUM(val) PRECISION(val, 3)
-#define E_NUM(val) PRECISION(val, 5)
+#define XYZF_DIGITS 3
+#define E_DIGITS 5
 
 namespace Slic3r {
 
+char* GCodeFormatter::format_fixed(char *buf, double value, int digits)
+{
+    static constexpr uint64_t pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+    assert(digits >= 0 && digits <= 9);
+    double scaled = std::abs(value) * double(pow10[digits]);
+    // Below 1e12 the scaled value is accurate to 1e-4, thus rounding it to an integer produces the correctly rounded
+    // decimal representation unless it is very close to a half. Let printf handle the close to half cases,
+    // large numbers, infinities and NaNs (the comparison fails for NaN).
+    if (! (scaled < 1e12) || std::abs(scaled - std::floor(scaled) - 0.5) < 1e-3)
+        return buf + sprintf(buf, "%.*f", digits, value);
+    uint64_t n = uint64_t(scaled + 0.5);
+    char *ptr = buf;
+    // printf emits the sign even if the value rounds to zero.
+    if (std::signbit(value))
+        *ptr ++ = '-';
+    // Integer part, written in reverse order first.
+    uint64_t ipart = n / pow10[digits];
+    char    *begin = ptr;
+    do {
+        *ptr ++ = char('0' + ipart % 10);
+        ipart /= 10;
+    } while (ipart > 0);
+    std::reverse(begin, ptr);
+    // Decimal part, padded with zeros.
+    if (digits > 0) {
+        *ptr ++ = '.';
+        uint64_t fpart = n % pow10[digits];
+        for (int i = digits - 1; i >= 0; -- i) {
+            ptr[i] = char('0' + fpart % 10);
+            fpart /= 10;
+        }
+        ptr += digits;
+    }
+    return ptr;
+}
+
 void GCodeWriter::apply_print_config(const PrintConfig &print_config)
 {
     this->config.apply(print_config, true);
@@ -266,33 +302,31 @@ std::string GCodeWriter::toolchange(unsigned int extruder_id)
     return gcode.str();
 }
 
-std::string GCodeWriter::set_speed(double F, const std::string &comment, const std::string &cooling_marker) const
+void GCodeWriter::set_speed(std::string &out, double F, const std::string &comment, const std::string &cooling_marker) const
 {
     assert(F > 0.);
     assert(F < 100000.);
-    std::ostringstream gcode;
-    gcode << "G1 F" << XYZF_NUM(F);
-    COMMENT(comment);
-    gcode << cooling_marker;
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter gcode(out);
+    gcode.emit("G1").emit_axis("F", F, XYZF_DIGITS);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.emit(cooling_marker);
+    gcode.emit_eol();
 }
 
-std::string GCodeWriter::travel_to_xy(const Vec2d &point, const std::string &comment)
+void GCodeWriter::travel_to_xy(std::string &out, const Vec2d &point, const std::string &comment)
 {
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter gcode(out);
+    gcode.emit("G1").emit_axis("X", point(0), XYZF_DIGITS)
+                    .emit_axis("Y", point(1), XYZF_DIGITS)
+                    .emit_axis("F", this->config.travel_speed.value * 60.0, XYZF_DIGITS);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.emit_eol();
 }
 
-std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &comment)
+void GCodeWriter::travel_to_xyz(std::string &out, const Vec3d &point, const std::string &comment)
 {
     /*  If target Z is lower than current Z but higher than nominal Z we
         don't perform the Z move but we only move in the XY plane and
@@ -305,7 +339,8 @@ std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &co
         // and a retract could be skipped (https://github.com/prusa3d/PrusaSlicer/issues/2154
         if (std::abs(m_lifted) < EPSILON)
             m_lifted = 0.;
-        return this->travel_to_xy(to_2d(point));
+        this->travel_to_xy(out, to_2d(point));
+        return;
     }
     
     /*  In all the other cases, we perform an actual XYZ move and cancel
@@ -313,14 +348,13 @@ std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &co
     m_lifted = 0;
     m_pos = point;
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter gcode(out);
+    gcode.emit("G1").emit_axis("X", point(0), XYZF_DIGITS)
+                    .emit_axis("Y", point(1), XYZF_DIGITS)
+                    .emit_axis("Z", point(2), XYZF_DIGITS)
+                    .emit_axis("F", this->config.travel_speed.value * 60.0, XYZF_DIGITS);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.emit_eol();
 }
 
 std::string GCodeWriter::travel_to_z(double z, const std::string &comment)
@@ -346,12 +380,13 @@ std::string GCodeWriter::_travel_to_z(double z, const std::string &comment)
 {
     m_pos(2) = z;
     
-    std::ostringstream gcode;
-    gcode << "G1 Z" << XYZF_NUM(z)
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    std::string out;
+    GCodeFormatter gcode(out);
+    gcode.emit("G1").emit_axis("Z", z, XYZF_DIGITS)
+                    .emit_axis("F", this->config.travel_speed.value * 60.0, XYZF_DIGITS);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.emit_eol();
+    return out;
 }
 
 bool GCodeWriter::will_move_z(double z) const
@@ -366,35 +401,33 @@ bool GCodeWriter::will_move_z(double z) const
     return true;
 }
 
-std::string GCodeWriter::extrude_to_xy(const Vec2d &point, double dE, const std::string &comment)
+void GCodeWriter::extrude_to_xy(std::string &out, const Vec2d &point, double dE, const std::string &comment)
 {
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter gcode(out);
+    gcode.emit("G1").emit_axis("X", point(0), XYZF_DIGITS)
+                    .emit_axis("Y", point(1), XYZF_DIGITS)
+                    .emit_axis(m_extrusion_axis.c_str(), m_extruder->E(), E_DIGITS);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.emit_eol();
 }
 
-std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment)
+void GCodeWriter::extrude_to_xyz(std::string &out, const Vec3d &point, double dE, const std::string &comment)
 {
     m_pos = point;
     m_lifted = 0;
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
-    COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    GCodeFormatter gcode(out);
+    gcode.emit("G1").emit_axis("X", point(0), XYZF_DIGITS)
+                    .emit_axis("Y", point(1), XYZF_DIGITS)
+                    .emit_axis("Z", point(2), XYZF_DIGITS)
+                    .emit_axis(m_extrusion_axis.c_str(), m_extruder->E(), E_DIGITS);
+    gcode.emit_comment(this->config.gcode_comments, comment);
+    gcode.emit_eol();
 }
 
 std::string GCodeWriter::retract(bool before_wipe)
@@ -421,7 +454,8 @@ std::string GCodeWriter::retract_for_toolchange(bool before_wipe)
 
 std::string GCodeWriter::_retract(double length, double restart_extra, const std::string &comment)
 {
-    std::ostringstream gcode;
+    std::string    out;
+    GCodeFormatter gcode(out);
     
     /*  If firmware retraction is enabled, we use a fake value of 1
         since we ignore the actual configured retract_length which 
@@ -440,48 +474,49 @@ std::string GCodeWriter::_retract(double length, double restart_extra, const std
     if (dE != 0) {
         if (this->config.use_firmware_retraction) {
             if (FLAVOR_IS(gcfMachinekit))
-                gcode << "G22 ; retract\n";
+                gcode.emit("G22 ; retract\n");
             else
-                gcode << "G10 ; retract\n";
+                gcode.emit("G10 ; retract\n");
         } else {
-            gcode << "G1 " << m_extrusion_axis << E_NUM(m_extruder->E())
-                           << " F" << float(m_extruder->retract_speed() * 60.);
-            COMMENT(comment);
-            gcode << "\n";
+            gcode.emit("G1").emit_axis(m_extrusion_axis.c_str(), m_extruder->E(), E_DIGITS)
+                            .emit_axis("F", float(m_extruder->retract_speed() * 60.), E_DIGITS);
+            gcode.emit_comment(this->config.gcode_comments, comment);
+            gcode.emit_eol();
         }
     }
     
     if (FLAVOR_IS(gcfMakerWare))
-        gcode << "M103 ; extruder off\n";
+        gcode.emit("M103 ; extruder off\n");
     
-    return gcode.str();
+    return out;
 }
 
 std::string GCodeWriter::unretract()
 {
-    std::ostringstream gcode;
+    std::string    out;
+    GCodeFormatter gcode(out);
     
     if (FLAVOR_IS(gcfMakerWare))
-        gcode << "M101 ; extruder on\n";
+        gcode.emit("M101 ; extruder on\n");
     
     double dE = m_extruder->unretract();
     if (dE != 0) {
         if (this->config.use_firmware_retraction) {
             if (FLAVOR_IS(gcfMachinekit))
-                 gcode << "G23 ; unretract\n";
+                 gcode.emit("G23 ; unretract\n");
             else
-                 gcode << "G11 ; unretract\n";
-            gcode << this->reset_e();
+                 gcode.emit("G11 ; unretract\n");
+            gcode.emit(this->reset_e());
         } else {
             // use G1 instead of G0 because G0 will blend the restart with the previous travel move
-            gcode << "G1 " << m_extrusion_axis << E_NUM(m_extruder->E())
-                           << " F" << float(m_extruder->deretract_speed() * 60.);
-            if (this->config.gcode_comments) gcode << " ; unretract";
-            gcode << "\n";
+            gcode.emit("G1").emit_axis(m_extrusion_axis.c_str(), m_extruder->E(), E_DIGITS)
+                            .emit_axis("F", float(m_extruder->deretract_speed() * 60.), E_DIGITS);
+            if (this->config.gcode_comments) gcode.emit(" ; unretract");
+            gcode.emit_eol();
         }
     }
     
-    return gcode.str();
+    return out;
 }
 
 /*  If this method is called more than once before calling unlift(),
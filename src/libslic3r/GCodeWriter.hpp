@@ -10,6 +10,38 @@
 
 namespace Slic3r {
 
+// Appends G-code to an output string without going through temporary strings or string streams.
+// Numbers are formatted with a fixed number of decimal digits using integer arithmetic, producing the same text
+// as std::fixed << std::setprecision(digits) does.
+class GCodeFormatter {
+public:
+    explicit GCodeFormatter(std::string &out) : m_out(out) {}
+
+    GCodeFormatter& emit(const char *s)         { m_out += s; return *this; }
+    GCodeFormatter& emit(const std::string &s)  { m_out += s; return *this; }
+    // Emit " <axis><value>" with a fixed number of decimal digits.
+    GCodeFormatter& emit_axis(const char *axis, double value, int digits) {
+        char buf[64];
+        m_out += ' ';
+        m_out += axis;
+        m_out.append(buf, format_fixed(buf, value, digits));
+        return *this;
+    }
+    GCodeFormatter& emit_comment(bool allow, const std::string &comment) {
+        if (allow && ! comment.empty())
+            m_out.append(" ; ").append(comment);
+        return *this;
+    }
+    void            emit_eol() { m_out += '\n'; }
+
+    // Format value with digits (at most 9) decimal places into buf, which has to hold at least 64 characters.
+    // Returns a pointer past the last character written, the output is not zero terminated.
+    static char*    format_fixed(char *buf, double value, int digits);
+
+private:
+    std::string &m_out;
+};
+
 class GCodeWriter {
 public:
     GCodeConfig config;
@@ -54,13 +86,24 @@ public:
     // printed with the same extruder.
     std::string toolchange_prefix() const;
     std::string toolchange(unsigned int extruder_id);
-    std::string set_speed(double F, const std::string &comment = std::string(), const std::string &cooling_marker = std::string()) const;
-    std::string travel_to_xy(const Vec2d &point, const std::string &comment = std::string());
-    std::string travel_to_xyz(const Vec3d &point, const std::string &comment = std::string());
+    std::string set_speed(double F, const std::string &comment = std::string(), const std::string &cooling_marker = std::string()) const
+        { std::string out; this->set_speed(out, F, comment, cooling_marker); return out; }
+    std::string travel_to_xy(const Vec2d &point, const std::string &comment = std::string())
+        { std::string out; this->travel_to_xy(out, point, comment); return out; }
+    std::string travel_to_xyz(const Vec3d &point, const std::string &comment = std::string())
+        { std::string out; this->travel_to_xyz(out, point, comment); return out; }
     std::string travel_to_z(double z, const std::string &comment = std::string());
     bool        will_move_z(double z) const;
-    std::string extrude_to_xy(const Vec2d &point, double dE, const std::string &comment = std::string());
-    std::string extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment = std::string());
+    std::string extrude_to_xy(const Vec2d &point, double dE, const std::string &comment = std::string())
+        { std::string out; this->extrude_to_xy(out, point, dE, comment); return out; }
+    std::string extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment = std::string())
+        { std::string out; this->extrude_to_xyz(out, point, dE, comment); return out; }
+    // Variants of the above appending the G-code to an output string, to be used in the hot loops of the G-code export.
+    void        set_speed(std::string &out, double F, const std::string &comment = std::string(), const std::string &cooling_marker = std::string()) const;
+    void        travel_to_xy(std::string &out, const Vec2d &point, const std::string &comment = std::string());
+    void        travel_to_xyz(std::string &out, const Vec3d &point, const std::string &comment = std::string());
+    void        extrude_to_xy(std::string &out, const Vec2d &point, double dE, const std::string &comment = std::string());
+    void        extrude_to_xyz(std::string &out, const Vec3d &point, double dE, const std::string &comment = std::string());
     std::string retract(bool before_wipe = false);
     std::string retract_for_toolchange(bool before_wipe = false);
     std::string unretract();
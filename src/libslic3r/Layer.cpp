@@ -2,6 +2,7 @@
 #include "ClipperUtils.hpp"
 #include "Print.hpp"
 #include "Fill/Fill.hpp"
+#include "GCode/SeamPlacer.hpp"
 #include "ShortestPath.hpp"
 #include "SVG.hpp"
 
@@ -191,6 +192,19 @@ void Layer::make_perimeters()
     BOOST_LOG_TRIVIAL(trace) << "Generating perimeters for layer " << this->id() << " - Done";
 }
 
+// The seam penalties are independent of the position the loops are approached from. Overhangs are detected over the edge grid
+// of the layer below, which is shared with the G-code export.
+void Layer::make_seams()
+{
+    const PrintConfig    &print_config          = this->object()->print()->config();
+    const EdgeGrid::Grid *lower_layer_edge_grid = (this->lower_layer == nullptr) ? nullptr : this->lower_layer->lslices_edge_grid.get();
+    for (LayerRegion *layerm : m_regions) {
+        // The perimeters of a region are assigned to the first region with the same perimeter extruder by Layer::make_perimeters().
+        float nozzle_dmr = float(print_config.nozzle_diameter.get_at(std::max(0, layerm->region()->config().perimeter_extruder.value - 1)));
+        make_seam_penalties(layerm->perimeters, nozzle_dmr, lower_layer_edge_grid);
+    }
+}
+
 void Layer::export_region_slices_to_svg(const char *path) const
 {
     BoundingBox bbox;
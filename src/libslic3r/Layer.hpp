@@ -7,8 +7,14 @@
 #include "ExtrusionEntityCollection.hpp"
 #include "ExPolygonCollection.hpp"
 
+#include <memory>
+
 namespace Slic3r {
 
+namespace EdgeGrid {
+    class Grid;
+}
+
 class Layer;
 class PrintRegion;
 class PrintObject;
@@ -112,6 +118,9 @@ public:
     // that the 1st lslice is not compensated by the Elephant foot compensation algorithm.
     ExPolygons 				 lslices;
     std::vector<BoundingBox> lslices_bboxes;
+    // Edge grid with a signed distance field over the lslices, created by PrintObject::make_seams() to avoid placing the seams
+    // of the layer above over overhangs. Reused by the G-code export. Layers with the same lslices as the layer below share its grid.
+    std::shared_ptr<const EdgeGrid::Grid> lslices_edge_grid;
 
     size_t                  region_count() const { return m_regions.size(); }
     const LayerRegion*      get_region(int idx) const { return m_regions.at(idx); }
@@ -134,6 +143,8 @@ public:
         return false;
     }
     void                    make_perimeters();
+    // Calculate the seam penalties of the perimeters over the lslices_edge_grid of the layer below.
+    void                    make_seams();
     void                    make_fills();
     void 					make_ironing();
 
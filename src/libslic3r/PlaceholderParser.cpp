@@ -1,10 +1,15 @@
 #include "PlaceholderParser.hpp"
 #include "Flow.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
 #include <cstring>
 #include <ctime>
 #include <iomanip>
 #include <sstream>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 #ifdef _MSC_VER
     #include <stdlib.h>  // provides **_environ
 #else
@@ -180,6 +185,24 @@ namespace client
         return os;
     }
 
+    // Regular expressions are compiled once and shared, as the same custom G-code templates are processed at each layer or tool change.
+    // Throws regex_error if the pattern fails to compile.
+    static std::shared_ptr<const SLIC3R_REGEX_NAMESPACE::regex> compiled_regex(const std::string &pattern)
+    {
+        static std::mutex                                                                           mutex;
+        static std::unordered_map<std::string, std::shared_ptr<const SLIC3R_REGEX_NAMESPACE::regex>> cache;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(pattern);
+        if (it == cache.end()) {
+            auto regex = std::make_shared<const SLIC3R_REGEX_NAMESPACE::regex>(pattern);
+            // Just a handful of regular expressions is expected, don't let the cache grow without bounds.
+            if (cache.size() >= 1024)
+                cache.clear();
+            it = cache.emplace(pattern, std::move(regex)).first;
+        }
+        return it->second;
+    }
+
     template<typename Iterator>
     struct expr
     {
@@ -539,7 +562,7 @@ namespace client
             }
             try {
                 std::string pattern(++ rhs.begin(), -- rhs.end());
-                bool result = SLIC3R_REGEX_NAMESPACE::regex_match(*subject, SLIC3R_REGEX_NAMESPACE::regex(pattern));
+                bool result = SLIC3R_REGEX_NAMESPACE::regex_match(*subject, *compiled_regex(pattern));
                 if (op == '!')
                     result = ! result;
                 lhs.reset();
@@ -1283,23 +1306,28 @@ namespace client
     };
 }
 
-static std::string process_macro(const std::string &templ, client::MyContext &context)
+typedef std::string::const_iterator                  template_iterator;
+typedef client::macro_processor<template_iterator>  template_macro_processor;
+
+// Our grammar, statically allocated inside the function, meaning it will be allocated the first time
+// PlaceholderParser::process() runs.
+//FIXME this kind of initialization is not thread safe!
+static const template_macro_processor& macro_processor_instance()
 {
-    typedef std::string::const_iterator iterator_type;
-    typedef client::macro_processor<iterator_type> macro_processor;
+    static template_macro_processor instance;
+    return instance;
+}
 
+static std::string process_macro(const std::string &templ, client::MyContext &context)
+{
     // Our whitespace skipper.
     spirit_encoding::space_type space;
-    // Our grammar, statically allocated inside the method, meaning it will be allocated the first time
-    // PlaceholderParser::process() runs.
-    //FIXME this kind of initialization is not thread safe!
-    static macro_processor      macro_processor_instance;
     // Iterators over the source template.
     std::string::const_iterator iter = templ.begin();
     std::string::const_iterator end  = templ.end();
     // Accumulator for the processed template.
     std::string                 output;
-    phrase_parse(iter, end, macro_processor_instance(&context), space, output);
+    phrase_parse(iter, end, macro_processor_instance()(&context), space, output);
 	if (!context.error_message.empty()) {
         if (context.error_message.back() != '\n' && context.error_message.back() != '\r')
             context.error_message += '\n';
@@ -1308,6 +1336,225 @@ static std::string process_macro(const std::string &templ, client::MyContext &co
     return output;
 }
 
+// A template split into the free-form text and the macro blocks at the top level of the template.
+// The free-form text is copied to the output without running the macro processor over it, simple variable
+// references are expanded directly, and only the remaining macro blocks are parsed by the macro processor.
+struct CompiledTemplate
+{
+    enum SegmentType {
+        // Free-form text, copied verbatim.
+        stText,
+        // [variable] in the legacy syntax, the span is the variable name.
+        stLegacyVariable,
+        // {variable}, the span is the variable name.
+        stVariable,
+        // Any other [] or {} block including the braces, processed by the macro processor.
+        stMacro,
+    };
+    struct Segment {
+        SegmentType type;
+        size_t      begin;
+        size_t      end;
+    };
+    // If false, the template could not be split reliably and it is processed by the macro processor as a whole.
+    bool                 valid { false };
+    std::vector<Segment> segments;
+};
+
+// Stricter than the utf8_char_skipper_parser, which does not validate the last byte of a sequence.
+// On a valid UTF-8 text none of the ASCII delimiters is swallowed by a multi-byte sequence, thus the template
+// may be split byte by byte at the same positions, where the macro processor would split it.
+static bool is_valid_utf8(const std::string &str)
+{
+    for (size_t i = 0; i < str.size();) {
+        unsigned char c   = static_cast<unsigned char>(str[i ++]);
+        size_t        cnt = (c < 0x80) ? 0 : ((c & 0xE0) == 0xC0) ? 1 : ((c & 0xF0) == 0xE0) ? 2 : ((c & 0xF8) == 0xF0) ? 3 : size_t(-1);
+        if (cnt == size_t(-1) || i + cnt > str.size())
+            return false;
+        for (; cnt > 0; -- cnt)
+            if ((static_cast<unsigned char>(str[i ++]) & 0xC0) != 0x80)
+                return false;
+    }
+    return true;
+}
+
+static bool is_template_space(char c)
+{
+    return spirit::char_encoding::iso8859_1::isspace(static_cast<unsigned char>(c));
+}
+
+// Is the span a valid identifier of the macro language, and not a keyword?
+static bool is_plain_identifier(const std::string &templ, size_t begin, size_t end)
+{
+    auto is_alpha = [](char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; };
+    if (begin == end || ! is_alpha(templ[begin]))
+        return false;
+    for (size_t i = begin + 1; i < end; ++ i)
+        if (! is_alpha(templ[i]) && ! (templ[i] >= '0' && templ[i] <= '9'))
+            return false;
+    static const std::vector<std::string> keywords { "and", "if", "int", "else", "elsif", "endif", "false", "min", "max", "not", "or", "true" };
+    return std::find(keywords.begin(), keywords.end(), templ.substr(begin, end - begin)) == keywords.end();
+}
+
+// Find the end of a legacy variable expansion starting with '[' at begin.
+// Returns std::string::npos if the closing bracket was not found.
+static size_t legacy_variable_expansion_end(const std::string &templ, size_t begin)
+{
+    int depth = 0;
+    for (size_t i = begin; i < templ.size(); ++ i)
+        if (templ[i] == '[')
+            ++ depth;
+        else if (templ[i] == ']' && -- depth == 0)
+            return i + 1;
+    return std::string::npos;
+}
+
+// Find the end of a macro block starting with '{' at begin, including the text blocks of an {if} macro
+// up to the closing {endif}. Returns std::string::npos if the end of the macro could not be found reliably.
+static size_t macro_end(const std::string &templ, size_t begin)
+{
+    // Nesting level of the {if} macros.
+    int    depth = 0;
+    size_t i     = begin;
+    for (;;) {
+        // Skip the opening brace and white spaces.
+        assert(templ[i] == '{');
+        for (++ i; i < templ.size() && is_template_space(templ[i]); ++ i) ;
+        size_t word_end = i;
+        while (word_end < templ.size() && (std::isalnum(static_cast<unsigned char>(templ[word_end])) || templ[word_end] == '_'))
+            ++ word_end;
+        std::string word = templ.substr(i, word_end - i);
+        if (word == "if")
+            ++ depth;
+        else if (word == "endif" && -- depth < 0)
+            return std::string::npos;
+        // Skip the expression up to the closing brace, including string literals and regular expressions, which may contain braces.
+        char last = 0, before_last = 0;
+        for (; i < templ.size() && templ[i] != '}'; ++ i) {
+            char c = templ[i];
+            if (c == '{')
+                return std::string::npos;
+            if (c == '"' || (c == '/' && last == '~' && (before_last == '=' || before_last == '!'))) {
+                for (++ i; i < templ.size() && templ[i] != c; ++ i)
+                    if (templ[i] == '\\')
+                        ++ i;
+                if (i >= templ.size())
+                    return std::string::npos;
+            }
+            if (! is_template_space(c)) {
+                before_last = last;
+                last        = c;
+            }
+        }
+        if (i == templ.size())
+            return std::string::npos;
+        // Skip the closing brace.
+        if (depth == 0)
+            return i + 1;
+        // Skip the text block of an {if} macro up to the next macro.
+        for (++ i; i < templ.size() && templ[i] != '{'; ++ i)
+            if (templ[i] == '[') {
+                i = legacy_variable_expansion_end(templ, i);
+                if (i == std::string::npos)
+                    return std::string::npos;
+                -- i;
+            }
+        if (i == templ.size())
+            return std::string::npos;
+    }
+}
+
+static CompiledTemplate compile_template(const std::string &templ)
+{
+    CompiledTemplate out;
+    if (! is_valid_utf8(templ))
+        return out;
+    // The macro processor skips white spaces at the start of the template.
+    size_t i = 0;
+    while (i < templ.size() && is_template_space(templ[i]))
+        ++ i;
+    while (i < templ.size()) {
+        size_t begin = i;
+        if (templ[i] == '[' || templ[i] == '{') {
+            bool legacy = templ[i] == '[';
+            i = legacy ? legacy_variable_expansion_end(templ, i) : macro_end(templ, i);
+            if (i == std::string::npos)
+                return out;
+            out.segments.push_back(is_plain_identifier(templ, begin + 1, i - 1) ?
+                CompiledTemplate::Segment{ legacy ? CompiledTemplate::stLegacyVariable : CompiledTemplate::stVariable, begin + 1, i - 1 } :
+                CompiledTemplate::Segment{ CompiledTemplate::stMacro, begin, i });
+        } else {
+            while (i < templ.size() && templ[i] != '[' && templ[i] != '{')
+                ++ i;
+            out.segments.push_back({ CompiledTemplate::stText, begin, i });
+        }
+    }
+    out.valid = true;
+    return out;
+}
+
+// Compiled templates are cached by the template text and shared by all PlaceholderParser instances,
+// as the same custom G-code templates are processed at each layer or tool change.
+static std::shared_ptr<const CompiledTemplate> compiled_template(const std::string &templ)
+{
+    static std::mutex                                                                mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const CompiledTemplate>> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(templ);
+    if (it == cache.end()) {
+        // Just a handful of custom G-code templates is expected, don't let the cache grow without bounds.
+        if (cache.size() >= 1024)
+            cache.clear();
+        it = cache.emplace(templ, std::make_shared<const CompiledTemplate>(compile_template(templ))).first;
+    }
+    return it->second;
+}
+
+// Process a compiled template. Returns false if a macro block failed, leaving it to the caller
+// to run the macro processor over the whole template to produce the error message with the right line numbers.
+static bool process_compiled(const std::string &templ, const CompiledTemplate &compiled, client::MyContext &context, std::string &output)
+{
+    typedef boost::iterator_range<template_iterator> iterator_range;
+    spirit_encoding::space_type space;
+    for (const CompiledTemplate::Segment &segment : compiled.segments) {
+        template_iterator begin = templ.begin() + segment.begin;
+        template_iterator end   = templ.begin() + segment.end;
+        switch (segment.type) {
+        case CompiledTemplate::stText:
+            output.append(begin, end);
+            break;
+        case CompiledTemplate::stLegacyVariable:
+        {
+            iterator_range opt_key(begin, end);
+            std::string    value;
+            client::MyContext::legacy_variable_expansion(&context, opt_key, value);
+            output += value;
+            break;
+        }
+        case CompiledTemplate::stVariable:
+        {
+            iterator_range                       opt_key(begin, end);
+            client::OptWithPos<template_iterator> opt;
+            client::expr<template_iterator>       value;
+            client::MyContext::resolve_variable(&context, opt_key, opt);
+            client::MyContext::scalar_variable_reference(&context, opt, value);
+            output += value.to_string();
+            break;
+        }
+        case CompiledTemplate::stMacro:
+        {
+            std::string value;
+            phrase_parse(begin, end, macro_processor_instance()(&context), space, value);
+            if (! context.error_message.empty())
+                return false;
+            output += value;
+            break;
+        }
+        }
+    }
+    return true;
+}
+
 std::string PlaceholderParser::process(const std::string &templ, unsigned int current_extruder_id, const DynamicConfig *config_override) const
 {
     client::MyContext context;
@@ -1315,6 +1562,17 @@ std::string PlaceholderParser::process(const std::string &templ, unsigned int cu
     context.config              = &this->config();
     context.config_override     = config_override;
     context.current_extruder_id = current_extruder_id;
+    std::shared_ptr<const CompiledTemplate> compiled = compiled_template(templ);
+    if (compiled->valid) {
+        std::string output;
+        try {
+            if (process_compiled(templ, *compiled, context, output))
+                return output;
+        } catch (...) {
+        }
+        // Process the template as a whole to report the error the same way as if the template was not compiled.
+        context.error_message.clear();
+    }
     return process_macro(templ, context);
 }
 
@@ -1583,6 +1583,8 @@ void Print::process()
     BOOST_LOG_TRIVIAL(info) << "Staring the slicing process." << log_memory_info();
     for (PrintObject *obj : m_objects)
         obj->make_perimeters();
+    for (PrintObject *obj : m_objects)
+        obj->make_seams();
     this->set_status(70, L("Infilling layers"));
     for (PrintObject *obj : m_objects)
         obj->infill();
@@ -41,7 +41,7 @@ enum PrintStep {
 };
 
 enum PrintObjectStep {
-    posSlice, posPerimeters, posPrepareInfill,
+    posSlice, posPerimeters, posSeam, posPrepareInfill,
     posInfill, posIroning, posSupportMaterial, posCount,
 };
 
@@ -215,6 +215,7 @@ private:
 
 private:
     void make_perimeters();
+    void make_seams();
     void prepare_infill();
     void infill();
     void ironing();
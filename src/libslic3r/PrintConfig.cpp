@@ -3486,6 +3486,14 @@ CLIActionsConfigDef::CLIActionsConfigDef()
     def->tooltip = L("Write information about the model to the console.");
     def->set_default_value(new ConfigOptionBool(false));
 
+    def = this->add("gcode_analyze", coString);
+    def->label = L("Analyze G-code");
+    def->tooltip = L("Estimate the printing time and collect the filament usage, per extrusion role and per layer statistics "
+                     "of an existing G-code file for the printer configuration given on the command line. "
+                     "The statistics are written to the console as JSON.");
+    def->cli = "gcode-analyze";
+    def->set_default_value(new ConfigOptionString());
+
     def = this->add("save", coString);
     def->label = L("Save config file");
     def->tooltip = L("Save configuration to the specified file.");
@@ -1,10 +1,12 @@
 #include "Print.hpp"
 #include "BoundingBox.hpp"
 #include "ClipperUtils.hpp"
+#include "EdgeGrid.hpp"
 #include "ElephantFootCompensation.hpp"
 #include "Geometry.hpp"
 #include "I18N.hpp"
 #include "Layer.hpp"
+#include "GCode/SeamPlacer.hpp"
 #include "SupportMaterial.hpp"
 #include "Surface.hpp"
 #include "Slicing.hpp"
@@ -248,6 +250,72 @@ void PrintObject::make_perimeters()
     this->set_done(posPerimeters);
 }
 
+// Calculate the seam placement penalties of the perimeter loops, which do not depend on the position the loops are approached from.
+// G-code export then only evaluates the distance of the seam candidates to the preferred seam position.
+void PrintObject::make_seams()
+{
+    // prerequisites
+    this->make_perimeters();
+
+    if (! this->set_started(posSeam))
+        return;
+
+    // Drop the penalties and the edge grids of a previous run, for example before the seam position was switched to random.
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_layers.size()),
+        [this](const tbb::blocked_range<size_t>& range) {
+            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                Layer *layer = m_layers[layer_idx];
+                layer->lslices_edge_grid.reset();
+                for (LayerRegion *layerm : layer->regions())
+                    clear_seam_penalties(layerm->perimeters);
+            }
+        }
+    );
+
+    const SeamPosition seam_position = m_config.seam_position.value;
+    if (! m_print->config().spiral_vase && (seam_position == spNearest || seam_position == spAligned || seam_position == spRear)) {
+        BOOST_LOG_TRIVIAL(debug) << "Calculating seam penalties in parallel - start";
+        // Edge grids over the slices of the layers below the top layer. A layer with the same slices as the layer below,
+        // which is common for the prismatic parts of an object, shares the grid of the layer below.
+        const size_t num_lower_layers = m_layers.empty() ? 0 : m_layers.size() - 1;
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, num_lower_layers),
+            [this](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    Layer *layer = m_layers[layer_idx];
+                    if (layer->lower_layer == nullptr || layer->lslices != layer->lower_layer->lslices) {
+                        const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
+                        auto grid = std::make_shared<EdgeGrid::Grid>();
+                        grid->create(layer->lslices, distance_field_resolution);
+                        // Most of the queries are answered from the edges close to the loop, calculate the signed distance field on demand.
+                        grid->enable_lazy_sdf();
+                        layer->lslices_edge_grid = std::move(grid);
+                    }
+                }
+            }
+        );
+        for (size_t layer_idx = 1; layer_idx < num_lower_layers; ++ layer_idx)
+            if (! m_layers[layer_idx]->lslices_edge_grid)
+                m_layers[layer_idx]->lslices_edge_grid = m_layers[layer_idx - 1]->lslices_edge_grid;
+        m_print->throw_if_canceled();
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, m_layers.size()),
+            [this](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    m_layers[layer_idx]->make_seams();
+                }
+            }
+        );
+        m_print->throw_if_canceled();
+        BOOST_LOG_TRIVIAL(debug) << "Calculating seam penalties in parallel - end";
+    }
+
+    this->set_done(posSeam);
+}
+
 void PrintObject::prepare_infill()
 {
     if (! this->set_started(posPrepareInfill))
@@ -564,9 +632,10 @@ bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_
             	steps.emplace_back(posInfill);
 	            steps.emplace_back(posSupportMaterial);
 	        }
+        } else if (opt_key == "seam_position") {
+            steps.emplace_back(posSeam);
         } else if (
-               opt_key == "seam_position"
-            || opt_key == "seam_preferred_direction"
+               opt_key == "seam_preferred_direction"
             || opt_key == "seam_preferred_direction_jitter"
             || opt_key == "support_material_speed"
             || opt_key == "support_material_interface_speed"
@@ -602,14 +671,14 @@ bool PrintObject::invalidate_step(PrintObjectStep step)
     
     // propagate to dependent steps
     if (step == posPerimeters) {
-		invalidated |= this->invalidate_steps({ posPrepareInfill, posInfill });
+		invalidated |= this->invalidate_steps({ posSeam, posPrepareInfill, posInfill });
         invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
     } else if (step == posPrepareInfill) {
         invalidated |= this->invalidate_step(posInfill);
     } else if (step == posInfill) {
         invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
     } else if (step == posSlice) {
-		invalidated |= this->invalidate_steps({ posPerimeters, posPrepareInfill, posInfill, posSupportMaterial });
+		invalidated |= this->invalidate_steps({ posPerimeters, posSeam, posPrepareInfill, posInfill, posSupportMaterial });
 		invalidated |= m_print->invalidate_steps({ psSkirt, psBrim });
         this->m_slicing_params.valid = false;
     } else if (step == posSupportMaterial) {
@@ -16,7 +16,6 @@
 
 #include <agg/agg_scanline_p.h>
 #include <agg/agg_rasterizer_scanline_aa.h>
-#include <agg/agg_path_storage.h>
 
 namespace Slic3r {
 
@@ -64,66 +63,63 @@ protected:
     Scanline m_scanlines;
     Rasterizer m_rasterizer;
     
-    void flipy(agg::path_storage &path) const
+    // Transform a point in scaled coordinates into pixel coordinates.
+    agg::point_d to_px(double x, double y) const
     {
-        path.flip_y(0, double(m_resolution.height_px));
-    }
-    
-    void flipx(agg::path_storage &path) const
-    {
-        path.flip_x(0, double(m_resolution.width_px));
+        double px = m_trafo.flipXY ? y * m_pxdim_scaled.h_mm : x * m_pxdim_scaled.w_mm;
+        double py = m_trafo.flipXY ? x * m_pxdim_scaled.w_mm : y * m_pxdim_scaled.h_mm;
+        
+        px += m_trafo.center_x * m_pxdim_scaled.w_mm;
+        py += m_trafo.center_y * m_pxdim_scaled.h_mm;
+        
+        if (m_trafo.mirror_x) px = double(m_resolution.width_px) - px;
+        if (m_trafo.mirror_y) py = double(m_resolution.height_px) - py;
+        
+        return {px, py};
     }
     
-    double getPx(const Point &p) { return p(0) * m_pxdim_scaled.w_mm; }
-    double getPy(const Point &p) { return p(1) * m_pxdim_scaled.h_mm; }
-    agg::path_storage to_path(const Polygon &poly) { return to_path(poly.points); }
-    double getPx(const ClipperLib::IntPoint &p) { return p.X * m_pxdim_scaled.w_mm; }
-    double getPy(const ClipperLib::IntPoint& p) { return p.Y * m_pxdim_scaled.h_mm; }
+    agg::point_d to_px(const Point &p) const { return to_px(double(p(0)), double(p(1))); }
+    agg::point_d to_px(const ClipperLib::IntPoint &p) const { return to_px(double(p.X), double(p.Y)); }
     
-    template<class PointVec> agg::path_storage _to_path(const PointVec& v)
+    // Feed a closed contour to the rasterizer, transforming the scaled
+    // coordinates into pixels on the fly instead of through an intermediate
+    // agg::path_storage.
+    template<class PointVec> void add_contour(const PointVec &v)
     {
-        agg::path_storage path;
-        
-        auto it = v.begin();
-        path.move_to(getPx(*it), getPy(*it));
-        while(++it != v.end()) path.line_to(getPx(*it), getPy(*it));
-        path.line_to(getPx(v.front()), getPy(v.front()));
+        if (v.empty()) return;
         
-        return path;
+        agg::point_d p = to_px(v.front());
+        m_rasterizer.move_to_d(p.x, p.y);
+        for (auto it = std::next(v.begin()); it != v.end(); ++it) {
+            agg::point_d q = to_px(*it);
+            m_rasterizer.line_to_d(q.x, q.y);
+        }
+        m_rasterizer.line_to_d(p.x, p.y);
     }
     
-    template<class PointVec> agg::path_storage _to_path_flpxy(const PointVec& v)
+    void add_contour(const Polygon &poly) { add_contour(poly.points); }
+    
+    template<class P> void add_polygon(const P &poly)
     {
-        agg::path_storage path;
-        
-        auto it = v.begin();
-        path.move_to(getPy(*it), getPx(*it));
-        while(++it != v.end()) path.line_to(getPy(*it), getPx(*it));
-        path.line_to(getPy(v.front()), getPx(v.front()));
-        
-        return path;
+        add_contour(contour(poly));
+        for (auto &h : holes(poly)) add_contour(h);
     }
     
-    template<class PointVec> agg::path_storage to_path(const PointVec &v)
+    template<class P> void _draw(const P &poly)
     {
-        auto path = m_trafo.flipXY ? _to_path_flpxy(v) : _to_path(v);
-        
-        path.translate_all_paths(m_trafo.center_x * m_pxdim_scaled.w_mm,
-                                 m_trafo.center_y * m_pxdim_scaled.h_mm);
-        
-        if(m_trafo.mirror_x) flipx(path);
-        if(m_trafo.mirror_y) flipy(path);
-        
-        return path;
+        m_rasterizer.reset();
+        add_polygon(poly);
+        agg::render_scanlines(m_rasterizer, m_scanlines, m_renderer);
     }
     
-    template<class P> void _draw(const P &poly)
+    // All the polygons are accumulated and swept in a single pass. Coverage
+    // of overlapping polygons is summed by the non-zero fill rule instead of
+    // being blended, which makes no difference for the non-overlapping
+    // polygons of a layer.
+    template<class Polys> void _draw_all(const Polys &polys)
     {
         m_rasterizer.reset();
-        
-        m_rasterizer.add_path(to_path(contour(poly)));
-        for(auto& h : holes(poly)) m_rasterizer.add_path(to_path(h));
-        
+        for (auto &poly : polys) add_polygon(poly);
         agg::render_scanlines(m_rasterizer, m_scanlines, m_renderer);
     }
     
@@ -162,6 +158,8 @@ public:
     
     void draw(const ExPolygon &poly) override { _draw(poly); }
     void draw(const ClipperLib::Polygon &poly) override { _draw(poly); }
+    void draw(const ExPolygons &polys) override { _draw_all(polys); }
+    void draw(const std::vector<ClipperLib::Polygon> &polys) override { _draw_all(polys); }
     
     EncodedRaster encode(RasterEncoder encoder) const override
     {
@@ -92,6 +92,35 @@ std::vector<PointIndexEl> PointIndex::nearest(const Vec3d &el, unsigned k = 1) c
     return ret;
 }
 
+std::vector<PointIndexEl>
+PointIndex::nearest(const Vec3d &el,
+                    unsigned k,
+                    std::function<bool(const PointIndexEl &)> filter) const
+{
+    namespace bgi = boost::geometry::index;
+    std::vector<PointIndexEl> ret; ret.reserve(k);
+    m_impl->m_store.query(bgi::nearest(el, k) && bgi::satisfies(filter),
+                          std::back_inserter(ret));
+    return ret;
+}
+
+std::vector<PointIndexEl> PointIndex::within(const Vec3d &center,
+                                             double radius) const
+{
+    namespace bgi = boost::geometry::index;
+    using Box = boost::geometry::model::box<Vec3d>;
+
+    Vec3d r = Vec3d::Constant(radius);
+    std::vector<PointIndexEl> ret;
+    m_impl->m_store.query(
+        bgi::intersects(Box(center - r, center + r)) &&
+            bgi::satisfies([&center, radius](const PointIndexEl &e) {
+                return (center - e.first).norm() < radius;
+            }),
+        std::back_inserter(ret));
+    return ret;
+}
+
 size_t PointIndex::size() const
 {
     return m_impl->m_store.size();
@@ -240,13 +269,20 @@ EigenMesh3D::~EigenMesh3D() {}
 
 EigenMesh3D::EigenMesh3D(const EigenMesh3D &other):
     m_tm(other.m_tm), m_ground_level(other.m_ground_level),
-    m_aabb( new AABBImpl(*other.m_aabb) ) {}
+    m_aabb( new AABBImpl(*other.m_aabb) )
+#ifdef SLIC3R_HOLE_RAYCASTER
+    , m_holes(other.m_holes)
+#endif
+{}
 
 
 EigenMesh3D &EigenMesh3D::operator=(const EigenMesh3D &other)
 {
     m_tm = other.m_tm;
     m_ground_level = other.m_ground_level;
+#ifdef SLIC3R_HOLE_RAYCASTER
+    m_holes = other.m_holes;
+#endif
     m_aabb.reset(new AABBImpl(*other.m_aabb)); return *this;
 }
 
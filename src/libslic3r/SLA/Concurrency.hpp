@@ -4,6 +4,11 @@
 #include <tbb/spin_mutex.h>
 #include <tbb/mutex.h>
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
 
 namespace Slic3r {
 namespace sla {
@@ -29,6 +34,39 @@ template<> struct _ccr<true>
             fn(*(from + decltype(iN)(n)), n);
         });
     }
+    
+    // Compute fn(n) for n in [0, N) in parallel and pass the results to
+    // consumefn(result, n) one at a time in the order of n. Not more than
+    // max_in_flight results are alive at once, the results are kept in a
+    // ring buffer indexed by n, which is safe as TBB does not produce
+    // a new token before the oldest live token leaves the pipeline.
+    template<class Fn, class ConsumeFn>
+    static inline void ordered_pipeline(size_t N, size_t max_in_flight, Fn fn, ConsumeFn consumefn)
+    {
+        using Result = std::decay_t<decltype(fn(size_t(0)))>;
+        
+        max_in_flight = std::max(max_in_flight, size_t(1));
+        std::vector<Result> window(std::min(N, max_in_flight));
+        size_t next = 0;
+        
+        tbb::parallel_pipeline(max_in_flight,
+            tbb::make_filter<void, size_t>(tbb::filter::serial_in_order,
+                [&next, N](tbb::flow_control &fc) {
+                    if (next == N) fc.stop();
+                    return next ++;
+                }) &
+            tbb::make_filter<size_t, size_t>(tbb::filter::parallel,
+                [&window, &fn](size_t n) {
+                    window[n % window.size()] = fn(n);
+                    return n;
+                }) &
+            tbb::make_filter<size_t, void>(tbb::filter::serial_in_order,
+                [&window, &consumefn](size_t n) {
+                    Result &r = window[n % window.size()];
+                    consumefn(std::move(r), n);
+                    r = Result();
+                }));
+    }
 };
 
 template<> struct _ccr<false>
@@ -45,6 +83,12 @@ public:
     {
         for (auto it = from; it != to; ++it) fn(*it, size_t(it - from));
     }
+    
+    template<class Fn, class ConsumeFn>
+    static inline void ordered_pipeline(size_t N, size_t /* max_in_flight */, Fn fn, ConsumeFn consumefn)
+    {
+        for (size_t n = 0; n < N; ++n) consumefn(fn(n), n);
+    }
 };
 
 using ccr = _ccr<USE_FULL_CONCURRENCY>;
@@ -4,10 +4,9 @@
 #include <libslic3r/SLA/Common.hpp>
 
 
-// There is an implementation of a hole-aware raycaster that was eventually
-// not used in production version. It is now hidden under following define
-// for possible future use.
-// #define SLIC3R_HOLE_RAYCASTER
+// The hole-aware raycaster is used by the supports, as the drain holes are
+// cut from the slices and not drilled into the sliced and supported mesh.
+#define SLIC3R_HOLE_RAYCASTER
 
 #ifdef SLIC3R_HOLE_RAYCASTER
   #include "libslic3r/SLA/Hollowing.hpp"
@@ -104,9 +103,6 @@ public:
 
     // Iterates over hits and holes and returns the true hit, possibly
     // on the inside of a hole.
-    // This function is currently not used anywhere, it was written when the
-    // holes were subtracted on slices, that is, before we started using CGAL
-    // to actually cut the holes into the mesh.
     hit_result filter_hits(const std::vector<EigenMesh3D::hit_result>& obj_hits) const;
 #endif
 
@@ -1,4 +1,6 @@
 #include <functional>
+#include <algorithm>
+#include <random>
 
 #include <libslic3r/OpenVDBUtils.hpp>
 #include <libslic3r/TriangleMesh.hpp>
@@ -8,6 +10,7 @@
 #include <libslic3r/SLA/SupportTreeBuilder.hpp>
 #include <libslic3r/ClipperUtils.hpp>
 #include <libslic3r/SimplifyMesh.hpp>
+#include <libslic3r/MeshBoolean.hpp>
 
 #include <boost/log/trivial.hpp>
 
@@ -27,16 +30,32 @@ inline void _scale(S s, TriangleMesh &m) { m.scale(float(s)); }
 template<class S, class = FloatingOnly<S>>
 inline void _scale(S s, Contour3D &m) { for (auto &p : m.points) p *= s; }
 
+// The narrow band of the cached grid is made wider than needed, so that
+// the grid is reused when the wall thickness or the closing distance grows.
+static const float GRID_BAND_RESERVE = 1.5f;
+
+struct InteriorGridCache::Grid {
+    openvdb::FloatGrid::Ptr grid;
+    double                  voxel_scale;
+    float                   out_range;
+    float                   in_range;
+};
+
+InteriorGridCache::InteriorGridCache() = default;
+InteriorGridCache::~InteriorGridCache() = default;
+InteriorGridCache::InteriorGridCache(InteriorGridCache &&) = default;
+InteriorGridCache &InteriorGridCache::operator=(InteriorGridCache &&) = default;
+
+void InteriorGridCache::clear() { m_grid.reset(); }
+
 static TriangleMesh _generate_interior(const TriangleMesh  &mesh,
                                        const JobController &ctl,
                                        double               min_thickness,
                                        double               voxel_scale,
-                                       double               closing_dist)
+                                       double               closing_dist,
+                                       std::unique_ptr<InteriorGridCache::Grid> &cached,
+                                       size_t &builds)
 {
-    TriangleMesh imesh{mesh};
-    
-    _scale(voxel_scale, imesh);
-    
     double offset = voxel_scale * min_thickness;
     double D = voxel_scale * closing_dist;
     float  out_range = 0.1f * float(offset);
@@ -45,18 +64,35 @@ static TriangleMesh _generate_interior(const TriangleMesh  &mesh,
     if (ctl.stopcondition()) return {};
     else ctl.statuscb(0, L("Hollowing"));
     
-    auto gridptr = mesh_to_grid(imesh, {}, out_range, in_range);
-    
-    assert(gridptr);
-    
-    if (!gridptr) {
-        BOOST_LOG_TRIVIAL(error) << "Returned OpenVDB grid is NULL";
-        return {};
-    }
+    if (! cached || cached->voxel_scale != voxel_scale ||
+        cached->out_range < out_range || cached->in_range < in_range) {
+        cached.reset();
+
+        TriangleMesh imesh{mesh};
+        _scale(voxel_scale, imesh);
+
+        float out_band = GRID_BAND_RESERVE * out_range;
+        float in_band  = GRID_BAND_RESERVE * in_range;
+        auto gridptr = mesh_to_grid(imesh, {}, out_band, in_band);
+        
+        assert(gridptr);
+        
+        if (!gridptr) {
+            BOOST_LOG_TRIVIAL(error) << "Returned OpenVDB grid is NULL";
+            return {};
+        }
+
+        cached.reset(new InteriorGridCache::Grid{gridptr, voxel_scale,
+                                                 out_band, in_band});
+        ++ builds;
+    } else
+        BOOST_LOG_TRIVIAL(info) << "Reusing the cached hollowing grid";
     
     if (ctl.stopcondition()) return {};
     else ctl.statuscb(30, L("Hollowing"));
     
+    // The cached grid is shared, the closing creates a new one.
+    openvdb::FloatGrid::Ptr gridptr = cached->grid;
     if (closing_dist > .0) {
         gridptr = redistance_grid(*gridptr, -(offset + D), double(in_range));
     } else {
@@ -81,6 +117,15 @@ static TriangleMesh _generate_interior(const TriangleMesh  &mesh,
 std::unique_ptr<TriangleMesh> generate_interior(const TriangleMesh &   mesh,
                                                 const HollowingConfig &hc,
                                                 const JobController &  ctl)
+{
+    InteriorGridCache cache;
+    return generate_interior(mesh, hc, ctl, cache);
+}
+
+std::unique_ptr<TriangleMesh> generate_interior(const TriangleMesh &   mesh,
+                                                const HollowingConfig &hc,
+                                                const JobController &  ctl,
+                                                InteriorGridCache &    cache)
 {
     static const double MIN_OVERSAMPL = 3.;
     static const double MAX_OVERSAMPL = 8.;
@@ -95,7 +140,7 @@ std::unique_ptr<TriangleMesh> generate_interior(const TriangleMesh &   mesh,
     auto voxel_scale = MIN_OVERSAMPL + (MAX_OVERSAMPL - MIN_OVERSAMPL) * hc.quality;
     auto meshptr = std::make_unique<TriangleMesh>(
         _generate_interior(mesh, ctl, hc.min_thickness, voxel_scale,
-                           hc.closing_distance));
+                           hc.closing_distance, cache.m_grid, cache.m_builds));
     
     if (meshptr) {
         
@@ -245,33 +290,122 @@ bool DrainHole::get_intersections(const Vec3f& s, const Vec3f& dir,
     return true;
 }
 
+void drill_drainholes(TriangleMesh &mesh, const DrainHoles &holes)
+{
+    // Not shared by the objects, which may be drilled in parallel.
+    std::mt19937 rng{std::random_device{}()};
+    std::uniform_real_distribution<float> dist(0., float(EPSILON));
+    auto holes_mesh_cgal = MeshBoolean::cgal::triangle_mesh_to_cgal({});
+    for (DrainHole holept : holes) {
+        holept.normal += Vec3f{dist(rng), dist(rng), dist(rng)};
+        holept.normal.normalize();
+        holept.pos += Vec3f{dist(rng), dist(rng), dist(rng)};
+        TriangleMesh m = sla::to_triangle_mesh(holept.to_mesh());
+        m.require_shared_vertices();
+        auto cgal_m = MeshBoolean::cgal::triangle_mesh_to_cgal(m);
+        MeshBoolean::cgal::plus(*holes_mesh_cgal, *cgal_m);
+    }
+
+    if (MeshBoolean::cgal::does_self_intersect(*holes_mesh_cgal))
+        throw std::runtime_error(L("Too much overlapping holes."));
+
+    auto mesh_cgal = MeshBoolean::cgal::triangle_mesh_to_cgal(mesh);
+
+    try {
+        MeshBoolean::cgal::minus(*mesh_cgal, *holes_mesh_cgal);
+        mesh = MeshBoolean::cgal::cgal_to_triangle_mesh(*mesh_cgal);
+    } catch (const std::runtime_error &) {
+        throw std::runtime_error(L(
+            "Drilling holes into the mesh failed. "
+            "This is usually caused by broken model. Try to fix it first."));
+    }
+}
+
 void cut_drainholes(std::vector<ExPolygons> & obj_slices,
                     const std::vector<float> &slicegrid,
                     float                     closing_radius,
                     const sla::DrainHoles &   holes,
                     std::function<void(void)> thr)
 {
-    TriangleMesh mesh;
-    for (const sla::DrainHole &holept : holes)
-        mesh.merge(sla::to_triangle_mesh(holept.to_mesh()));
-    
-    if (mesh.empty()) return;
-    
-    mesh.require_shared_vertices();
-    
-    TriangleMeshSlicer slicer(&mesh);
-    
-    std::vector<ExPolygons> hole_slices;
-    slicer.slice(slicegrid, SlicingMode::Regular, closing_radius, &hole_slices, thr);
-    
-    if (obj_slices.size() != hole_slices.size())
+    DrainHoleSlices hole_slices;
+    hole_slices.update(holes, slicegrid, closing_radius, thr);
+    hole_slices.cut(obj_slices);
+}
+
+void DrainHoleSlices::update(const DrainHoles &         holes,
+                             const std::vector<float> & slicegrid,
+                             float                      closing_radius,
+                             std::function<void(void)>  thr)
+{
+    if (slicegrid != m_slicegrid || closing_radius != m_closing_radius) {
+        m_holes.clear();
+        m_slicegrid      = slicegrid;
+        m_closing_radius = closing_radius;
+    }
+
+    std::vector<HoleSlices> updated;
+    updated.reserve(holes.size());
+
+    for (const DrainHole &hole : holes) {
+        auto it = std::find_if(m_holes.begin(), m_holes.end(),
+                               [&hole](const HoleSlices &hs) {
+                                   return hs.hole == hole;
+                               });
+
+        if (it != m_holes.end()) {
+            // Reuse the cached slices. Each cache entry is matched only once,
+            // so that duplicate holes keep their own slices.
+            updated.emplace_back(std::move(*it));
+            m_holes.erase(it);
+            continue;
+        }
+
+        thr();
+
+        TriangleMesh mesh = sla::to_triangle_mesh(hole.to_mesh());
+        mesh.require_shared_vertices();
+        BoundingBoxf3 bb = mesh.bounding_box();
+
+        // Slice the hole only at the layers it spans.
+        auto from = std::lower_bound(m_slicegrid.begin(), m_slicegrid.end(),
+                                     float(bb.min.z()));
+        auto to   = std::upper_bound(from, m_slicegrid.end(),
+                                     float(bb.max.z()));
+
+        HoleSlices hs;
+        hs.hole        = hole;
+        hs.first_layer = size_t(from - m_slicegrid.begin());
+
+        if (from != to) {
+            TriangleMeshSlicer slicer(&mesh);
+            slicer.slice(std::vector<float>(from, to), SlicingMode::Regular,
+                         m_closing_radius, &hs.slices, thr);
+        }
+
+        updated.emplace_back(std::move(hs));
+    }
+
+    m_holes = std::move(updated);
+}
+
+void DrainHoleSlices::cut(std::vector<ExPolygons> &obj_slices) const
+{
+    if (obj_slices.size() != m_slicegrid.size())
         BOOST_LOG_TRIVIAL(warning)
             << "Sliced object and drain-holes layer count does not match!";
 
-    size_t until = std::min(obj_slices.size(), hole_slices.size());
-    
-    for (size_t i = 0; i < until; ++i)
-        obj_slices[i] = diff_ex(obj_slices[i], hole_slices[i]);
+    size_t until = std::min(obj_slices.size(), m_slicegrid.size());
+
+    for (size_t i = 0; i < until; ++i) {
+        ExPolygons holes;
+        for (const HoleSlices &hs : m_holes)
+            if (i >= hs.first_layer && i - hs.first_layer < hs.slices.size())
+                append(holes, hs.slices[i - hs.first_layer]);
+
+        // The holes may overlap, the clipping polygons are unioned by diff_ex.
+        if (! holes.empty())
+            obj_slices[i] = diff_ex(obj_slices[i], holes);
+    }
 }
 
 }} // namespace Slic3r::sla
@@ -59,16 +59,87 @@ struct DrainHole
 
 using DrainHoles = std::vector<DrainHole>;
 
+class InteriorGridCache;
+
 std::unique_ptr<TriangleMesh> generate_interior(const TriangleMesh &mesh,
                                                 const HollowingConfig &  = {},
                                                 const JobController &ctl = {});
 
+// Same as above, reusing the distance grid of the mesh kept in the cache.
+std::unique_ptr<TriangleMesh> generate_interior(const TriangleMesh &   mesh,
+                                                const HollowingConfig &hc,
+                                                const JobController &  ctl,
+                                                InteriorGridCache &    cache);
+
+// Distance grid of a mesh kept between the calls of generate_interior().
+// Converting the mesh into the grid is the most expensive part of hollowing
+// and it only depends on the mesh and the hollowing quality, thus the grid
+// is reused if the wall thickness or the closing distance changes. The cache
+// belongs to a single mesh, it has to be cleared if the mesh changes.
+class InteriorGridCache {
+public:
+    InteriorGridCache();
+    ~InteriorGridCache();
+    InteriorGridCache(InteriorGridCache &&);
+    InteriorGridCache &operator=(InteriorGridCache &&);
+
+    void clear();
+    bool empty() const { return ! m_grid; }
+
+    // Number of times the grid was built from the mesh.
+    size_t builds() const { return m_builds; }
+
+    // Defined in Hollowing.cpp, hiding the OpenVDB types.
+    struct Grid;
+
+private:
+    std::unique_ptr<Grid> m_grid;
+    size_t                m_builds = 0;
+
+    friend std::unique_ptr<TriangleMesh> generate_interior(const TriangleMesh &,
+                                                           const HollowingConfig &,
+                                                           const JobController &,
+                                                           InteriorGridCache &);
+};
+
+// Drill the drain holes into the mesh with CGAL mesh booleans. Throws
+// std::runtime_error if the holes overlap too much or the mesh is broken.
+void drill_drainholes(TriangleMesh &mesh, const DrainHoles &holes);
+
 void cut_drainholes(std::vector<ExPolygons> & obj_slices,
                     const std::vector<float> &slicegrid,
                     float                     closing_radius,
                     const sla::DrainHoles &   holes,
                     std::function<void(void)> thr);
 
+// Drain holes sliced on a slice grid, cached hole by hole. Updating the cache
+// slices only the holes not sliced yet, thus adding, moving or removing
+// a single hole does not re-slice the others.
+class DrainHoleSlices {
+public:
+    void update(const DrainHoles &              holes,
+                const std::vector<float> &      slicegrid,
+                float                           closing_radius,
+                std::function<void(void)>       thr);
+
+    // Cut the holes from the object slices sliced on the same slice grid.
+    void cut(std::vector<ExPolygons> &obj_slices) const;
+
+    void clear() { m_holes.clear(); m_slicegrid.clear(); }
+
+private:
+    struct HoleSlices {
+        DrainHole               hole;
+        // Index of the first slice grid layer the hole is sliced at.
+        size_t                  first_layer = 0;
+        std::vector<ExPolygons> slices;
+    };
+
+    std::vector<HoleSlices> m_holes;
+    std::vector<float>      m_slicegrid;
+    float                   m_closing_radius = 0.f;
+};
+
 }
 }
 
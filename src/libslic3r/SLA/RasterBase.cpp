@@ -2,6 +2,7 @@
 #define SLARASTER_CPP
 
 #include <functional>
+#include <memory>
 
 #include <libslic3r/SLA/RasterBase.hpp>
 #include <libslic3r/SLA/AGGRaster.hpp>
@@ -16,26 +17,94 @@ const RasterBase::TMirroring RasterBase::MirrorX  = {true, false};
 const RasterBase::TMirroring RasterBase::MirrorY  = {false, true};
 const RasterBase::TMirroring RasterBase::MirrorXY = {true, true};
 
+namespace {
+
+// Deflate state of the PNG encoder reused by all the layers encoded by
+// a thread. The compressor takes several hundred kilobytes and the output
+// buffer grows to the size of a compressed layer, so allocating them for
+// every layer is not negligible.
+struct PNGDeflateState {
+    std::unique_ptr<tdefl_compressor, void(*)(tdefl_compressor*)> compressor{
+        tdefl_compressor_alloc(), tdefl_compressor_free};
+    std::vector<uint8_t> buffer;
+};
+
+mz_bool png_buffer_putter(const void *buf, int len, void *user)
+{
+    auto &out = *static_cast<std::vector<uint8_t> *>(user);
+    auto  ptr = static_cast<const uint8_t *>(buf);
+    out.insert(out.end(), ptr, ptr + len);
+    return MZ_TRUE;
+}
+
+} // namespace
+
+// Produces the same image as tdefl_write_image_to_png_file_in_memory().
 EncodedRaster PNGRasterEncoder::operator()(const void *ptr, size_t w, size_t h,
                                            size_t      num_components)
 {
-    std::vector<uint8_t> buf;
-    size_t s = 0;
+    // Signature, IHDR chunk and the header of the IDAT chunk.
+    static const size_t  header_size = 41;
+    // Number of probes of the default compression level 6.
+    static const mz_uint num_probes  = 128;
+    static const uint8_t chans[]     = {0x00, 0x00, 0x04, 0x02, 0x06};
     
-    void *rawdata = tdefl_write_image_to_png_file_in_memory(
-        ptr, int(w), int(h), int(num_components), &s);
+    thread_local PNGDeflateState state;
     
     // On error, data() will return an empty vector. No other info can be
     // retrieved from miniz anyway...
-    if (rawdata == nullptr) return EncodedRaster({}, "png");
+    if (! state.compressor || num_components >= sizeof(chans))
+        return EncodedRaster({}, "png");
     
-    auto pptr = static_cast<std::uint8_t*>(rawdata);
+    std::vector<uint8_t> &out = state.buffer;
+    size_t bpl = w * num_components;
+    out.clear();
+    out.resize(header_size);
     
-    buf.reserve(s);
-    std::copy(pptr, pptr + s, std::back_inserter(buf));
+    if (tdefl_init(state.compressor.get(), png_buffer_putter, &out,
+                   num_probes | TDEFL_WRITE_ZLIB_HEADER) != TDEFL_STATUS_OKAY)
+        return EncodedRaster({}, "png");
+    
+    // Each row is prefixed by the "none" filter type.
+    const uint8_t filter = 0;
+    auto          rows   = static_cast<const uint8_t *>(ptr);
+    for (size_t y = 0; y < h; ++y) {
+        tdefl_compress_buffer(state.compressor.get(), &filter, 1, TDEFL_NO_FLUSH);
+        tdefl_compress_buffer(state.compressor.get(), rows + y * bpl, bpl, TDEFL_NO_FLUSH);
+    }
+    
+    if (tdefl_compress_buffer(state.compressor.get(), nullptr, 0, TDEFL_FINISH) != TDEFL_STATUS_DONE)
+        return EncodedRaster({}, "png");
+    
+    auto put_u32 = [](uint8_t *dst, mz_uint32 v) {
+        for (int i = 0; i < 4; ++i, v <<= 8) dst[i] = uint8_t(v >> 24);
+    };
+    
+    size_t idat_size = out.size() - header_size;
+    uint8_t header[header_size] = {
+        0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00,
+        0x00, 0x0d, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x49, 0x44, 0x41,
+        0x54};
+    header[18] = uint8_t(w >> 8);
+    header[19] = uint8_t(w);
+    header[22] = uint8_t(h >> 8);
+    header[23] = uint8_t(h);
+    header[25] = chans[num_components];
+    put_u32(header + 33, mz_uint32(idat_size));
+    put_u32(header + 29, mz_uint32(mz_crc32(MZ_CRC32_INIT, header + 12, 17)));
+    std::copy(header, header + header_size, out.begin());
+    
+    // IDAT CRC-32 followed by the IEND chunk.
+    static const uint8_t footer[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                     0x00, 0x00, 0x49, 0x45, 0x4e, 0x44,
+                                     0xae, 0x42, 0x60, 0x82};
+    out.insert(out.end(), footer, footer + sizeof(footer));
+    put_u32(out.data() + out.size() - sizeof(footer),
+            mz_uint32(mz_crc32(MZ_CRC32_INIT, out.data() + header_size - 4, idat_size + 4)));
     
-    MZ_FREE(rawdata);
-    return EncodedRaster(std::move(buf), "png");
+    return EncodedRaster(std::vector<uint8_t>(out.begin(), out.end()), "png");
 }
 
 std::ostream &operator<<(std::ostream &stream, const EncodedRaster &bytes)
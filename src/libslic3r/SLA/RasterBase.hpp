@@ -24,16 +24,18 @@ namespace sla {
 // Raw byte buffer paired with its size. Suitable for compressed image data.
 class EncodedRaster {
 protected:
-    std::vector<uint8_t> m_buffer;
+    // Copies share the buffer, thus identical layers may share a single one.
+    std::shared_ptr<const std::vector<uint8_t>> m_buffer;
     std::string m_ext;
 public:
     EncodedRaster() = default;
     explicit EncodedRaster(std::vector<uint8_t> &&buf, std::string ext)
-        : m_buffer(std::move(buf)), m_ext(std::move(ext))
+        : m_buffer(std::make_shared<const std::vector<uint8_t>>(std::move(buf)))
+        , m_ext(std::move(ext))
     {}
     
-    size_t size() const { return m_buffer.size(); }
-    const void * data() const { return m_buffer.data(); }
+    size_t size() const { return m_buffer ? m_buffer->size() : 0; }
+    const void * data() const { return m_buffer ? m_buffer->data() : nullptr; }
     const char * extension() const { return m_ext.c_str(); }
 };
 
@@ -94,6 +96,10 @@ public:
     virtual void draw(const ExPolygon& poly) = 0;
     virtual void draw(const ClipperLib::Polygon& poly) = 0;
     
+    /// Draw all the polygons of a layer in a single pass.
+    virtual void draw(const ExPolygons& polys) = 0;
+    virtual void draw(const std::vector<ClipperLib::Polygon>& polys) = 0;
+    
     /// Get the resolution of the raster.
     virtual Resolution resolution() const = 0;
     virtual PixelDim   pixel_dimensions() const = 0;
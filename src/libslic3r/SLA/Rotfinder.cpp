@@ -1,8 +1,12 @@
 #include <limits>
 #include <exception>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
 
-#include <libnest2d/optimizers/nlopt/genetic.hpp>
+#include <libnest2d/optimizers/nlopt/subplex.hpp>
 #include <libslic3r/SLA/Common.hpp>
+#include <libslic3r/SLA/Concurrency.hpp>
 #include <libslic3r/SLA/Rotfinder.hpp>
 #include <libslic3r/SLA/SupportTree.hpp>
 #include "Model.hpp"
@@ -10,105 +14,196 @@
 namespace Slic3r {
 namespace sla {
 
+namespace {
+
+// The facet normals of the mesh copied into contiguous arrays, so that the
+// score of a rotation is computed by a tight loop, which the compiler
+// vectorizes. The normals are read many times, once for every rotation.
+class FacetNormals {
+    std::vector<double> m_x, m_y, m_z;
+
+public:
+    explicit FacetNormals(const TriangleMesh &mesh)
+    {
+        size_t n = mesh.stl.facet_start.size();
+        m_x.reserve(n); m_y.reserve(n); m_z.reserve(n);
+        for (const stl_facet &facet : mesh.stl.facet_start) {
+            m_x.emplace_back(double(facet.normal.x()));
+            m_y.emplace_back(double(facet.normal.y()));
+            m_z.emplace_back(double(facet.normal.z()));
+        }
+    }
+
+    // For all triangles we calculate the normal and sum up the dot product
+    // (a scalar indicating how much are two vectors aligned) with each axis
+    // this will result in a value that is greater if a normal is aligned
+    // with all axes. If the normal is aligned than the triangle itself is
+    // orthogonal to the axes and that is good for print quality.
+
+    // TODO: some applications optimize for minimum z-axis cross section
+    // area. The current function is only an example of how to optimize.
+
+    // Later we can add more criteria like the number of overhangs, etc...
+    double score(double rx, double ry, double rz) const
+    {
+        // prepare the rotation transformation
+        Transform3d rt = Transform3d::Identity();
+
+        rt.rotate(Eigen::AngleAxisd(rz, Vec3d::UnitZ()));
+        rt.rotate(Eigen::AngleAxisd(ry, Vec3d::UnitY()));
+        rt.rotate(Eigen::AngleAxisd(rx, Vec3d::UnitX()));
+
+        const Eigen::Matrix3d r = rt.linear();
+
+        // Independent partial sums, so that the summation does not need
+        // to be reordered to vectorize the loop.
+        static constexpr size_t Lanes = 4;
+        double sums[Lanes] = {0.};
+
+        const size_t n = m_x.size(), nfull = n - n % Lanes;
+        const double *x = m_x.data(), *y = m_y.data(), *z = m_z.data();
+        for (size_t i = 0; i < nfull; i += Lanes)
+            for (size_t l = 0; l < Lanes; ++l) {
+                double nx = x[i + l], ny = y[i + l], nz = z[i + l];
+                sums[l] += std::abs(r(0, 0) * nx + r(0, 1) * ny + r(0, 2) * nz)
+                         + std::abs(r(1, 0) * nx + r(1, 1) * ny + r(1, 2) * nz)
+                         + std::abs(r(2, 0) * nx + r(2, 1) * ny + r(2, 2) * nz);
+            }
+
+        double score = 0.;
+        for (size_t i = nfull; i < n; ++i)
+            score += std::abs(r(0, 0) * x[i] + r(0, 1) * y[i] + r(0, 2) * z[i])
+                   + std::abs(r(1, 0) * x[i] + r(1, 1) * y[i] + r(1, 2) * z[i])
+                   + std::abs(r(2, 0) * x[i] + r(2, 1) * y[i] + r(2, 2) * z[i]);
+
+        for (double s : sums) score += s;
+
+        return score;
+    }
+};
+
+struct Candidate {
+    std::array<double, 3> rot;
+    double score = 0.;
+};
+
+} // namespace
+
 std::array<double, 3> find_best_rotation(const ModelObject& modelobj,
                                          float accuracy,
                                          std::function<void(unsigned)> statuscb,
                                          std::function<bool()> stopcond)
 {
-    using libnest2d::opt::Method;
     using libnest2d::opt::bound;
-    using libnest2d::opt::Optimizer;
-    using libnest2d::opt::TOptimizer;
     using libnest2d::opt::StopCriteria;
+    using libnest2d::opt::SubplexOptimizer;
 
     static const unsigned MAX_TRIES = 100000;
 
-    // return value
-    std::array<double, 3> rot;
+    // Number of the best candidates of the global search to be refined
+    static const size_t NUM_REFINED = 4;
 
     // We will use only one instance of this converted mesh to examine different
     // rotations
-    const TriangleMesh& mesh = modelobj.raw_mesh();
+    const FacetNormals normals(modelobj.raw_mesh());
 
     // For current iteration number
     unsigned status = 0;
+    std::mutex status_mutex;
 
     // The maximum number of iterations
-    auto max_tries = unsigned(accuracy * MAX_TRIES);
+    auto max_tries = std::max(unsigned(accuracy * MAX_TRIES), 1u);
 
     // call status callback with zero, because we are at the start
     statuscb(status);
 
-    // So this is the object function which is called by the solver many times
-    // It has to yield a single value representing the current score. We will
-    // call the status callback in each iteration but the actual value may be
-    // the same for subsequent iterations (status goes from 0 to 100 but
-    // iterations can be many more)
-    auto objfunc = [&mesh, &status, &statuscb, &stopcond, max_tries]
-            (double rx, double ry, double rz)
+    // So this is the object function which is called many times, from
+    // multiple threads. It has to yield a single value representing the
+    // current score. We will call the status callback in each iteration but
+    // the actual value may be the same for subsequent iterations (status goes
+    // from 0 to 100 but iterations can be many more)
+    auto objfunc = [&normals, &status, &status_mutex, &statuscb, &stopcond,
+                    max_tries](double rx, double ry, double rz)
     {
-        const TriangleMesh& m = mesh;
-
-        // prepare the rotation transformation
-        Transform3d rt = Transform3d::Identity();
-
-        rt.rotate(Eigen::AngleAxisd(rz, Vec3d::UnitZ()));
-        rt.rotate(Eigen::AngleAxisd(ry, Vec3d::UnitY()));
-        rt.rotate(Eigen::AngleAxisd(rx, Vec3d::UnitX()));
+        if (stopcond()) return 0.;
 
-        double score = 0;
-
-        // For all triangles we calculate the normal and sum up the dot product
-        // (a scalar indicating how much are two vectors aligned) with each axis
-        // this will result in a value that is greater if a normal is aligned
-        // with all axes. If the normal is aligned than the triangle itself is
-        // orthogonal to the axes and that is good for print quality.
-
-        // TODO: some applications optimize for minimum z-axis cross section
-        // area. The current function is only an example of how to optimize.
-
-        // Later we can add more criteria like the number of overhangs, etc...
-        for(size_t i = 0; i < m.stl.facet_start.size(); i++) {
-            Vec3d n = m.stl.facet_start[i].normal.cast<double>();
-
-            // rotate the normal with the current rotation given by the solver
-            n = rt * n;
-
-            // We should score against the alignment with the reference planes
-            score += std::abs(n.dot(Vec3d::UnitX()));
-            score += std::abs(n.dot(Vec3d::UnitY()));
-            score += std::abs(n.dot(Vec3d::UnitZ()));
-        }
+        double score = normals.score(rx, ry, rz);
 
         // report status
+        std::lock_guard<std::mutex> lk(status_mutex);
         if(!stopcond()) statuscb( unsigned(++status * 100.0/max_tries) );
 
         return score;
     };
 
-    // Firing up the genetic optimizer. For now it uses the nlopt library.
-    StopCriteria stc;
-    stc.max_iterations = max_tries;
-    stc.relative_score_difference = 1e-3;
-    stc.stop_condition = stopcond;      // stop when stopcond returns true
-    TOptimizer<Method::G_GENETIC> solver(stc);
-
     // We are searching rotations around the three axes x, y, z. Thus the
-    // problem becomes a 3 dimensional optimization task.
-    // We can specify the bounds for a dimension in the following way:
-    auto b = bound(-PI/2, PI/2);
-
-    // Now we start the optimization process with initial angles (0, 0, 0)
-    auto result = solver.optimize_max(objfunc,
-                                      libnest2d::opt::initvals(0.0, 0.0, 0.0),
-                                      b, b, b);
-
-    // Save the result and fck off
-    rot[0] = std::get<0>(result.optimum);
-    rot[1] = std::get<1>(result.optimum);
-    rot[2] = std::get<2>(result.optimum);
-
-    return rot;
+    // problem becomes a 3 dimensional optimization task. The first half of
+    // the iterations is spent on scoring a regular grid of rotations over
+    // the bounds, the rest on refining the best few of them.
+    const double lo = -PI / 2, hi = PI / 2;
+    const size_t grid_n = std::max(size_t(std::cbrt(max_tries / 2.)), size_t(2));
+
+    // The cell centers of the grid miss the identity, which is often the
+    // orientation the object was modeled in. It is scored as well.
+    std::vector<Candidate> candidates(grid_n * grid_n * grid_n + 1);
+    const double step = (hi - lo) / double(grid_n);
+    for (size_t i = 0; i + 1 < candidates.size(); ++i) {
+        candidates[i].rot = {lo + (double(i % grid_n) + .5) * step,
+                             lo + (double(i / grid_n % grid_n) + .5) * step,
+                             lo + (double(i / grid_n / grid_n) + .5) * step};
+    }
+    candidates.back().rot = {0., 0., 0.};
+
+    ccr::enumerate(candidates.begin(), candidates.end(),
+                   [&objfunc](Candidate &c, size_t) {
+                       c.score = objfunc(c.rot[0], c.rot[1], c.rot[2]);
+                   });
+
+    // The best ones first, the ties are broken by the angles, so that the
+    // result does not depend on the scheduling of the threads.
+    size_t num_refined = std::min(NUM_REFINED, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + num_refined,
+                      candidates.end(),
+                      [](const Candidate &a, const Candidate &b) {
+                          return a.score > b.score ||
+                                 (a.score == b.score && a.rot < b.rot);
+                      });
+    candidates.resize(num_refined);
+
+    unsigned global_tries = unsigned(grid_n * grid_n * grid_n + 1);
+    unsigned local_tries  = max_tries > global_tries ?
+                                (max_tries - global_tries) / unsigned(num_refined) : 0;
+
+    if (local_tries > 0 && !stopcond()) {
+        ccr::enumerate(candidates.begin(), candidates.end(),
+                       [&objfunc, &stopcond, local_tries, lo, hi](Candidate &c, size_t) {
+            StopCriteria stc;
+            stc.max_iterations = local_tries;
+            stc.relative_score_difference = 1e-3;
+            stc.stop_condition = stopcond;      // stop when stopcond returns true
+            SubplexOptimizer solver(stc);
+
+            auto b = bound(lo, hi);
+            auto result = solver.optimize_max(objfunc,
+                                              libnest2d::opt::initvals(c.rot[0], c.rot[1], c.rot[2]),
+                                              b, b, b);
+
+            // A forced stop leaves the score undefined, the refinement
+            // result is only taken if it is an improvement.
+            Candidate refined;
+            refined.rot   = {std::get<0>(result.optimum),
+                             std::get<1>(result.optimum),
+                             std::get<2>(result.optimum)};
+            refined.score = objfunc(refined.rot[0], refined.rot[1], refined.rot[2]);
+            if (refined.score > c.score) c = refined;
+        });
+    }
+
+    const Candidate &best = *std::max_element(
+        candidates.begin(), candidates.end(),
+        [](const Candidate &a, const Candidate &b) { return a.score < b.score; });
+
+    return best.rot;
 }
 
 }
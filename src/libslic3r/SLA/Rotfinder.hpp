@@ -15,8 +15,10 @@ namespace sla {
   *
   * @param modelobj The model object representing the 3d mesh.
   * @param accuracy The optimization accuracy from 0.0f to 1.0f. Currently,
-  * the nlopt genetic optimizer is used and the number of iterations is
-  * accuracy * 100000. This can change in the future.
+  * the number of evaluated rotations is at most accuracy * 100000. Half of
+  * them is a regular grid over all the rotations, the rest is spent on local
+  * refinement of the best ones with the nlopt subplex optimizer. The
+  * rotations are evaluated in parallel. This can change in the future.
   * @param statuscb A status indicator callback called with the unsigned
   * argument spanning from 0 to 100. May not reach 100 if the optimization finds
   * an optimum before max iterations are reached.
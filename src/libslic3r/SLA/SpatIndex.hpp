@@ -46,6 +46,14 @@ public:
         return nearest(v, k);
     }
 
+    // The k nearest points for which the filter returns true.
+    std::vector<PointIndexEl> nearest(const Vec3d&, unsigned k,
+                                      std::function<bool(const PointIndexEl&)> filter) const;
+
+    // All points closer to the center than radius. Only the points inside the
+    // bounding box of the sphere are visited.
+    std::vector<PointIndexEl> within(const Vec3d &center, double radius) const;
+
     // For testing
     size_t size() const;
     bool empty() const { return size() == 0; }
@@ -78,7 +78,13 @@ SupportPointGenerator::SupportPointGenerator(
 void SupportPointGenerator::execute(const std::vector<ExPolygons> &slices,
                                     const std::vector<float> &     heights)
 {
-    process(slices, heights);
+    Layers layers = make_layers(slices, heights, m_throw_on_cancel);
+    execute(layers);
+}
+
+void SupportPointGenerator::execute(Layers &layers)
+{
+    process(layers.layers);
     project_onto_mesh(m_output);
 }
 
@@ -110,14 +116,15 @@ void SupportPointGenerator::project_onto_mesh(std::vector<sla::SupportPoint>& po
         });
 }
 
-static std::vector<SupportPointGenerator::MyLayer> make_layers(
+SupportPointGenerator::Layers SupportPointGenerator::make_layers(
     const std::vector<ExPolygons>& slices, const std::vector<float>& heights,
     std::function<void(void)> throw_on_cancel)
 {
     assert(slices.size() == heights.size());
 
-    // Allocate empty layers.
-    std::vector<SupportPointGenerator::MyLayer> layers;
+    // Allocate empty layers. The vector must not reallocate, the islands point to the layers.
+    Layers out;
+    std::vector<SupportPointGenerator::MyLayer> &layers = out.layers;
     layers.reserve(slices.size());
     for (size_t i = 0; i < slices.size(); ++ i)
         layers.emplace_back(i, heights[i]);
@@ -199,16 +206,21 @@ static std::vector<SupportPointGenerator::MyLayer> make_layers(
         }
     });
 
-    return layers;
+    return out;
 }
 
-void SupportPointGenerator::process(const std::vector<ExPolygons>& slices, const std::vector<float>& heights)
+void SupportPointGenerator::process(std::vector<MyLayer>& layers)
 {
 #ifdef SLA_SUPPORTPOINTGEN_DEBUG
     std::vector<std::pair<ExPolygon, coord_t>> islands;
 #endif /* SLA_SUPPORTPOINTGEN_DEBUG */
 
-    std::vector<SupportPointGenerator::MyLayer> layers = make_layers(slices, heights, m_throw_on_cancel);
+    // The layers may have been processed before with a different config.
+    for (MyLayer &layer : layers)
+        for (Structure &s : layer.islands) {
+            s.supports_force_this_layer = 0.f;
+            s.supports_force_inherited  = 0.f;
+        }
 
     PointGrid3D point_grid;
     point_grid.cell_size = Vec3f(10.f, 10.f, 10.f);
@@ -131,6 +131,28 @@ public:
         std::vector<Structure>  islands;
     };
     
+    // Islands of all the layers linked with the overlapping islands of the
+    // neighbor layers. They depend on the slices only, not on the Config, thus
+    // they may be kept and reused to place the points with a different density
+    // or minimal distance, as long as the slices stay alive and unchanged.
+    // Move only, the islands point to each other.
+    struct Layers {
+        std::vector<MyLayer> layers;
+
+        Layers() = default;
+        Layers(const Layers &) = delete;
+        Layers(Layers &&) = default;
+        Layers &operator=(const Layers &) = delete;
+        Layers &operator=(Layers &&) = default;
+
+        bool empty() const { return layers.empty(); }
+        void clear() { layers.clear(); }
+    };
+
+    static Layers make_layers(const std::vector<ExPolygons> &slices,
+                              const std::vector<float> &     heights,
+                              std::function<void(void)>      throw_on_cancel);
+
     struct RichSupportPoint {
         Vec3f        position;
         Structure   *island;
@@ -191,6 +213,10 @@ public:
     
     void execute(const std::vector<ExPolygons> &slices,
                  const std::vector<float> &     heights);
+
+    // Place the points on the layers built by make_layers(). The support
+    // forces stored in the islands are reset, the links are kept.
+    void execute(Layers &layers);
     
     void seed(std::mt19937::result_type s) { m_rng.seed(s); }
 private:
@@ -198,7 +224,7 @@ private:
     
     SupportPointGenerator::Config m_config;
     
-    void process(const std::vector<ExPolygons>& slices, const std::vector<float>& heights);
+    void process(std::vector<MyLayer>& layers);
     void uniformly_cover(const ExPolygons& islands, Structure& structure, PointGrid3D &grid3d, bool is_new_island = false, bool just_one = false);
     void project_onto_mesh(std::vector<SupportPoint>& points) const;
 
@@ -522,20 +522,25 @@ bool SupportTreeBuildsteps::connect_to_nearpillar(const Head &head,
 
 bool SupportTreeBuildsteps::search_pillar_and_connect(const Head &head)
 {
-    PointIndex spindex = m_pillar_index.guarded_clone();
+    // Pillars already tried without success
+    std::vector<unsigned> rejected;
+    auto not_rejected = [&rejected](const PointIndexEl &e) {
+        return std::find(rejected.begin(), rejected.end(), e.second) ==
+               rejected.end();
+    };
     
     long nearest_id = ID_UNSET;
     
     Vec3d querypoint = head.junction_point();
     
-    while(nearest_id < 0 && !spindex.empty()) { m_thr();
+    while(nearest_id < 0) { m_thr();
         // loop until a suitable head is not found
         // if there is a pillar closer than the cluster center
         // (this may happen as the clustering is not perfect)
         // than we will bridge to this closer pillar
         
         Vec3d qp(querypoint(X), querypoint(Y), m_builder.ground_level);
-        auto qres = spindex.nearest(qp, 1);
+        auto qres = m_pillar_index.guarded_nearest(qp, 1, not_rejected);
         if(qres.empty()) break;
         
         auto ne = qres.front();
@@ -544,8 +549,8 @@ bool SupportTreeBuildsteps::search_pillar_and_connect(const Head &head)
         if(nearest_id >= 0) {
             if(size_t(nearest_id) < m_builder.pillarcount()) {
                 if(!connect_to_nearpillar(head, nearest_id)) {
-                    nearest_id = ID_UNSET;    // continue searching
-                    spindex.remove(ne);       // without the current pillar
+                    nearest_id = ID_UNSET;        // continue searching
+                    rejected.emplace_back(ne.second); // without the current pillar
                 }
             }
         }
@@ -1108,14 +1113,15 @@ void SupportTreeBuildsteps::interconnect_pillars()
         if(pillar.links >= neighbors) return;
         
         // Query all remaining points within reach
-        auto qres = m_pillar_index.query([qp, d](const PointIndexEl& e){
-            return distance(e.first, qp) < d;
-        });
+        auto qres = m_pillar_index.within(qp, d);
         
-        // sort the result by distance (have to check if this is needed)
+        // sort the result by distance, pillars in the same distance by their
+        // id, so that the order does not depend on the layout of the index
         std::sort(qres.begin(), qres.end(),
                   [qp](const PointIndexEl& e1, const PointIndexEl& e2){
-                      return distance(e1.first, qp) < distance(e2.first, qp);
+                      double d1 = distance(e1.first, qp);
+                      double d2 = distance(e2.first, qp);
+                      return d1 < d2 || (d1 == d2 && e1.second < e2.second);
                   });
         
         for(auto& re : qres) { // process the queried neighbors
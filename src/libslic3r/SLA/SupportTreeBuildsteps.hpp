@@ -138,10 +138,20 @@ public:
         m_index.foreach(fn);
     }
 
-    PointIndex guarded_clone()
+    // Nearest pillar endpoints accepted by the filter. Unlike querying a
+    // clone of the index, this does not copy the whole index for every head.
+    template<class Fn>
+    inline std::vector<PointIndexEl> guarded_nearest(const Vec3d &p,
+                                                     unsigned    k,
+                                                     Fn          filter) const
     {
         std::lock_guard<Mutex> lck(m_mutex);
-        return m_index;
+        return m_index.nearest(p, k, filter);
+    }
+
+    inline std::vector<PointIndexEl> within(const Vec3d &p, double r) const
+    {
+        return m_index.within(p, r);
     }
 };
 
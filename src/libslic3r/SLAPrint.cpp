@@ -419,7 +419,8 @@ SLAPrint::ApplyStatus SLAPrint::apply(const Model &model, DynamicPrintConfig con
                 }
                 model_object.sla_points_status = model_object_new.sla_points_status;
                 
-                // Invalidate hollowing if drain holes have changed
+                // Invalidate drilling if drain holes have changed. The model
+                // is not sliced again, the holes are cut from its kept slices.
                 if (model_object.sla_drain_holes != model_object_new.sla_drain_holes)
                 {
                     model_object.sla_drain_holes = model_object_new.sla_drain_holes;
@@ -658,6 +659,40 @@ std::string SLAPrint::validate() const
     return "";
 }
 
+size_t SLAPrint::PrintLayer::hash(const std::vector<ClipperLib::Polygon> &slices)
+{
+    size_t seed = slices.size();
+    auto combine = [&seed](size_t v) {
+        seed ^= v + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    };
+    auto combine_path = [&combine](const ClipperLib::Path &path) {
+        combine(path.size());
+        for (const ClipperLib::IntPoint &p : path) {
+            combine(size_t(p.X));
+            combine(size_t(p.Y));
+        }
+    };
+    
+    for (const ClipperLib::Polygon &poly : slices) {
+        combine_path(poly.Contour);
+        combine(poly.Holes.size());
+        for (const ClipperLib::Path &hole : poly.Holes) combine_path(hole);
+    }
+    
+    return seed;
+}
+
+bool SLAPrint::PrintLayer::same_slices(const std::vector<ClipperLib::Polygon> &a, size_t hash_a,
+                                       const std::vector<ClipperLib::Polygon> &b, size_t hash_b)
+{
+    // Compare the polygons only if the hashes match to rule out collisions.
+    return hash_a == hash_b && a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(),
+                      [](const ClipperLib::Polygon &pa, const ClipperLib::Polygon &pb) {
+                          return pa.Contour == pb.Contour && pa.Holes == pb.Holes;
+                      });
+}
+
 void SLAPrint::set_printer(SLAPrinter *arch)
 {
     invalidate_step(slapsRasterize);
@@ -702,45 +737,68 @@ void SLAPrint::process()
     BOOST_LOG_TRIVIAL(info) << "Start slicing process.";
 
 #ifdef SLAPRINT_DO_BENCHMARK
-    Benchmark bench;
+    using Bench = Benchmark;
 #else
-    struct {
+    struct Bench {
         void start() {} void stop() {} double getElapsedSec() { return .0; }
-    } bench;
+    };
 #endif
+    Bench bench;
 
     std::array<double, slaposCount + slapsCount> step_times {};
-
-    auto apply_steps_on_objects =
-        [this, &st, &printsteps, &step_times, &bench]
-        (const std::vector<SLAPrintObjectStep> &steps)
+    
+    // Guards the progress and the step times shared by the objects, which
+    // are processed concurrently.
+    std::mutex st_mutex;
+    
+    auto apply_steps_on_object =
+        [this, &st, &st_mutex, &printsteps, &step_times]
+        (SLAPrintObject &po, const std::vector<SLAPrintObjectStep> &steps)
     {
-        double incr = 0;
-        for (SLAPrintObject *po : m_objects) {
-            for (SLAPrintObjectStep step : steps) {
-
-                // Cancellation checking. Each step will check for
-                // cancellation on its own and return earlier gracefully.
-                // Just after it returns execution gets to this point and
-                // throws the canceled signal.
-                throw_if_canceled();
+        for (SLAPrintObjectStep step : steps) {
 
-                st += incr;
+            // Cancellation checking. Each step will check for
+            // cancellation on its own and return earlier gracefully.
+            // Just after it returns execution gets to this point and
+            // throws the canceled signal.
+            throw_if_canceled();
 
-                if (po->m_stepmask[step] && po->set_started(step)) {
-                    m_report_status(*this, st, printsteps.label(step));
-                    bench.start();
-                    printsteps.execute(step, *po);
-                    bench.stop();
+            if (po.m_stepmask[step] && po.set_started(step)) {
+                double st_started;
+                {
+                    std::lock_guard<std::mutex> lk(st_mutex);
+                    st_started = st;
+                }
+                m_report_status(*this, st_started, printsteps.label(step));
+                // Each object measures its own steps.
+                Bench bench;
+                bench.start();
+                printsteps.execute(step, po);
+                bench.stop();
+                {
+                    std::lock_guard<std::mutex> lk(st_mutex);
                     step_times[step] += bench.getElapsedSec();
-                    throw_if_canceled();
-                    po->set_done(step);
                 }
-                
-                incr = printsteps.progressrange(step);
+                throw_if_canceled();
+                po.set_done(step);
             }
+            
+            std::lock_guard<std::mutex> lk(st_mutex);
+            st += printsteps.progressrange(step);
         }
     };
+    
+    // The objects are independent of each other, thus their steps run
+    // concurrently, one task per object. The steps of a single object run
+    // in order and parallelize internally.
+    auto apply_steps_on_objects =
+        [this, &apply_steps_on_object](const std::vector<SLAPrintObjectStep> &steps)
+    {
+        sla::ccr::enumerate(m_objects.begin(), m_objects.end(),
+                            [&apply_steps_on_object, &steps](SLAPrintObject *po, size_t) {
+                                apply_steps_on_object(*po, steps);
+                            });
+    };
 
     apply_steps_on_objects(level1_obj_steps);
     apply_steps_on_objects(level2_obj_steps);
@@ -967,9 +1025,13 @@ bool SLAPrintObject::invalidate_step(SLAPrintObjectStep step)
     if (step == slaposHollowing) {
         invalidated |= this->invalidate_all_steps();
     } else if (step == slaposDrillHoles) {
-        invalidated |= this->invalidate_steps({ slaposObjectSlice, slaposSupportPoints, slaposSupportTree, slaposPad, slaposSliceSupports });
+        // The undrilled model slices do not depend on the drain holes, only
+        // the holes will be cut from them again.
+        invalidated |= Inherited::invalidate_step(slaposObjectSlice);
+        invalidated |= this->invalidate_steps({ slaposSupportPoints, slaposSupportTree, slaposPad, slaposSliceSupports });
         invalidated |= m_print->invalidate_step(slapsMergeSlicesAndEval);
     } else if (step == slaposObjectSlice) {
+        m_model_slices_undrilled.clear();
         invalidated |= this->invalidate_steps({ slaposSupportPoints, slaposSupportTree, slaposPad, slaposSliceSupports });
         invalidated |= m_print->invalidate_step(slapsMergeSlicesAndEval);
     } else if (step == slaposSupportPoints) {
@@ -989,7 +1051,9 @@ bool SLAPrintObject::invalidate_step(SLAPrintObjectStep step)
 
 bool SLAPrintObject::invalidate_all_steps()
 {
-    return Inherited::invalidate_all_steps() | m_print->invalidate_all_steps();
+    bool invalidated = Inherited::invalidate_all_steps() | m_print->invalidate_all_steps();
+    m_model_slices_undrilled.clear();
+    return invalidated;
 }
 
 double SLAPrintObject::get_elevation() const {
@@ -1083,7 +1147,7 @@ bool SLAPrintObject::has_mesh(SLAPrintObjectStep step) const
 {
     switch (step) {
     case slaposDrillHoles:
-        return m_hollowing_data && !m_hollowing_data->hollow_mesh_with_holes.empty();
+        return m_hollowing_data && !m_hollowing_data->hollow_mesh.empty();
     case slaposSupportTree:
         return ! this->support_mesh().empty();
     case slaposPad:
@@ -1102,7 +1166,7 @@ TriangleMesh SLAPrintObject::get_mesh(SLAPrintObjectStep step) const
         return this->pad_mesh();
     case slaposDrillHoles:
         if (m_hollowing_data)
-            return m_hollowing_data->hollow_mesh_with_holes;
+            return this->get_mesh_to_print();
         [[fallthrough]];
     default:
         return TriangleMesh();
@@ -1129,6 +1193,34 @@ const TriangleMesh& SLAPrintObject::pad_mesh() const
     return EMPTY_MESH;
 }
 
+const TriangleMesh &SLAPrintObject::get_mesh_to_print() const
+{
+    if (! m_hollowing_data || ! is_step_done(slaposDrillHoles))
+        return transformed_mesh();
+
+    const HollowingData &hd = *m_hollowing_data;
+    if (hd.drainholes.empty())
+        return hd.hollow_mesh;
+
+    // The mesh booleans are slow, they are only run when the drilled mesh
+    // is requested, not by the slaposDrillHoles step on each hole edit.
+    std::lock_guard<std::mutex> lock(hd.drilling_mutex);
+    if (! hd.holes_drilled) {
+        hd.hollow_mesh_with_holes = hd.hollow_mesh;
+        try {
+            sla::drill_drainholes(hd.hollow_mesh_with_holes, hd.drainholes);
+        } catch (const std::exception &ex) {
+            // The slices and the supports do not depend on the drilled mesh,
+            // the undrilled mesh is shown instead.
+            BOOST_LOG_TRIVIAL(warning) << "Drilling of the displayed mesh failed: " << ex.what();
+            hd.hollow_mesh_with_holes = hd.hollow_mesh;
+        }
+        hd.holes_drilled = true;
+    }
+
+    return hd.hollow_mesh_with_holes;
+}
+
 const TriangleMesh &SLAPrintObject::hollowed_interior_mesh() const
 {
     if (m_hollowing_data && m_config.hollowing_enable.getBool())
@@ -1228,6 +1320,7 @@ void SLAPrint::StatusReporter::operator()(SLAPrint &         p,
                                           unsigned           flags,
                                           const std::string &logmsg)
 {
+    std::lock_guard<std::mutex> lk(m_mutex);
     m_st = st;
     BOOST_LOG_TRIVIAL(info)
         << st << "% " << msg << (logmsg.empty() ? "" : ": ") << logmsg
@@ -2,9 +2,12 @@
 #define slic3r_SLAPrint_hpp_
 
 #include <mutex>
+#include <optional>
 #include "PrintBase.hpp"
 #include "SLA/RasterBase.hpp"
 #include "SLA/SupportTree.hpp"
+#include "SLA/Hollowing.hpp"
+#include "SLA/SupportPointGenerator.hpp"
 #include "Point.hpp"
 #include "MTUtils.hpp"
 #include "Zipper.hpp"
@@ -82,9 +85,16 @@ public:
     const TriangleMesh&     hollowed_interior_mesh() const;
     
     // Get the mesh that is going to be printed with all the modifications
-    // like hollowing and drilled holes.
-    const TriangleMesh & get_mesh_to_print() const {
-        return (m_hollowing_data && is_step_done(slaposDrillHoles)) ? m_hollowing_data->hollow_mesh_with_holes : transformed_mesh();
+    // like hollowing and drilled holes. The holes are drilled into the mesh
+    // on the first call after the slaposDrillHoles step, the mesh is only
+    // used for display and export.
+    const TriangleMesh & get_mesh_to_print() const;
+
+    // Get the hollowed mesh without the drain holes. The mesh is sliced and
+    // supported, the holes are cut from the slices and the supports see them
+    // through the hole aware raycaster.
+    const TriangleMesh & get_mesh_to_slice() const {
+        return (m_hollowing_data && is_step_done(slaposDrillHoles)) ? m_hollowing_data->hollow_mesh : transformed_mesh();
     }
 
     // This will return the transformed mesh which is cached
@@ -267,6 +277,8 @@ protected:
 
     void                    set_trafo(const Transform3d& trafo, bool left_handed) {
         m_transformed_rmesh.invalidate([this, &trafo, left_handed](){ m_trafo = trafo; m_left_handed = left_handed; });
+        m_interior_grid.clear();
+        m_model_slices_undrilled.clear();
     }
 
     template<class InstVec> inline void set_instances(InstVec&& instances) { m_instances = std::forward<InstVec>(instances); }
@@ -295,6 +307,10 @@ private:
     // Individual 2d slice polygons from lower z to higher z levels
     std::vector<ExPolygons>                 m_model_slices;
 
+    // The model slices before the drain holes are cut from them. Kept when
+    // only the drain holes change, see invalidate_step().
+    std::vector<ExPolygons>                 m_model_slices_undrilled;
+
     // Exact (float) height levels mapped to the slices. Each record contains
     // the index to the model and the support slice vectors.
     std::vector<SliceRecord>                m_slice_index;
@@ -328,10 +344,27 @@ private:
     public:
         
         TriangleMesh interior;
-        mutable TriangleMesh hollow_mesh_with_holes; // caching the complete hollowed mesh
+        TriangleMesh hollow_mesh;      // the mesh merged with the interior, without the drain holes
+        sla::DrainHoles drainholes;    // transformed drain holes to be drilled into hollow_mesh_with_holes
+
+        // Caching the complete hollowed mesh, drilled by get_mesh_to_print().
+        mutable TriangleMesh hollow_mesh_with_holes;
+        mutable bool         holes_drilled = false;
+        mutable std::mutex   drilling_mutex;
     };
     
     std::unique_ptr<HollowingData> m_hollowing_data;
+
+    // Distance grid of the transformed mesh, reused by the hollowing when
+    // only the hollowing parameters change.
+    sla::InteriorGridCache m_interior_grid;
+
+    // Slices of the drain holes, kept between the slicing runs.
+    sla::DrainHoleSlices m_drainhole_slices;
+
+    // Islands of the model slices used by the support point generator, kept
+    // until the model is sliced again.
+    sla::SupportPointGenerator::Layers m_support_point_layers;
 };
 
 using PrintObjects = std::vector<SLAPrintObject*>;
@@ -372,6 +405,9 @@ struct SLAPrintStatistics
 class SLAPrinter {
 protected:
     std::vector<sla::EncodedRaster> m_layers;
+    // Maximum number of encoded layers held in memory while streaming them
+    // into the output, zero if all the layers are kept in m_layers.
+    size_t m_streaming_window = 0;
     
     virtual uqptr<sla::RasterBase> create_raster() const = 0;
     virtual sla::EncodedRaster encode_raster(const sla::RasterBase &rst) const = 0;
@@ -382,16 +418,76 @@ public:
     virtual void apply(const SLAPrinterConfig &cfg) = 0;
     
     // Fn have to be thread safe: void(sla::RasterBase& raster, size_t lyrid);
-    template<class Fn> void draw_layers(size_t layer_num, Fn &&drawfn)
+    // SameFn: bool(size_t lyrid), whether the layer is identical to the
+    // previous one. A run of identical layers is drawn and encoded just once
+    // and all the layers of the run share the encoded buffer.
+    template<class Fn, class SameFn>
+    void draw_layers(size_t layer_num, Fn &&drawfn, SameFn &&samefn)
     {
+        // The first layer of the run of identical layers for each layer.
+        std::vector<size_t> first(layer_num);
+        for (size_t idx = 0; idx < layer_num; ++idx)
+            first[idx] = (idx > 0 && samefn(idx)) ? first[idx - 1] : idx;
+        
         m_layers.resize(layer_num);
         sla::ccr::enumerate(m_layers.begin(), m_layers.end(),
-                            [this, &drawfn](sla::EncodedRaster& enc, size_t idx) {
+                            [this, &drawfn, &first](sla::EncodedRaster& enc, size_t idx) {
+                                if (first[idx] != idx) return;
                                 auto rst = create_raster();
                                 drawfn(*rst, idx);
                                 enc = encode_raster(*rst);
                             });
+        
+        for (size_t idx = 0; idx < layer_num; ++idx)
+            if (first[idx] != idx) m_layers[idx] = m_layers[first[idx]];
+    }
+    
+    template<class Fn> void draw_layers(size_t layer_num, Fn &&drawfn)
+    {
+        draw_layers(layer_num, std::forward<Fn>(drawfn), [](size_t) { return false; });
+    }
+    
+    // Rasterize and encode the layers in parallel, passing them to consumefn
+    // one at a time in the order of the layers as soon as they are ready.
+    // At most max_layers_in_memory encoded layers are held in memory at once.
+    // Layers identical to the previous one are passed the previous encoded
+    // raster, sharing its buffer.
+    // DrawFn and SameFn have to be thread safe, see above.
+    // ConsumeFn: void(sla::EncodedRaster &&encoded, size_t lyrid);
+    template<class DrawFn, class SameFn, class ConsumeFn>
+    void draw_layers(size_t layer_num, DrawFn &&drawfn, SameFn &&samefn,
+                     ConsumeFn &&consumefn, size_t max_layers_in_memory)
+    {
+        sla::EncodedRaster previous;
+        sla::ccr::ordered_pipeline(layer_num, max_layers_in_memory,
+                                   [this, &drawfn, &samefn](size_t idx) {
+                                       std::optional<sla::EncodedRaster> enc;
+                                       if (idx == 0 || !samefn(idx)) {
+                                           auto rst = create_raster();
+                                           drawfn(*rst, idx);
+                                           enc = encode_raster(*rst);
+                                       }
+                                       return enc;
+                                   },
+                                   [&consumefn, &previous](std::optional<sla::EncodedRaster> &&enc, size_t idx) {
+                                       if (enc) previous = std::move(*enc);
+                                       consumefn(sla::EncodedRaster(previous), idx);
+                                   });
+    }
+    
+    // Defer the rasterization of the layers to the export and write each
+    // layer as soon as it is encoded, holding at most max_layers_in_memory
+    // encoded layers in memory instead of all of them. SLAPrint::process()
+    // then skips the rasterization and nothing is cached, thus every export
+    // rasterizes the layers again. Zero restores keeping all the layers
+    // rasterized by SLAPrint::process() in memory. Call before passing
+    // the printer to SLAPrint::set_printer().
+    void set_streaming(size_t max_layers_in_memory)
+    {
+        m_streaming_window = max_layers_in_memory;
+        m_layers = {};
     }
+    bool is_streaming() const { return m_streaming_window > 0; }
 };
 
 /**
@@ -457,17 +553,20 @@ public:
         std::vector<std::reference_wrapper<const SliceRecord>> m_slices;
 
         std::vector<ClipperLib::Polygon> m_transformed_slices;
+        // Hash of m_transformed_slices to quickly tell apart different layers.
+        size_t m_transformed_slices_hash = 0;
+
+    public:
+        
+        explicit PrintLayer(coord_t lvl) : m_level(lvl) {}
 
         template<class Container> void transformed_slices(Container&& c)
         {
             m_transformed_slices = std::forward<Container>(c);
+            m_transformed_slices_hash = hash(m_transformed_slices);
         }
         
-        friend class SLAPrint::Steps;
-
-    public:
-        
-        explicit PrintLayer(coord_t lvl) : m_level(lvl) {}
+        static size_t hash(const std::vector<ClipperLib::Polygon> &slices);
 
         // for being sorted in their container (see m_printer_input)
         bool operator<(const PrintLayer& other) const {
@@ -483,6 +582,20 @@ public:
         const std::vector<ClipperLib::Polygon> & transformed_slices() const {
             return m_transformed_slices;
         }
+        
+        // Whether the transformed slices of the two layers are identical,
+        // thus their rasters are identical as well.
+        bool same_slices(const PrintLayer &other) const
+        {
+            return same_slices(m_transformed_slices, m_transformed_slices_hash,
+                               other.m_transformed_slices,
+                               other.m_transformed_slices_hash);
+        }
+        
+        // The slices are compared only if their hashes match, equal hashes
+        // of different slices are told apart by the comparison.
+        static bool same_slices(const std::vector<ClipperLib::Polygon> &a, size_t hash_a,
+                                const std::vector<ClipperLib::Polygon> &b, size_t hash_b);
     };
 
     // The aggregated and leveled print records from various objects.
@@ -516,9 +629,11 @@ private:
     // Estimated print time, material consumed.
     SLAPrintStatistics              m_print_statistics;
     
+    // Thread safe, the objects report their progress concurrently.
     class StatusReporter
     {
         double m_st = 0;
+        mutable std::mutex m_mutex;
         
     public:
         void operator()(SLAPrint &         p,
@@ -527,7 +642,11 @@ private:
                         unsigned           flags = SlicingStatus::DEFAULT,
                         const std::string &logmsg = "");
         
-        double status() const { return m_st; }
+        double status() const
+        {
+            std::lock_guard<std::mutex> lk(m_mutex);
+            return m_st;
+        }
     } m_report_status;
 
 	friend SLAPrintObject;
@@ -1,5 +1,4 @@
 #include <libslic3r/SLAPrintSteps.hpp>
-#include <libslic3r/MeshBoolean.hpp>
 
 // Need the cylinder method for the the drainholes in hollowing step
 #include <libslic3r/SLA/SupportTreeBuilder.hpp>
@@ -72,7 +71,6 @@ std::string PRINT_STEP_LABELS(size_t idx)
 
 SLAPrint::Steps::Steps(SLAPrint *print)
     : m_print{print}
-    , m_rng{std::random_device{}()}
     , objcount{m_print->m_objects.size()}
     , ilhd{m_print->m_material_config.initial_layer_height.getFloat()}
     , ilh{float(ilhd)}
@@ -120,6 +118,7 @@ void SLAPrint::Steps::hollow_model(SLAPrintObject &po)
 
     if (! po.m_config.hollowing_enable.getBool()) {
         BOOST_LOG_TRIVIAL(info) << "Skipping hollowing step!";
+        po.m_interior_grid.clear();
         return;
     }
     
@@ -129,7 +128,8 @@ void SLAPrint::Steps::hollow_model(SLAPrintObject &po)
     double quality  = po.m_config.hollowing_quality.getFloat();
     double closing_d = po.m_config.hollowing_closing_distance.getFloat();
     sla::HollowingConfig hlwcfg{thickness, quality, closing_d};
-    auto meshptr = generate_interior(po.transformed_mesh(), hlwcfg);
+    auto meshptr = generate_interior(po.transformed_mesh(), hlwcfg, {},
+                                     po.m_interior_grid);
 
     if (meshptr->empty())
         BOOST_LOG_TRIVIAL(warning) << "Hollowed interior is empty!";
@@ -139,12 +139,18 @@ void SLAPrint::Steps::hollow_model(SLAPrintObject &po)
     }
 }
 
-// Drill holes into the hollowed/original mesh.
+// Prepare the hollowed/original mesh and the drain holes. The holes are not
+// drilled into the mesh here: they are cut from the slices in slice_model,
+// the supports see them through the hole aware raycaster and the mesh shown
+// in the 3D scene is drilled on demand by get_mesh_to_print().
 void SLAPrint::Steps::drill_holes(SLAPrintObject &po)
 {
     bool needs_drilling = ! po.m_model_object->sla_drain_holes.empty();
     bool is_hollowed = (po.m_hollowing_data && ! po.m_hollowing_data->interior.empty());
 
+    if (! needs_drilling)
+        po.m_drainhole_slices.clear();
+
     if (! is_hollowed && ! needs_drilling) {
         // In this case we can dump any data that might have been
         // generated on previous runs.
@@ -156,49 +162,21 @@ void SLAPrint::Steps::drill_holes(SLAPrintObject &po)
         po.m_hollowing_data.reset(new SLAPrintObject::HollowingData());
 
     // Hollowing and/or drilling is active, m_hollowing_data is valid.
+    SLAPrintObject::HollowingData &hd = *po.m_hollowing_data;
 
     // Regenerate hollowed mesh, even if it was there already. It may contain
     // holes that are no longer on the frontend.
-    TriangleMesh &hollowed_mesh = po.m_hollowing_data->hollow_mesh_with_holes;
-    hollowed_mesh = po.transformed_mesh();
-    if (! po.m_hollowing_data->interior.empty()) {
-        hollowed_mesh.merge(po.m_hollowing_data->interior);
-        hollowed_mesh.require_shared_vertices();
+    hd.hollow_mesh = po.transformed_mesh();
+    if (! hd.interior.empty()) {
+        hd.hollow_mesh.merge(hd.interior);
+        hd.hollow_mesh.require_shared_vertices();
     }
 
-    if (! needs_drilling) {
-        BOOST_LOG_TRIVIAL(info) << "Drilling skipped (no holes).";
-        return;
-    }
-    
-    BOOST_LOG_TRIVIAL(info) << "Drilling drainage holes.";
-    sla::DrainHoles drainholes = po.transformed_drainhole_points();
-    
-    std::uniform_real_distribution<float> dist(0., float(EPSILON));
-    auto holes_mesh_cgal = MeshBoolean::cgal::triangle_mesh_to_cgal({});
-    for (sla::DrainHole holept : drainholes) {
-        holept.normal += Vec3f{dist(m_rng), dist(m_rng), dist(m_rng)};
-        holept.normal.normalize();
-        holept.pos += Vec3f{dist(m_rng), dist(m_rng), dist(m_rng)};
-        TriangleMesh m = sla::to_triangle_mesh(holept.to_mesh());
-        m.require_shared_vertices();
-        auto cgal_m = MeshBoolean::cgal::triangle_mesh_to_cgal(m);
-        MeshBoolean::cgal::plus(*holes_mesh_cgal, *cgal_m);
-    }
-    
-    if (MeshBoolean::cgal::does_self_intersect(*holes_mesh_cgal))
-        throw std::runtime_error(L("Too much overlapping holes."));
-    
-    auto hollowed_mesh_cgal = MeshBoolean::cgal::triangle_mesh_to_cgal(hollowed_mesh);
-    
-    try {
-        MeshBoolean::cgal::minus(*hollowed_mesh_cgal, *holes_mesh_cgal);
-        hollowed_mesh = MeshBoolean::cgal::cgal_to_triangle_mesh(*hollowed_mesh_cgal);
-    } catch (const std::runtime_error &) {
-        throw std::runtime_error(L(
-            "Drilling holes into the mesh failed. "
-            "This is usually caused by broken model. Try to fix it first."));
-    }
+    hd.drainholes = po.transformed_drainhole_points();
+
+    std::lock_guard<std::mutex> lock(hd.drilling_mutex);
+    hd.hollow_mesh_with_holes.clear();
+    hd.holes_drilled = false;
 }
 
 // The slicing will be performed on an imaginary 1D grid which starts from
@@ -211,7 +189,8 @@ void SLAPrint::Steps::drill_holes(SLAPrintObject &po)
 // same imaginary grid (the height vector argument to TriangleMeshSlicer).
 void SLAPrint::Steps::slice_model(SLAPrintObject &po)
 {   
-    const TriangleMesh &mesh = po.get_mesh_to_print();
+    // The drain holes are cut from the slices, the mesh is sliced undrilled.
+    const TriangleMesh &mesh = po.transformed_mesh();
 
     // We need to prepare the slice index...
     
@@ -250,25 +229,41 @@ void SLAPrint::Steps::slice_model(SLAPrintObject &po)
     for(auto it = slindex_it; it != po.m_slice_index.end(); ++it)
         po.m_model_height_levels.emplace_back(it->slice_level());
     
-    TriangleMeshSlicer slicer(&mesh);
-    
     po.m_model_slices.clear();
+    po.m_support_point_layers.clear();
     float closing_r  = float(po.config().slice_closing_radius.value);
     auto  thr        = [this]() { m_print->throw_if_canceled(); };
     auto &slice_grid = po.m_model_height_levels;
-    slicer.slice(slice_grid, SlicingMode::Regular, closing_r, &po.m_model_slices, thr);
-    
-    if (po.m_hollowing_data && ! po.m_hollowing_data->interior.empty()) {
-        po.m_hollowing_data->interior.repair(true);
-        TriangleMeshSlicer interior_slicer(&po.m_hollowing_data->interior);
-        std::vector<ExPolygons> interior_slices;
-        interior_slicer.slice(slice_grid, SlicingMode::Regular, closing_r, &interior_slices, thr);
-
-        sla::ccr::enumerate(interior_slices.begin(), interior_slices.end(),
-                            [&po](const ExPolygons &slice, size_t i) {
-                                po.m_model_slices[i] =
-                                    diff_ex(po.m_model_slices[i], slice);
-                            });
+
+    // The slices without the drain holes are kept, if only the holes have
+    // changed since the last run, the model is not sliced again.
+    if (po.m_model_slices_undrilled.empty()) {
+        std::vector<ExPolygons> slices;
+        TriangleMeshSlicer slicer(&mesh);
+        slicer.slice(slice_grid, SlicingMode::Regular, closing_r, &slices, thr);
+
+        if (po.m_hollowing_data && ! po.m_hollowing_data->interior.empty()) {
+            po.m_hollowing_data->interior.repair(true);
+            TriangleMeshSlicer interior_slicer(&po.m_hollowing_data->interior);
+            std::vector<ExPolygons> interior_slices;
+            interior_slicer.slice(slice_grid, SlicingMode::Regular, closing_r, &interior_slices, thr);
+
+            sla::ccr::enumerate(interior_slices.begin(), interior_slices.end(),
+                                [&slices](const ExPolygons &slice, size_t i) {
+                                    slices[i] = diff_ex(slices[i], slice);
+                                });
+        }
+
+        po.m_model_slices_undrilled = std::move(slices);
+    }
+
+    po.m_model_slices = po.m_model_slices_undrilled;
+
+    if (! po.m_model_object->sla_drain_holes.empty()) {
+        BOOST_LOG_TRIVIAL(info) << "Cutting drainage holes.";
+        po.m_drainhole_slices.update(po.transformed_drainhole_points(),
+                                     slice_grid, closing_r, thr);
+        po.m_drainhole_slices.cut(po.m_model_slices);
     }
     
     auto mit = slindex_it;
@@ -283,7 +278,7 @@ void SLAPrint::Steps::slice_model(SLAPrintObject &po)
         
     if(po.m_config.supports_enable.getBool() || po.m_config.pad_enable.getBool())
     {
-        po.m_supportdata.reset(new SLAPrintObject::SupportData(mesh));
+        po.m_supportdata.reset(new SLAPrintObject::SupportData(po.get_mesh_to_slice()));
     }
 }
 
@@ -294,7 +289,7 @@ void SLAPrint::Steps::support_points(SLAPrintObject &po)
     // If supports are disabled, we can skip the model scan.
     if(!po.m_config.supports_enable.getBool()) return;
     
-    const TriangleMesh &mesh = po.get_mesh_to_print();
+    const TriangleMesh &mesh = po.get_mesh_to_slice();
     
     if (!po.m_supportdata)
         po.m_supportdata.reset(new SLAPrintObject::SupportData(mesh));
@@ -315,7 +310,7 @@ void SLAPrint::Steps::support_points(SLAPrintObject &po)
         // Tell the mesh where drain holes are. Although the points are
         // calculated on slices, the algorithm then raycasts the points
         // so they actually lie on the mesh.
-//        po.m_supportdata->emesh.load_holes(po.transformed_drainhole_points());
+        po.m_supportdata->emesh.load_holes(po.transformed_drainhole_points());
         
         throw_if_canceled();
         sla::SupportPointGenerator::Config config;
@@ -337,12 +332,21 @@ void SLAPrint::Steps::support_points(SLAPrintObject &po)
                 report_status(current, OBJ_STEP_LABELS(slaposSupportPoints));
         };
         
-        // Construction of this object does the calculation.
         throw_if_canceled();
         sla::SupportPointGenerator auto_supports(
-            po.m_supportdata->emesh, po.get_model_slices(), heights, config,
+            po.m_supportdata->emesh, config,
             [this]() { throw_if_canceled(); }, statuscb);
 
+        // The islands depend on the slices only, so they are built once and
+        // reused when just the density or the minimal distance changes.
+        if (po.m_support_point_layers.empty())
+            po.m_support_point_layers = sla::SupportPointGenerator::make_layers(
+                po.get_model_slices(), heights, [this]() { throw_if_canceled(); });
+
+        std::random_device rd;
+        auto_supports.seed(rd());
+        auto_supports.execute(po.m_support_point_layers);
+
         // Now let's extract the result.
         const std::vector<sla::SupportPoint>& points = auto_supports.output();
         throw_if_canceled();
@@ -384,7 +388,7 @@ void SLAPrint::Steps::support_tree(SLAPrintObject &po)
         po.m_supportdata->emesh.ground_level_offset(pcfg.wall_thickness_mm);
     
     po.m_supportdata->cfg = make_support_cfg(po.m_config);
-//    po.m_supportdata->emesh.load_holes(po.transformed_drainhole_points());
+    po.m_supportdata->emesh.load_holes(po.transformed_drainhole_points());
     
     // scaling for the sub operations
     double d = objectstep_scale * OBJ_STEP_LEVELS[slaposSupportTree] / 100.0;
@@ -816,7 +820,8 @@ void SLAPrint::Steps::merge_slices_and_eval_stats() {
 // Rasterizing the model objects, and their supports
 void SLAPrint::Steps::rasterize()
 {
-    if(canceled() || !m_print->m_printer) return;
+    // A streaming printer rasterizes the layers while exporting them.
+    if(canceled() || !m_print->m_printer || m_print->m_printer->is_streaming()) return;
     
     // coefficient to map the rasterization state (0-99) to the allocated
     // portion (slot) of the process state
@@ -828,7 +833,19 @@ void SLAPrint::Steps::rasterize()
     // pst: previous state
     double pst = current_status();
     
-    double increment = (slot * sd) / m_print->m_printer_input.size();
+    const std::vector<PrintLayer> &layers = m_print->m_printer_input;
+    
+    // Layers identical to the previous one share its raster, see draw_layers().
+    // The layers are compared just once, the result is needed for the status
+    // increment before the drawing.
+    std::vector<char> same(layers.size(), false);
+    size_t num_drawn = layers.empty() ? 0 : 1;
+    for (size_t idx = 1; idx < layers.size(); ++idx)
+        if (! (same[idx] = layers[idx].same_slices(layers[idx - 1]))) ++num_drawn;
+    
+    auto samefn = [&same](size_t idx) { return bool(same[idx]); };
+    
+    double increment = (slot * sd) / num_drawn;
     double dstatus = current_status();
     
     sla::ccr::SpinningMutex slck;
@@ -842,8 +859,7 @@ void SLAPrint::Steps::rasterize()
         PrintLayer& printlayer = m_print->m_printer_input[idx];
         if(canceled()) return;
         
-        for (const ClipperLib::Polygon& poly : printlayer.transformed_slices())
-            raster.draw(poly);
+        raster.draw(printlayer.transformed_slices());
         
         // Status indication guarded with the spinlock
         {
@@ -861,7 +877,7 @@ void SLAPrint::Steps::rasterize()
     if(canceled()) return;
     
     // Print all the layers in parallel
-    m_print->m_printer->draw_layers(m_print->m_printer_input.size(), lvlfn);
+    m_print->m_printer->draw_layers(layers.size(), lvlfn, samefn);
 }
 
 std::string SLAPrint::Steps::label(SLAPrintObjectStep step)
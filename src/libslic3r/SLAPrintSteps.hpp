@@ -1,7 +1,6 @@
 #ifndef SLAPRINTSTEPS_HPP
 #define SLAPRINTSTEPS_HPP
 
-#include <random>
 
 #include <libslic3r/SLAPrint.hpp>
 
@@ -14,7 +13,6 @@ class SLAPrint::Steps
 {
 private:
     SLAPrint *m_print = nullptr;
-    std::mt19937 m_rng;
     
 public:    
     // where the per object operations start and end
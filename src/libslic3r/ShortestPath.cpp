@@ -10,8 +10,12 @@
 #include "MutablePriorityQueue.hpp"
 #include "Print.hpp"
 
+#include <chrono>
 #include <cmath>
 #include <cassert>
+#include <numeric>
+
+#include <tbb/parallel_for.h>
 
 namespace Slic3r {
 
@@ -998,11 +1002,116 @@ std::vector<std::pair<size_t, bool>> chain_segments_greedy2(SegmentEndPointFunc
 	return chain_segments_greedy_constrained_reversals2_<PointType, SegmentEndPointFunc, false, decltype(could_reverse_func)>(end_point_func, could_reverse_func, num_segments, start_near);
 }
 
-std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near)
+// Split a set of segments into spatially coherent clusters of at most max_cluster_size segments by a recursive median split
+// along the longer side of the bounding box of the segment centers. The clusters are the leaves of a balanced KD tree.
+static std::vector<std::vector<size_t>> cluster_segments_kdtree(const std::vector<Vec2d> &centers, size_t max_cluster_size)
+{
+	assert(max_cluster_size > 0);
+	std::vector<std::vector<size_t>> clusters;
+	std::vector<size_t> 			 indices(centers.size());
+	std::iota(indices.begin(), indices.end(), 0);
+	std::vector<std::pair<size_t, size_t>> ranges { { 0, indices.size() } };
+	while (! ranges.empty()) {
+		std::pair<size_t, size_t> range = ranges.back();
+		ranges.pop_back();
+		if (range.second - range.first <= max_cluster_size) {
+			clusters.emplace_back(indices.begin() + range.first, indices.begin() + range.second);
+			continue;
+		}
+		Vec2d bbox_min = centers[indices[range.first]];
+		Vec2d bbox_max = bbox_min;
+		for (size_t i = range.first + 1; i < range.second; ++ i) {
+			bbox_min = bbox_min.cwiseMin(centers[indices[i]]);
+			bbox_max = bbox_max.cwiseMax(centers[indices[i]]);
+		}
+		int    axis = (bbox_max.x() - bbox_min.x() > bbox_max.y() - bbox_min.y()) ? 0 : 1;
+		size_t mid  = (range.first + range.second) / 2;
+		std::nth_element(indices.begin() + range.first, indices.begin() + mid, indices.begin() + range.second,
+			[&centers, axis](size_t i1, size_t i2) { return centers[i1](axis) < centers[i2](axis); });
+		// Push the second half first, so that the first half is processed first.
+		ranges.emplace_back(mid, range.second);
+		ranges.emplace_back(range.first, mid);
+	}
+	return clusters;
+}
+
+// Chain a very large number of segments. The segments are split into spatial clusters of at most params.max_cluster_size segments,
+// the clusters are ordered by their centroids and each cluster is chained by chain_func() in parallel, starting close to the centroid
+// of the preceding cluster. The partial chains are then concatenated.
+// For small inputs chain_func() is called directly.
+template<typename PointType, typename SegmentEndPointFunc, typename CouldReverseFunc, typename ChainFunc>
+std::vector<std::pair<size_t, bool>> chain_segments_clustered(SegmentEndPointFunc end_point_func, CouldReverseFunc could_reverse_func, size_t num_segments, const PointType *start_near, const ChainingParams &params, ChainFunc chain_func)
+{
+	if (params.max_cluster_size == 0 || num_segments <= params.max_cluster_size)
+		return chain_func(end_point_func, could_reverse_func, num_segments, start_near);
+
+	std::vector<Vec2d> centers;
+	centers.reserve(num_segments);
+	for (size_t i = 0; i < num_segments; ++ i)
+		centers.emplace_back(0.5 * (end_point_func(i, true).template cast<double>() + end_point_func(i, false).template cast<double>()));
+	std::vector<std::vector<size_t>> clusters = cluster_segments_kdtree(centers, params.max_cluster_size);
+
+	// Order the clusters by their centroids.
+	std::vector<PointType> centroids;
+	centroids.reserve(clusters.size());
+	for (const std::vector<size_t> &cluster : clusters) {
+		Vec2d c = Vec2d::Zero();
+		for (size_t idx : cluster)
+			c += centers[idx];
+		centroids.emplace_back(Vec2d(c / double(cluster.size())));
+	}
+	auto centroid_end_point = [&centroids](size_t idx, bool /* first_point */) -> const PointType& { return centroids[idx]; };
+	std::vector<std::pair<size_t, bool>> cluster_order = chain_segments_greedy<PointType, decltype(centroid_end_point)>(centroid_end_point, centroids.size(), start_near);
+
+	std::vector<std::vector<std::pair<size_t, bool>>> chains(cluster_order.size());
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, cluster_order.size()),
+		[&](const tbb::blocked_range<size_t> &range) {
+			for (size_t i = range.begin(); i < range.end(); ++ i) {
+				const std::vector<size_t> &cluster = clusters[cluster_order[i].first];
+				auto cluster_end_point   = [&cluster, &end_point_func](size_t idx, bool first_point) -> const PointType& { return end_point_func(cluster[idx], first_point); };
+				auto cluster_could_reverse = [&cluster, &could_reverse_func](size_t idx) { return could_reverse_func(cluster[idx]); };
+				const PointType *cluster_start_near = (i == 0) ? start_near : &centroids[cluster_order[i - 1].first];
+				if (cluster.size() == 1)
+					chains[i].emplace_back(0, false);
+				else
+					chains[i] = chain_func(cluster_end_point, cluster_could_reverse, cluster.size(), cluster_start_near);
+				// Map the cluster local indices back to the input indices.
+				for (std::pair<size_t, bool> &segment : chains[i])
+					segment.first = cluster[segment.first];
+			}
+		});
+
+	// The partial chains were chained in parallel without knowledge of where the preceding chain ends.
+	// Reverse a partial chain if it connects to the end of the preceding chain with a shorter travel and all its segments may be reversed.
+	auto chain_end_point = [&end_point_func](const std::pair<size_t, bool> &segment, bool first_point) -> const PointType& 
+		{ return end_point_func(segment.first, first_point != segment.second); };
+	for (size_t i = 1; i < chains.size(); ++ i) {
+		std::vector<std::pair<size_t, bool>> &chain = chains[i];
+		const PointType &prev_end = chain_end_point(chains[i - 1].back(), false);
+		if ((chain_end_point(chain.back(), false) - prev_end).template cast<double>().squaredNorm() < (chain_end_point(chain.front(), true) - prev_end).template cast<double>().squaredNorm() &&
+			std::all_of(chain.begin(), chain.end(), [&could_reverse_func](const std::pair<size_t, bool> &segment){ return could_reverse_func(segment.first); })) {
+			std::reverse(chain.begin(), chain.end());
+			for (std::pair<size_t, bool> &segment : chain)
+				segment.second = ! segment.second;
+		}
+	}
+
+	std::vector<std::pair<size_t, bool>> out;
+	out.reserve(num_segments);
+	for (const std::vector<std::pair<size_t, bool>> &chain : chains)
+		out.insert(out.end(), chain.begin(), chain.end());
+	assert(out.size() == num_segments);
+	return out;
+}
+
+std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near, const ChainingParams &params)
 {
 	auto segment_end_point = [&entities](size_t idx, bool first_point) -> const Point& { return first_point ? entities[idx]->first_point() : entities[idx]->last_point(); };
 	auto could_reverse = [&entities](size_t idx) { const ExtrusionEntity *ee = entities[idx]; return ee->is_loop() || ee->can_reverse(); };
-	std::vector<std::pair<size_t, bool>> out = chain_segments_greedy_constrained_reversals<Point, decltype(segment_end_point), decltype(could_reverse)>(segment_end_point, could_reverse, entities.size(), start_near);
+	std::vector<std::pair<size_t, bool>> out = chain_segments_clustered<Point>(segment_end_point, could_reverse, entities.size(), start_near, params,
+		[](auto end_point_func, auto could_reverse_func, size_t num_segments, const Point *start_near) {
+			return chain_segments_greedy_constrained_reversals<Point, decltype(end_point_func), decltype(could_reverse_func)>(end_point_func, could_reverse_func, num_segments, start_near);
+		});
 	for (std::pair<size_t, bool> &segment : out) {
 		ExtrusionEntity *ee = entities[segment.first];
 		if (ee->is_loop())
@@ -1028,9 +1137,9 @@ void reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const s
     entities.swap(out);
 }
 
-void chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near)
+void chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near, const ChainingParams &params)
 {
-	reorder_extrusion_entities(entities, chain_extrusion_entities(entities, start_near));
+	reorder_extrusion_entities(entities, chain_extrusion_entities(entities, start_near, params));
 }
 
 std::vector<std::pair<size_t, bool>> chain_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, const Point *start_near)
@@ -1527,7 +1636,8 @@ static inline void do_crossover(const std::vector<FlipEdge> &edges_in, std::vect
 	assert(edges_in.size() == edges_out.size());
 }
 
-static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<FlipEdge> &edges)
+// If deadline is not null, the improvement stops at the first iteration started after the deadline.
+static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<FlipEdge> &edges, const std::chrono::steady_clock::time_point *deadline = nullptr)
 {
 	if (edges.size() < 2)
 		return;
@@ -1537,6 +1647,9 @@ static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<Fl
 	std::vector<std::pair<double, size_t>>	connection_lengths(edges.size() - 1, std::pair<double, size_t>(0., 0));
 	std::vector<char>						connection_tried(edges.size(), false);
 	for (size_t iter = 0; iter < edges.size(); ++ iter) {
+		if (deadline != nullptr && std::chrono::steady_clock::now() > *deadline)
+			// Out of the time budget, keep the ordering improved so far.
+			break;
 		// Initialize connection costs and connection lengths.
 		for (size_t i = 1; i < edges.size(); ++ i) {
 			const FlipEdge   	 &e1 = edges[i - 1];
@@ -1554,6 +1667,9 @@ static inline void reorder_by_two_exchanges_with_segment_flipping(std::vector<Fl
 		size_t crossover2_pos_final = std::numeric_limits<size_t>::max();
 		size_t crossover_flip_final = 0;
 		for (const std::pair<double, size_t> &first_crossover_candidate : connection_lengths) {
+			if (deadline != nullptr && std::chrono::steady_clock::now() > *deadline)
+				// Searching for an improving crossover is quadratic. Give up the search once out of the time budget.
+				break;
 			double longest_connection_length = first_crossover_candidate.first;
 			size_t longest_connection_idx    = first_crossover_candidate.second;
 			connection_tried[longest_connection_idx] = true;
@@ -1852,7 +1968,7 @@ static inline void reorder_by_three_exchanges_with_segment_flipping2(std::vector
 }
 
 // Flip the sequences of polylines to lower the total length of connecting lines.
-static inline void improve_ordering_by_two_exchanges_with_segment_flipping(Polylines &polylines, bool fixed_start)
+static inline void improve_ordering_by_two_exchanges_with_segment_flipping(Polylines &polylines, bool fixed_start, const std::chrono::steady_clock::time_point *deadline = nullptr)
 {
 #ifndef NDEBUG
 	auto cost = [&polylines]() {
@@ -1875,7 +1991,7 @@ static inline void improve_ordering_by_two_exchanges_with_segment_flipping(Polyl
     std::transform(polylines.begin(), polylines.end(), std::back_inserter(edges), 
     	[&polylines](const Polyline &pl){ return FlipEdge(pl.first_point().cast<double>(), pl.last_point().cast<double>(), &pl - polylines.data()); });
 #if 1
-	reorder_by_two_exchanges_with_segment_flipping(edges);
+	reorder_by_two_exchanges_with_segment_flipping(edges, deadline);
 #else
 	// reorder_by_three_exchanges_with_segment_flipping(edges);
 	reorder_by_three_exchanges_with_segment_flipping2(edges);
@@ -1885,25 +2001,26 @@ static inline void improve_ordering_by_two_exchanges_with_segment_flipping(Polyl
 	for (const FlipEdge &edge : edges) {
 		Polyline &pl = polylines[edge.source_index];
 		out.emplace_back(std::move(pl));
-		if (edge.p2 == pl.first_point().cast<double>()) {
+		if (edge.p2 == out.back().first_point().cast<double>()) {
 			// Polyline is flipped.
 			out.back().reverse();
 		} else {
 			// Polyline is not flipped.
-			assert(edge.p1 == pl.first_point().cast<double>());
+			assert(edge.p1 == out.back().first_point().cast<double>());
 		}
 	}
+	polylines = std::move(out);
 
 #ifndef NDEBUG
 	double cost_final = cost();
 #ifdef DEBUG_SVG_OUTPUT
-	svg_draw_polyline_chain("improve_ordering_by_two_exchanges_with_segment_flipping-final", iRun, out);
+	svg_draw_polyline_chain("improve_ordering_by_two_exchanges_with_segment_flipping-final", iRun, polylines);
 #endif /* DEBUG_SVG_OUTPUT */
 	assert(cost_final <= cost_initial);
 #endif /* NDEBUG */
 }
 
-Polylines chain_polylines(Polylines &&polylines, const Point *start_near)
+Polylines chain_polylines(Polylines &&polylines, const Point *start_near, const ChainingParams &params)
 {
 #ifdef DEBUG_SVG_OUTPUT
 	static int iRun = 0;
@@ -1914,7 +2031,15 @@ Polylines chain_polylines(Polylines &&polylines, const Point *start_near)
 	Polylines out;
 	if (! polylines.empty()) {
 		auto segment_end_point = [&polylines](size_t idx, bool first_point) -> const Point& { return first_point ? polylines[idx].first_point() : polylines[idx].last_point(); };
-		std::vector<std::pair<size_t, bool>> ordered = chain_segments_greedy2<Point, decltype(segment_end_point)>(segment_end_point, polylines.size(), start_near);
+		auto could_reverse = [](size_t /* idx */) { return true; };
+		std::vector<std::pair<size_t, bool>> ordered = chain_segments_clustered<Point>(segment_end_point, could_reverse, polylines.size(), start_near, params,
+			[](auto end_point_func, auto /* could_reverse_func */, size_t num_segments, const Point *start_near) {
+				// chain_segments_greedy2() may terminate early with a fixed starting point on regular grids of segments, leaving some segments
+				// unchained. Clusters chained starting near the preceding cluster use the simpler greedy chaining.
+				return (start_near == nullptr) ?
+					chain_segments_greedy2<Point, decltype(end_point_func)>(end_point_func, num_segments, nullptr) :
+					chain_segments_greedy <Point, decltype(end_point_func)>(end_point_func, num_segments, start_near);
+			});
 		out.reserve(polylines.size()); 
 		for (auto &segment_and_reversal : ordered) {
 			out.emplace_back(std::move(polylines[segment_and_reversal.first]));
@@ -1922,7 +2047,27 @@ Polylines chain_polylines(Polylines &&polylines, const Point *start_near)
 				out.back().reverse();
 		}
 		if (out.size() > 1 && start_near == nullptr) {
-			improve_ordering_by_two_exchanges_with_segment_flipping(out, start_near != nullptr);
+			std::chrono::steady_clock::time_point 		 deadline     = std::chrono::steady_clock::now() + 
+				std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(params.time_budget));
+			const std::chrono::steady_clock::time_point *deadline_ptr = params.time_budget > 0. ? &deadline : nullptr;
+			if (params.max_cluster_size == 0 || out.size() <= params.max_cluster_size)
+				improve_ordering_by_two_exchanges_with_segment_flipping(out, start_near != nullptr, deadline_ptr);
+			else {
+				// Each 2-opt iteration is quadratic in the number of polylines. Improve consecutive windows of the chain independently,
+				// the windows roughly correspond to the spatial clusters.
+				size_t num_windows = (out.size() + params.max_cluster_size - 1) / params.max_cluster_size;
+				tbb::parallel_for(tbb::blocked_range<size_t>(0, num_windows),
+					[&out, &params, deadline_ptr](const tbb::blocked_range<size_t> &range) {
+						for (size_t i = range.begin(); i < range.end(); ++ i) {
+							size_t    begin = i * params.max_cluster_size;
+							size_t    end   = std::min(out.size(), begin + params.max_cluster_size);
+							Polylines window(std::make_move_iterator(out.begin() + begin), std::make_move_iterator(out.begin() + end));
+							if (window.size() > 1)
+								improve_ordering_by_two_exchanges_with_segment_flipping(window, false, deadline_ptr);
+							std::move(window.begin(), window.end(), out.begin() + begin);
+						}
+					});
+			}
 			//improve_ordering_by_segment_flipping(out, start_near != nullptr);
 		}
 	}
@@ -1949,7 +2094,7 @@ ClipperLib::PolyNodes chain_clipper_polynodes(const Points &points, const Clippe
 	return chain_path_items(points, items);
 }
 
-std::vector<const PrintInstance*> chain_print_object_instances(const Print &print)
+std::vector<const PrintInstance*> chain_print_object_instances(const Print &print, const ChainingParams &params)
 {
     // Order objects using a nearest neighbor search.
     Points object_reference_points;
@@ -1963,7 +2108,11 @@ std::vector<const PrintInstance*> chain_print_object_instances(const Print &prin
         }
     }
 	auto segment_end_point = [&object_reference_points](size_t idx, bool /* first_point */) -> const Point& { return object_reference_points[idx]; };
-	std::vector<std::pair<size_t, bool>> ordered = chain_segments_greedy<Point, decltype(segment_end_point)>(segment_end_point, instances.size(), nullptr);
+	auto could_reverse = [](size_t /* idx */) { return true; };
+	std::vector<std::pair<size_t, bool>> ordered = chain_segments_clustered<Point>(segment_end_point, could_reverse, instances.size(), (const Point*)nullptr, params,
+		[](auto end_point_func, auto /* could_reverse_func */, size_t num_segments, const Point *start_near) {
+			return chain_segments_greedy<Point, decltype(end_point_func)>(end_point_func, num_segments, start_near);
+		});
     std::vector<const PrintInstance*> out;
 	out.reserve(instances.size());
 	for (auto &segment_and_reversal : ordered) {
@@ -12,18 +12,30 @@ namespace ClipperLib { class PolyNode; }
 
 namespace Slic3r {
 
+// Control of the chaining of a very large number of segments (tens of thousands of short gap fill or support lines).
+// Up to max_cluster_size segments are chained directly by the greedy algorithm. Larger sets are recursively split into spatial
+// clusters of at most max_cluster_size segments, the clusters are chained in parallel and the partial chains are stitched together.
+struct ChainingParams
+{
+	// Maximum number of segments chained at once. Zero disables the clustering.
+	size_t 	max_cluster_size = 2000;
+	// Time limit for the iterative improvement of chain_polylines() by 2-opt exchanges, in seconds. Zero or negative for no limit.
+	// No limit by default, so that the result does not depend on the speed of the machine.
+	double 	time_budget      = 0.;
+};
+
 std::vector<size_t> 				 chain_points(const Points &points, Point *start_near = nullptr);
 
-std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr);
+std::vector<std::pair<size_t, bool>> chain_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr, const ChainingParams &params = ChainingParams());
 void                                 reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const std::vector<std::pair<size_t, bool>> &chain);
-void                                 chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr);
+void                                 chain_and_reorder_extrusion_entities(std::vector<ExtrusionEntity*> &entities, const Point *start_near = nullptr, const ChainingParams &params = ChainingParams());
 
 std::vector<std::pair<size_t, bool>> chain_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, const Point *start_near = nullptr);
 void                                 reorder_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, std::vector<std::pair<size_t, bool>> &chain);
 void                                 chain_and_reorder_extrusion_paths(std::vector<ExtrusionPath> &extrusion_paths, const Point *start_near = nullptr);
 
-Polylines 							 chain_polylines(Polylines &&src, const Point *start_near = nullptr);
-inline Polylines 					 chain_polylines(const Polylines& src, const Point* start_near = nullptr) { Polylines tmp(src); return chain_polylines(std::move(tmp), start_near); }
+Polylines 							 chain_polylines(Polylines &&src, const Point *start_near = nullptr, const ChainingParams &params = ChainingParams());
+inline Polylines 					 chain_polylines(const Polylines& src, const Point* start_near = nullptr, const ChainingParams &params = ChainingParams()) { Polylines tmp(src); return chain_polylines(std::move(tmp), start_near, params); }
 
 std::vector<ClipperLib::PolyNode*>	 chain_clipper_polynodes(const Points &points, const std::vector<ClipperLib::PolyNode*> &items);
 
@@ -31,7 +43,7 @@ std::vector<ClipperLib::PolyNode*>	 chain_clipper_polynodes(const Points &points
 // Returns pairs of PrintObject idx and instance of that PrintObject.
 class Print;
 struct PrintInstance;
-std::vector<const PrintInstance*> 	 chain_print_object_instances(const Print &print);
+std::vector<const PrintInstance*> 	 chain_print_object_instances(const Print &print, const ChainingParams &params = ChainingParams());
 
 
 } // namespace Slic3r
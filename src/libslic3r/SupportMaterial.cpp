@@ -6,6 +6,7 @@
 #include "Fill/FillBase.hpp"
 #include "EdgeGrid.hpp"
 #include "Geometry.hpp"
+#include "Utils.hpp"
 
 #include <cmath>
 #include <memory>
@@ -227,7 +228,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
     // The layers will be referenced by various LayersPtr (of type std::vector<Layer*>)
     MyLayerStorage layer_storage;
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating top contacts";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating top contacts" << log_memory_info();
 
     // Determine the top contact surfaces of the support, defined as:
     // contact = overhangs - clearance + margin
@@ -249,7 +250,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
             union_ex(layer->polygons, false));
 #endif /* SLIC3R_DEBUG */
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating bottom contacts";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating bottom contacts" << log_memory_info();
 
     // Determine the bottom contact surfaces of the supports over the top surfaces of the object.
     // Depending on whether the support is soluble or not, the contact layer thickness is decided.
@@ -267,7 +268,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
             union_ex(layer_support_areas[layer_id], false));
 #endif /* SLIC3R_DEBUG */
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating intermediate layers - indices";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating intermediate layers - indices" << log_memory_info();
 
     // Allocate empty layers between the top / bottom support contact layers
     // as placeholders for the base and intermediate support layers.
@@ -289,10 +290,12 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
             union_ex(layer->polygons, false));
 #endif
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating base layers";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating base layers" << log_memory_info();
 
     // Fill in intermediate layers between the top / bottom support contact layers, trimm them by the object.
     this->generate_base_layers(object, bottom_contacts, top_contacts, intermediate_layers, layer_support_areas);
+    // The per object layer support areas are not needed anymore, release them before the interfaces and tool paths are generated.
+    std::vector<Polygons>().swap(layer_support_areas);
 
 #ifdef SLIC3R_DEBUG
     for (MyLayersPtr::const_iterator it = intermediate_layers.begin(); it != intermediate_layers.end(); ++ it)
@@ -301,7 +304,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
             union_ex((*it)->polygons, false));
 #endif /* SLIC3R_DEBUG */
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - Trimming top contacts by bottom contacts";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - Trimming top contacts by bottom contacts" << log_memory_info();
 
     // Because the top and bottom contacts are thick slabs, they may overlap causing over extrusion 
     // and unwanted strong bonds to the object.
@@ -310,13 +313,13 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
     this->trim_top_contacts_by_bottom_contacts(object, bottom_contacts, top_contacts);
 
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating interfaces";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating interfaces" << log_memory_info();
 
     // Propagate top / bottom contact layers to generate interface layers.
     MyLayersPtr interface_layers = this->generate_interface_layers(
         bottom_contacts, top_contacts, intermediate_layers, layer_storage);
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating raft";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating raft" << log_memory_info();
 
     // If raft is to be generated, the 1st top_contact layer will contain the 1st object layer silhouette with holes filled.
     // There is also a 1st intermediate layer containing bases of support columns.
@@ -338,7 +341,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
     }
 */
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating layers";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - Creating layers" << log_memory_info();
 
 // For debugging purposes, one may want to show only some of the support extrusions.
 //    raft_layers.clear();
@@ -385,7 +388,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
         i = j;
     }
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - Generating tool paths";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - Generating tool paths" << log_memory_info();
 
     // Generate the actual toolpaths and save them into each layer.
     this->generate_toolpaths(object, raft_layers, bottom_contacts, top_contacts, intermediate_layers, interface_layers);
@@ -417,7 +420,7 @@ void PrintObjectSupportMaterial::generate(PrintObject &object)
     }
 #endif /* SLIC3R_DEBUG */
 
-    BOOST_LOG_TRIVIAL(info) << "Support generator - End";
+    BOOST_LOG_TRIVIAL(info) << "Support generator - End" << log_memory_info();
 }
 
 // Collect all polygons of all regions in a layer with a given surface type.
@@ -1936,7 +1939,7 @@ void PrintObjectSupportMaterial::generate_base_layers(
     const MyLayersPtr   &bottom_contacts,
     const MyLayersPtr   &top_contacts,
     MyLayersPtr         &intermediate_layers,
-    const std::vector<Polygons> &layer_support_areas) const
+    std::vector<Polygons> &layer_support_areas) const
 {
 #ifdef SLIC3R_DEBUG
     static int iRun = 0;
@@ -1948,14 +1951,29 @@ void PrintObjectSupportMaterial::generate_base_layers(
 
     // coordf_t fillet_radius_scaled = scale_(m_object_config->support_material_spacing);
 
+    // Object layer, of which the support area is used by an intermediate layer, and the number of intermediate layers
+    // using the support area of an object layer. The support area is released by the last intermediate layer using it,
+    // so that the support areas of the object layers and the base layers are not held in memory twice.
+    std::vector<int>              idx_object_layers_above(intermediate_layers.size(), 0);
+    std::vector<tbb::atomic<int>> layer_support_areas_users(layer_support_areas.size());
+    for (tbb::atomic<int> &users : layer_support_areas_users)
+        users = 0;
+    for (int idx_intermediate = int(intermediate_layers.size()) - 1, idx_object_layer_above = -2; idx_intermediate >= 0; -- idx_intermediate) {
+        const MyLayer &layer_intermediate = *intermediate_layers[idx_intermediate];
+        idx_object_layer_above = std::max(0, idx_lower_or_equal(object.layers(), idx_object_layer_above, 
+            [&layer_intermediate](const Layer *layer){ return layer->print_z <= layer_intermediate.print_z + EPSILON; }));
+        idx_object_layers_above[idx_intermediate] = idx_object_layer_above;
+        ++ layer_support_areas_users[idx_object_layer_above];
+    }
+
     BOOST_LOG_TRIVIAL(debug) << "PrintObjectSupportMaterial::generate_base_layers() in parallel - start";
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, intermediate_layers.size()),
-        [this, &object, &bottom_contacts, &top_contacts, &intermediate_layers, &layer_support_areas](const tbb::blocked_range<size_t>& range) {
+        [this, &object, &bottom_contacts, &top_contacts, &intermediate_layers, &layer_support_areas, &idx_object_layers_above, &layer_support_areas_users]
+        (const tbb::blocked_range<size_t>& range) {
             // index -2 means not initialized yet, -1 means intialized and decremented to 0 and then -1.
             int idx_top_contact_above           = -2;
             int idx_bottom_contact_overlapping  = -2;
-            int idx_object_layer_above          = -2;
             // Counting down due to the way idx_lower_or_equal caches indices to avoid repeated binary search over the complete sequence.
             for (int idx_intermediate = int(range.end()) - 1; idx_intermediate >= int(range.begin()); -- idx_intermediate)
             {
@@ -1969,10 +1987,15 @@ void PrintObjectSupportMaterial::generate_base_layers(
                 // New polygons for layer_intermediate.
                 Polygons polygons_new;
 
-                // Use the precomputed layer_support_areas.
-                idx_object_layer_above = std::max(0, idx_lower_or_equal(object.layers(), idx_object_layer_above, 
-                    [&layer_intermediate](const Layer *layer){ return layer->print_z <= layer_intermediate.print_z + EPSILON; }));
-                polygons_new = layer_support_areas[idx_object_layer_above];
+                // Use the precomputed layer_support_areas. The last user of the support area takes it over,
+                // the other users have finished copying it when the count of its users drops to one.
+                int idx_object_layer_above = idx_object_layers_above[idx_intermediate];
+                if (layer_support_areas_users[idx_object_layer_above] == 1)
+                    polygons_new = std::move(layer_support_areas[idx_object_layer_above]);
+                else
+                    polygons_new = layer_support_areas[idx_object_layer_above];
+                if (-- layer_support_areas_users[idx_object_layer_above] == 0)
+                    Polygons().swap(layer_support_areas[idx_object_layer_above]);
 
                 // Polygons to trim polygons_new.
                 Polygons polygons_trimming; 
@@ -191,7 +191,8 @@ private:
 	    const MyLayersPtr   &bottom_contacts,
 	    const MyLayersPtr   &top_contacts,
 	    MyLayersPtr         &intermediate_layers,
-	    const std::vector<Polygons> &layer_support_areas) const;
+	    // Consumed: the support areas are released as soon as all the base layers using them are generated.
+	    std::vector<Polygons> &layer_support_areas) const;
 
 	// Generate raft layers, also expand the 1st support layer
 	// in case there is no raft layer to improve support adhesion.
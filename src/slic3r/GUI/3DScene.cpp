@@ -1872,9 +1872,18 @@ static void thick_point_to_verts(const Vec3crd& point,
 
 void _3DScene::extrusionentity_to_verts(const Polyline &polyline, float width, float height, float print_z, GLVolume& volume)
 {
-	if (polyline.size() >= 2) {
-		size_t num_segments = polyline.size() - 1;
-		thick_lines_to_verts(polyline.lines(), std::vector<double>(num_segments, width), std::vector<double>(num_segments, height), false, print_z, volume);
+	extrusionentity_to_verts(polyline.points.data(), polyline.points.data() + polyline.points.size(), width, height, print_z, volume);
+}
+
+void _3DScene::extrusionentity_to_verts(const Point *points_begin, const Point *points_end, float width, float height, float print_z, GLVolume& volume)
+{
+	if (points_end - points_begin >= 2) {
+		size_t num_segments = points_end - points_begin - 1;
+		Lines  lines;
+		lines.reserve(num_segments);
+		for (const Point *pt = points_begin; pt + 1 != points_end; ++ pt)
+			lines.emplace_back(pt[0], pt[1]);
+		thick_lines_to_verts(lines, std::vector<double>(num_segments, width), std::vector<double>(num_segments, height), false, print_z, volume);
 	}
 }
 
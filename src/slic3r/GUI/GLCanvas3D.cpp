@@ -6573,15 +6573,17 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
 	    {
 		    std::vector<size_t> num_paths_per_role(size_t(erCount), 0);
 		    for (const GCodePreviewData::Extrusion::Layer &layer : preview_data.extrusion.layers)
-		        for (const GCodePreviewData::Extrusion::Path &path : layer.paths)
-		        	++ num_paths_per_role[size_t(path.extrusion_role)];
+		        for (unsigned char role : layer.extrusion_roles)
+		        	++ num_paths_per_role[size_t(role)];
             std::vector<std::vector<float>> roles_values;
 			roles_values.assign(size_t(erCount), std::vector<float>());
 		    for (size_t i = 0; i < roles_values.size(); ++ i)
 		    	roles_values[i].reserve(num_paths_per_role[i]);
             for (const GCodePreviewData::Extrusion::Layer& layer : preview_data.extrusion.layers)
-		        for (const GCodePreviewData::Extrusion::Path &path : layer.paths)
+		        for (size_t path_id = 0; path_id < layer.paths_count(); ++ path_id) {
+		        	const GCodePreviewData::Extrusion::Path path = layer.path(path_id);
 		        	roles_values[size_t(path.extrusion_role)].emplace_back(Helper::path_filter(preview_data.extrusion.view_type, path));
+		        }
             roles_filters.reserve(size_t(erCount));
 			size_t num_buffers = 0;
 		    for (std::vector<float> &values : roles_values) {
@@ -6610,8 +6612,9 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
         const bool is_selected_separate_extruder = m_selected_extruder > 0 && preview_data.extrusion.view_type == GCodePreviewData::Extrusion::ColorPrint;
 		for (const GCodePreviewData::Extrusion::Layer& layer : preview_data.extrusion.layers)
 		{
-			for (const GCodePreviewData::Extrusion::Path& path : layer.paths)
+			for (size_t path_id = 0; path_id < layer.paths_count(); ++ path_id)
 			{
+				const GCodePreviewData::Extrusion::Path path = layer.path(path_id);
                 if (is_selected_separate_extruder && path.extruder_id != m_selected_extruder - 1)
                     continue;
 				std::vector<std::pair<float, GLVolume*>> &filters = roles_filters[size_t(path.extrusion_role)];
@@ -6624,7 +6627,7 @@ void GLCanvas3D::_load_gcode_extrusion_paths(const GCodePreviewData& preview_dat
 				vol.offsets.emplace_back(vol.indexed_vertex_array.quad_indices.size());
 				vol.offsets.emplace_back(vol.indexed_vertex_array.triangle_indices.size());
 
-				_3DScene::extrusionentity_to_verts(path.polyline, path.width, path.height, layer.z, vol);
+				_3DScene::extrusionentity_to_verts(path.points_begin, path.points_end, path.width, path.height, layer.z, vol);
 			}
 			// Ensure that no volume grows over the limits. If the volume is too large, allocate a new one.
 		    for (std::vector<std::pair<float, GLVolume*>> &filters : roles_filters) {
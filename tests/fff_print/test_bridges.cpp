@@ -0,0 +1,152 @@
+#include <catch2/catch.hpp>
+
+#include <map>
+
+#include "libslic3r/BridgeDetector.hpp"
+#include "libslic3r/ClipperUtils.hpp"
+#include "libslic3r/Geometry.hpp"
+#include "libslic3r/GCodeReader.hpp"
+
+#include "test_data.hpp" // get access to init_print, etc
+
+using namespace Slic3r::Test;
+using namespace Slic3r;
+
+// Detected bridge angle in degrees, -1 if no angle was detected.
+static double bridge_angle(const ExPolygons &lower, const ExPolygon &bridge, coord_t spacing = scaled(0.5))
+{
+    BridgeDetector bd(bridge, lower, spacing);
+    return bd.detect_angle() ? Geometry::rad2deg(bd.angle) : -1.;
+}
+
+static bool check_angle(const ExPolygons &lower, const ExPolygon &bridge, double expected, double tolerance = 5. + EPSILON)
+{
+    double angle = bridge_angle(lower, bridge);
+    if (angle < 0.)
+        return false;
+    double delta = angle - expected;
+    if (delta >= 180. - EPSILON)
+        delta -= 180.;
+    return std::abs(delta) < tolerance;
+}
+
+// Length of the bridging lines anchored at both ends in the given direction,
+// evaluated the way the bridge detector did before it indexed the anchors: by clipping the lines with Clipper.
+static double clipped_bridge_length(const ExPolygons &lower, const ExPolygon &bridge, coord_t spacing, double angle)
+{
+    Polygons   grown     = offset(bridge, float(spacing));
+    ExPolygons anchors   = intersection_ex(grown, to_polygons(lower), true);
+    Polygons   clip_area = offset(bridge, 0.5f * float(spacing));
+    BoundingBox bbox = get_extents_rotated(anchors, - angle);
+    Lines lines;
+    double s = sin(angle);
+    double c = cos(angle);
+    for (coord_t y = bbox.min(1); y <= bbox.max(1); y += spacing)
+        lines.push_back(Line(
+            Point((coord_t)round(c * bbox.min(0) - s * y), (coord_t)round(c * y + s * bbox.min(0))),
+            Point((coord_t)round(c * bbox.max(0) - s * y), (coord_t)round(c * y + s * bbox.max(0)))));
+    double total_length = 0.;
+    for (const Line &line : intersection_ln(lines, clip_area))
+        if (expolygons_contain(anchors, line.a) && expolygons_contain(anchors, line.b))
+            total_length += line.length();
+    return total_length;
+}
+
+// O-shaped overhang: a rectangular hole of bridge_size in a lower slice, rotated around its center.
+static std::pair<ExPolygons, ExPolygon> o_shaped_overhang(const Vec2d &bridge_size, double rotate)
+{
+    double x = bridge_size.x();
+    double y = bridge_size.y();
+    ExPolygon lower;
+    lower.contour = Polygon::new_scale({ {-2., -2.}, {x + 2., -2.}, {x + 2., y + 2.}, {-2., y + 2.} });
+    lower.holes.emplace_back(Polygon::new_scale({ {0., 0.}, {0., y}, {x, y}, {x, 0.} }));
+    // avoid negative coordinates for easier SVG preview
+    lower.translate(scaled(20.), scaled(20.));
+    lower.rotate(Geometry::deg2rad(rotate), Point::new_scale(x / 2., y / 2.));
+    ExPolygon bridge(lower.holes.front());
+    bridge.contour.reverse();
+    return { { lower }, bridge };
+}
+
+SCENARIO("BridgeDetector: bridge angle", "[Bridges]")
+{
+    GIVEN("O-shaped overhangs") {
+        THEN("correct bridge angle for O-shaped overhang") {
+            auto [lower1, bridge1] = o_shaped_overhang({ 20., 10. }, 0.);
+            REQUIRE(check_angle(lower1, bridge1, 90.));
+            auto [lower2, bridge2] = o_shaped_overhang({ 10., 20. }, 0.);
+            REQUIRE(check_angle(lower2, bridge2, 0.));
+            auto [lower3, bridge3] = o_shaped_overhang({ 20., 10. }, 45.);
+            REQUIRE(check_angle(lower3, bridge3, 135., 20.));
+            auto [lower4, bridge4] = o_shaped_overhang({ 20., 10. }, 135.);
+            REQUIRE(check_angle(lower4, bridge4, 45., 20.));
+        }
+    }
+    GIVEN("A two-sided bridge") {
+        ExPolygon  bridge(Polygon::new_scale({ {0., 0.}, {20., 0.}, {20., 10.}, {0., 10.} }));
+        ExPolygons lower { ExPolygon(Polygon::new_scale({ {-2., 0.}, {0., 0.}, {0., 10.}, {-2., 10.} })) };
+        lower.emplace_back(lower.front());
+        lower.back().translate(scaled(22.), 0);
+        THEN("correct bridge angle for two-sided bridge") {
+            REQUIRE(check_angle(lower, bridge, 0.));
+        }
+    }
+    GIVEN("A C-shaped overhang") {
+        ExPolygon  bridge(Polygon::new_scale({ {0., 0.}, {20., 0.}, {10., 10.}, {0., 10.} }));
+        ExPolygons lower { ExPolygon(Polygon::new_scale({ {0., 0.}, {0., 10.}, {10., 10.}, {10., 12.}, {-2., 12.}, {-2., -2.}, {22., -2.}, {22., 0.} })) };
+        THEN("correct bridge angle for C-shaped overhang") {
+            REQUIRE(check_angle(lower, bridge, 135.));
+        }
+    }
+    GIVEN("A square overhang with L-shaped anchors") {
+        ExPolygon  bridge(Polygon::new_scale({ {10., 10.}, {20., 10.}, {20., 20.}, {10., 20.} }));
+        ExPolygons lower { ExPolygon(Polygon::new_scale({ {10., 10.}, {10., 20.}, {20., 20.}, {30., 30.}, {0., 30.}, {0., 0.} })) };
+        THEN("correct bridge angle for square overhang with L-shaped anchors") {
+            REQUIRE(check_angle(lower, bridge, 45.));
+        }
+    }
+    GIVEN("O-shaped overhangs rotated in 10 degrees steps") {
+        const coord_t spacing = scaled(0.5);
+        THEN("the detected direction bridges as much as the best direction found by clipping the lines with Clipper") {
+            for (double rotate = 0.; rotate < 180.; rotate += 10.) {
+                auto [lower, bridge] = o_shaped_overhang({ 30., 12. }, rotate);
+                double angle = bridge_angle(lower, bridge, spacing);
+                REQUIRE(angle >= 0.);
+                double best = 0.;
+                for (double a = 0.; a < 180.; a += 5.)
+                    best = std::max(best, clipped_bridge_length(lower, bridge, spacing, Geometry::deg2rad(a)));
+                // A direction within the extrusion width of the best coverage may be preferred for its shorter bridges.
+                REQUIRE(clipped_bridge_length(lower, bridge, spacing, Geometry::deg2rad(angle)) > 0.99 * best - spacing);
+            }
+        }
+    }
+}
+
+SCENARIO("Bridges: bridge direction of a printed bridge", "[Bridges]")
+{
+    GIVEN("The bridge test mesh with bridge_speed 99") {
+        std::string gcode = Slic3r::Test::slice({ TestMesh::bridge }, {
+            { "top_solid_layers",   0 },    // to prevent bridging on sparse infill
+            { "bridge_speed",       99 }
+        });
+        // Extruded length by direction of the bridging moves, in whole degrees.
+        std::map<int, double> extrusions;
+        GCodeReader parser;
+        parser.parse_buffer(gcode, [&extrusions](Slic3r::GCodeReader &self, const Slic3r::GCodeReader::GCodeLine &line) {
+            if (line.cmd_is("G1") && line.extruding(self) && line.dist_XY(self) > 0. && std::abs(line.new_F(self) / 60. - 99.) < EPSILON) {
+                int angle = int(std::round(Geometry::rad2deg(atan2(line.dist_Y(self), line.dist_X(self)))));
+                if (angle < 0)
+                    angle += 180;
+                extrusions[angle % 180] += line.dist_XY(self);
+            }
+        });
+        THEN("bridge is generated") {
+            REQUIRE(! extrusions.empty());
+        }
+        THEN("bridge has the expected direction") {
+            auto main_angle = std::max_element(extrusions.begin(), extrusions.end(),
+                [](const std::pair<const int, double> &l, const std::pair<const int, double> &r) { return l.second < r.second; });
+            REQUIRE(main_angle->first == 0);
+        }
+    }
+}
@@ -0,0 +1,153 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+
+#include "libslic3r/GCode.hpp"
+#include "libslic3r/GCode/CoolingBuffer.hpp"
+
+using namespace Slic3r;
+
+static std::unique_ptr<CoolingBuffer> make_cooling_buffer(GCode &gcode, const DynamicPrintConfig &config, const std::vector<unsigned int> &extruder_ids = { 0 })
+{
+    PrintConfig print_config;
+    print_config.apply(config, true);
+    gcode.apply_print_config(print_config);
+    gcode.set_layer_count(10);
+    gcode.writer().set_extruders(extruder_ids);
+    gcode.writer().set_extruder(extruder_ids.front());
+    return std::make_unique<CoolingBuffer>(gcode);
+}
+
+SCENARIO("Cooling unit tests", "[Cooling]") {
+    const std::string gcode1      = "G1 X100 E1 F3000\n";
+    // 2 sec
+    const double      print_time1 = 100. / (3000. / 60.);
+    const std::string gcode2      = gcode1 + "G1 X0 E1 F3000\n";
+    // 4 sec
+    const double      print_time2 = 2. * print_time1;
+
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    // Default cooling settings.
+    config.set_deserialize({
+        { "bridge_fan_speed",           "100" },
+        { "cooling",                    "1" },
+        { "fan_always_on",              "0" },
+        { "fan_below_layer_time",       "60" },
+        { "max_fan_speed",              "100" },
+        { "min_print_speed",            "10" },
+        { "slowdown_below_layer_time",  "5" },
+        // Override for tests.
+        { "disable_fan_first_layers",   "0" }
+        });
+
+    WHEN("G-code block 3") {
+        THEN("speed is not altered when elapsed time is greater than slowdown threshold") {
+            // Print time of gcode.
+            const double print_time = 100. / (3000. / 60.);
+            config.set_deserialize({ { "slowdown_below_layer_time", std::to_string(print_time * 0.999) } });
+            GCode gcodegen;
+            std::string gcode = make_cooling_buffer(gcodegen, config)->process_layer("G1 F3000;_EXTRUDE_SET_SPEED\nG1 X100 E1", 0);
+            REQUIRE(gcode.find("F3000") != std::string::npos);
+        }
+    }
+
+    WHEN("G-code block 4") {
+        const std::string gcode_src =
+            "G1 X50 F2500\n"
+            "G1 F3000;_EXTRUDE_SET_SPEED\n"
+            "G1 X100 E1\n"
+            ";_EXTRUDE_END\n"
+            "G1 E4 F400";
+        // Print time of gcode.
+        const double print_time = 50. / (2500. / 60.) + 100. / (3000. / 60.) + 4. / (400. / 60.);
+        config.set_deserialize({ { "slowdown_below_layer_time", std::to_string(print_time * 1.001) } });
+        GCode gcodegen;
+        std::string gcode = make_cooling_buffer(gcodegen, config)->process_layer(gcode_src, 0);
+        THEN("speed is altered when elapsed time is lower than slowdown threshold") {
+            REQUIRE(gcode.find("F3000") == std::string::npos);
+        }
+        THEN("speed is not altered for travel moves") {
+            REQUIRE(gcode.find("F2500") != std::string::npos);
+        }
+        THEN("speed is not altered for extruder-only moves") {
+            REQUIRE(gcode.find("F400") != std::string::npos);
+        }
+        THEN("cooling markers are removed") {
+            REQUIRE(gcode.find(";_EXTRUDE") == std::string::npos);
+        }
+    }
+
+    WHEN("G-code block 1") {
+        THEN("fan is not activated when elapsed time is greater than fan threshold") {
+            config.set_deserialize({
+                { "fan_below_layer_time"        , std::to_string(print_time1 * 0.88) },
+                { "slowdown_below_layer_time"   , std::to_string(print_time1 * 0.99) }
+                });
+            GCode gcodegen;
+            std::string gcode = make_cooling_buffer(gcodegen, config)->process_layer(gcode1, 0);
+            REQUIRE(gcode.find("M106") == std::string::npos);
+        }
+    }
+
+    WHEN("G-code block 1 with two extruders") {
+        config.set_deserialize({
+            { "cooling",                    "1, 0" },
+            { "fan_below_layer_time",       std::to_string(print_time2 + 1.) + "," + std::to_string(print_time2 + 1.) },
+            { "slowdown_below_layer_time",  std::to_string(print_time2 + 2.) + "," + std::to_string(print_time2 + 2.) }
+            });
+        GCode gcodegen;
+        std::string gcode = make_cooling_buffer(gcodegen, config, { 0, 1 })->process_layer(gcode1 + "T1\nG1 X0 E1 F3000\n", 0);
+        THEN("fan is activated for the 1st tool") {
+            REQUIRE(gcode.find("M106") == 0);
+        }
+        THEN("fan is disabled for the 2nd tool") {
+            REQUIRE(gcode.find("\nM107") != std::string::npos);
+        }
+    }
+
+    WHEN("G-code block 2") {
+        THEN("slowdown is computed on all objects printing at the same Z") {
+            config.set_deserialize({ { "slowdown_below_layer_time", std::to_string(print_time2 * 0.99) } });
+            GCode gcodegen;
+            std::string gcode = make_cooling_buffer(gcodegen, config)->process_layer(gcode2, 0);
+            REQUIRE(gcode.find("F3000") != std::string::npos);
+        }
+        THEN("fan is not activated on all objects printing at different Z") {
+            config.set_deserialize({
+                { "fan_below_layer_time",       std::to_string(print_time2 * 0.65) },
+                { "slowdown_below_layer_time",  std::to_string(print_time2 * 0.7) }
+                });
+            GCode gcodegen;
+            auto buffer = make_cooling_buffer(gcodegen, config);
+            // use an elapsed time which is < the threshold but greater than it when summed twice
+            std::string gcode = buffer->process_layer(gcode2, 0) + buffer->process_layer(gcode2, 1);
+            REQUIRE(gcode.find("M106") == std::string::npos);
+        }
+        THEN("fan is activated on all objects printing at different Z") {
+            // use an elapsed time which is < the threshold even when summed twice
+            config.set_deserialize({
+                { "fan_below_layer_time",       std::to_string(print_time2 + 1) },
+                { "slowdown_below_layer_time",  std::to_string(print_time2 + 2) }
+                });
+            GCode gcodegen;
+            auto buffer = make_cooling_buffer(gcodegen, config);
+            // use an elapsed time which is < the threshold but greater than it when summed twice
+            std::string gcode = buffer->process_layer(gcode2, 0) + buffer->process_layer(gcode2, 1);
+            REQUIRE(gcode.find("M106") != std::string::npos);
+        }
+    }
+
+    WHEN("A slowed down external perimeter with a G-code comment") {
+        const std::string gcode_src =
+            "G1 F3000 ; perimeter;_EXTRUDE_SET_SPEED;_EXTERNAL_PERIMETER\n"
+            "G1 X100 E1 ; perimeter\n"
+            ";_EXTRUDE_END\n";
+        config.set_deserialize({ { "slowdown_below_layer_time", "10" } });
+        GCode gcodegen;
+        std::string gcode = make_cooling_buffer(gcodegen, config)->process_layer(gcode_src, 0);
+        THEN("only the feedrate is rewritten and the markers are stripped from the comment") {
+            // 100mm over 10 seconds is 600mm/min.
+            REQUIRE(gcode.find("G1 F600 ; perimeter\nG1 X100 E1 ; perimeter\n") != std::string::npos);
+        }
+    }
+}
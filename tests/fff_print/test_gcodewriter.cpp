@@ -1,6 +1,7 @@
 #include <catch2/catch.hpp>
 
 #include <memory>
+#include <random>
 
 #include "libslic3r/GCodeWriter.hpp"
 
@@ -94,3 +95,105 @@ SCENARIO("set_speed emits values with fixed-point output.", "[GCodeWriter]") {
         }
     }
 }
+
+SCENARIO("GCodeFormatter formats numbers the same way as printf does.", "[GCodeWriter]") {
+
+    auto format_fixed = [](double value, int digits) {
+        char buf[64];
+        return std::string(buf, GCodeFormatter::format_fixed(buf, value, digits));
+    };
+    auto printf_fixed = [](double value, int digits) {
+        char buf[64];
+        sprintf(buf, "%.*f", digits, value);
+        return std::string(buf);
+    };
+
+    GIVEN("Values close to a half of the last digit, negative values and zeros") {
+        THEN("The output matches printf") {
+            for (double value : { 0., -0., 0.0005, 0.0015, 1.0005, 2.675, -0.0001, -1.5, 203.2005, 99999.1235, 1e-9, -1e-9, 1e13, -1e13 })
+                for (int digits : { 0, 3, 5 })
+                    REQUIRE(format_fixed(value, digits) == printf_fixed(value, digits));
+        }
+    }
+    GIVEN("Random G-code coordinates and extrusion values") {
+        std::mt19937 rng(0);
+        std::uniform_real_distribution<double> dist(-1000., 1000.);
+        THEN("The output matches printf") {
+            size_t num_mismatches = 0;
+            for (size_t i = 0; i < 100000; ++ i) {
+                double value = dist(rng);
+                if (format_fixed(value, 3) != printf_fixed(value, 3) || format_fixed(value, 5) != printf_fixed(value, 5))
+                    ++ num_mismatches;
+            }
+            REQUIRE(num_mismatches == 0);
+        }
+    }
+    GIVEN("GCodeWriter instance") {
+        GCodeWriter writer;
+        writer.set_extruders({ 0 });
+        writer.set_extruder(0);
+        WHEN("extrude_to_xy is appended to an existing output") {
+            std::string out = "; start\n";
+            writer.extrude_to_xy(out, Vec2d(10.0005, -2.5), 0.123456789, "comment");
+            THEN("The G-code line is appended") {
+                REQUIRE_THAT(out, Catch::Equals("; start\nG1 X10.001 Y-2.500 E0.12346\n"));
+            }
+        }
+    }
+}
+
+SCENARIO("GCodeWriter output matches the former output stream based writer byte for byte.", "[GCodeWriter]") {
+
+    // Expected output was produced by the GCodeWriter formatting through std::ostringstream,
+    // which kept the std::fixed << std::setprecision(5) state of the E axis for the retraction feedrate.
+    auto emit_sequence = [](bool gcode_comments) {
+        GCodeWriter writer;
+        writer.config.gcode_comments.value = gcode_comments;
+        writer.config.retract_speed.values = { 35. };
+        writer.config.deretract_speed.values = { 22.5 };
+        writer.set_extruders({ 0 });
+        std::string out = writer.set_extruder(0);
+        out += writer.travel_to_xy(Vec2d(10.0005, -2.5), "travel");
+        out += writer.extrude_to_xy(Vec2d(20., 3.), 0.123456789, "perimeter");
+        out += writer.retract();
+        out += writer.travel_to_z(1.2, "lift");
+        out += writer.travel_to_xyz(Vec3d(5., 5.25, 0.3), "travel");
+        out += writer.unretract();
+        out += writer.extrude_to_xyz(Vec3d(6., 7., 0.3), 0.05, "infill");
+        out += writer.retract_for_toolchange();
+        out += writer.unretract();
+        out += writer.set_speed(1234.5678);
+        return out;
+    };
+
+    GIVEN("G-code comments disabled") {
+        THEN("The output is identical") {
+            REQUIRE_THAT(emit_sequence(false), Catch::Equals(
+                "G1 X10.001 Y-2.500 F7800.000\n"
+                "G1 X20.000 Y3.000 E0.12346\n"
+                "G1 E-1.87654 F2100.00000\n"
+                "G1 Z1.200 F7800.000\n"
+                "G1 X5.000 Y5.250 Z0.300 F7800.000\n"
+                "G1 E0.12346 F1380.00000\n"
+                "G1 X6.000 Y7.000 Z0.300 E0.17346\n"
+                "G1 E-9.82654 F2100.00000\n"
+                "G1 E0.17346 F1380.00000\n"
+                "G1 F1234.568\n"));
+        }
+    }
+    GIVEN("G-code comments enabled") {
+        THEN("The output is identical") {
+            REQUIRE_THAT(emit_sequence(true), Catch::Equals(
+                "G1 X10.001 Y-2.500 F7800.000 ; travel\n"
+                "G1 X20.000 Y3.000 E0.12346 ; perimeter\n"
+                "G1 E-1.87654 F2100.00000 ; retract\n"
+                "G1 Z1.200 F7800.000 ; lift\n"
+                "G1 X5.000 Y5.250 Z0.300 F7800.000 ; travel\n"
+                "G1 E0.12346 F1380.00000 ; unretract\n"
+                "G1 X6.000 Y7.000 Z0.300 E0.17346 ; infill\n"
+                "G1 E-9.82654 F2100.00000 ; retract for toolchange\n"
+                "G1 E0.17346 F1380.00000 ; unretract\n"
+                "G1 F1234.568\n"));
+        }
+    }
+}
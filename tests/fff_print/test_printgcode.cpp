@@ -1,11 +1,21 @@
 #include <catch2/catch.hpp>
 
 #include "libslic3r/libslic3r.h"
+#include "libslic3r/BoundingBox.hpp"
+#include "libslic3r/GCode.hpp"
+#include "libslic3r/GCode/PreviewData.hpp"
+#include "libslic3r/GCode/ToolOrdering.hpp"
+#include "libslic3r/Layer.hpp"
 #include "libslic3r/GCodeReader.hpp"
+#include "libslic3r/GCodeTimeEstimator.hpp"
+#include "libslic3r/Geometry.hpp"
 
 #include "test_data.hpp"
+#include <test_utils.hpp>
 
 #include <algorithm>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
 
 using namespace Slic3r;
@@ -268,3 +278,280 @@ SCENARIO( "PrintGCode basic functionality", "[PrintGCode]") {
         }
     }
 }
+
+// Positions of the wipe tower tool change moves transformed back to the wipe tower coordinate system,
+// with the extruder offset of the active tool compensated.
+static BoundingBoxf wipe_tower_toolchange_extents(const std::string &gcode, double x, double y, double angle, const std::vector<Vec2d> &extruder_offsets)
+{
+    BoundingBoxf bbox;
+    bool         inside = false;
+    size_t       tool   = 0;
+    const Eigen::Rotation2Dd rotation(- Geometry::deg2rad(angle));
+    GCodeReader parser;
+    parser.parse_buffer(gcode, [&](Slic3r::GCodeReader &self, const Slic3r::GCodeReader::GCodeLine &line) {
+        if (boost::starts_with(line.raw(), "; CP TOOLCHANGE START"))
+            inside = true;
+        else if (boost::starts_with(line.raw(), "; CP TOOLCHANGE END"))
+            inside = false;
+        else if (line.cmd().size() == 2 && line.cmd().front() == 'T')
+            tool = size_t(line.cmd()[1] - '0');
+        else if (inside && line.cmd_is("G1") && (line.has_x() || line.has_y()))
+            bbox.merge(rotation * (Vec2d(line.new_X(self), line.new_Y(self)) + extruder_offsets[tool] - Vec2d(x, y)));
+    });
+    return bbox;
+}
+
+SCENARIO("PrintGCode wipe tower", "[PrintGCode]") {
+    GIVEN("A two extruder print with a wipe tower") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({
+            { "nozzle_diameter",            "0.4,0.4" },
+            { "infill_extruder",            "2" },
+            { "wipe_tower",                 "1" },
+            { "wipe_tower_x",               "120" },
+            { "wipe_tower_y",               "80" },
+            { "start_filament_gcode",       "M117 start filament [filament_extruder_id]" },
+            { "end_filament_gcode",         "M117 end filament" },
+            { "layer_height",               "0.3" },
+            { "first_layer_height",         "0.3" }
+            });
+        std::string gcode = Slic3r::Test::slice({ TestMesh::cube_20x20x20 }, config);
+        BoundingBoxf extents = wipe_tower_toolchange_extents(gcode, 120., 80., 0., { Vec2d::Zero(), Vec2d::Zero() });
+        THEN("the custom filament G-codes are inserted into the tool changes") {
+            REQUIRE(gcode.find("M117 start filament 1\n") != std::string::npos);
+            REQUIRE(gcode.find("M117 end filament\n") != std::string::npos);
+            REQUIRE(gcode.find("[start_filament_gcode]") == std::string::npos);
+            REQUIRE(gcode.find("[toolchange_gcode]") == std::string::npos);
+        }
+        THEN("the tool change moves are placed at the wipe tower position") {
+            REQUIRE(extents.defined);
+            REQUIRE(extents.min.x() > - EPSILON);
+            REQUIRE(extents.min.y() > - EPSILON);
+        }
+        WHEN("the wipe tower is rotated and the second extruder is offset") {
+            config.set_deserialize({
+                { "wipe_tower_rotation_angle",  "30" },
+                { "extruder_offset",            "0x0,10x5" }
+                });
+            std::string gcode_rotated = Slic3r::Test::slice({ TestMesh::cube_20x20x20 }, config);
+            BoundingBoxf extents_rotated = wipe_tower_toolchange_extents(gcode_rotated, 120., 80., 30., { Vec2d::Zero(), Vec2d(10., 5.) });
+            THEN("the tool change moves are rotated around the wipe tower origin and compensated for the extruder offset") {
+                REQUIRE(extents_rotated.defined);
+                REQUIRE((extents_rotated.min - extents.min).norm() < 0.01);
+                REQUIRE((extents_rotated.max - extents.max).norm() < 0.01);
+            }
+        }
+    }
+}
+
+SCENARIO("PrintGCode tool ordering", "[PrintGCode]") {
+    GIVEN("Two objects printed with two extruders, wiping into the infill") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({
+            { "nozzle_diameter",            "0.4,0.4" },
+            { "wipe_tower",                 "1" },
+            { "wipe_into_infill",           "1" },
+            { "layer_height",               "0.3" },
+            { "first_layer_height",         "0.3" }
+            });
+        Print print;
+        Model model;
+        init_print({ TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, print, model, config);
+        model.objects.back()->config.set_key_value("extruder", new ConfigOptionInt(2));
+        print.apply(model, config);
+        print.process();
+        const ToolOrdering &tool_ordering = print.get_tool_ordering();
+        THEN("each object layer is assigned to the tool ordering layer at its print_z") {
+            REQUIRE(! tool_ordering.empty());
+            for (const LayerTools &layer_tools : tool_ordering) {
+                REQUIRE(layer_tools.object_layers.size() == (layer_tools.has_object ? 2 : 0));
+                for (const Layer *layer : layer_tools.object_layers)
+                    REQUIRE(std::abs(layer->print_z - layer_tools.print_z) < EPSILON);
+                if (layer_tools.has_object)
+                    REQUIRE(layer_tools.object_layers.front()->object() != layer_tools.object_layers.back()->object());
+            }
+        }
+        THEN("the infill is used for wiping") {
+            REQUIRE(std::any_of(tool_ordering.begin(), tool_ordering.end(),
+                [](const LayerTools &layer_tools) { return const_cast<LayerTools&>(layer_tools).wiping_extrusions().is_anything_overridden(); }));
+        }
+    }
+}
+
+static std::string estimated_printing_time(const std::string &gcode, const std::string &mode)
+{
+    std::string tag = "; estimated printing time (" + mode + " mode) = ";
+    size_t pos = gcode.find(tag);
+    return pos == std::string::npos ? std::string() : gcode.substr(pos + tag.size(), gcode.find('\n', pos) - pos - tag.size());
+}
+
+SCENARIO("PrintGCode time estimates", "[PrintGCode]") {
+    GIVEN("A Marlin print") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({
+            { "gcode_flavor",   "marlin" },
+            { "silent_mode",    "0" }
+            });
+        std::string gcode_normal = Slic3r::Test::slice({ TestMesh::cube_20x20x20 }, config);
+        WHEN("the silent mode is enabled") {
+            config.set_deserialize({ { "silent_mode", "1" } });
+            std::string gcode_silent = Slic3r::Test::slice({ TestMesh::cube_20x20x20 }, config);
+            THEN("the normal mode estimate does not change when evaluated together with the silent mode") {
+                REQUIRE(! estimated_printing_time(gcode_normal, "normal").empty());
+                REQUIRE(estimated_printing_time(gcode_normal, "silent").empty());
+                REQUIRE(estimated_printing_time(gcode_silent, "normal") == estimated_printing_time(gcode_normal, "normal"));
+            }
+            THEN("the silent mode is estimated") {
+                REQUIRE(! estimated_printing_time(gcode_silent, "silent").empty());
+            }
+        }
+    }
+    GIVEN("A time estimator with the origin of the extruder axis set by a G92") {
+        GCodeTimeEstimator estimator(GCodeTimeEstimator::Normal);
+        estimator.add_gcode_line("G1 X10 E5 F1200");
+        estimator.add_gcode_line("G92");
+        REQUIRE(estimator.get_axis_origin(GCodeTimeEstimator::E) == 5.f);
+        WHEN("the estimator is reset") {
+            estimator.reset();
+            THEN("the origins of all axes are reset") {
+                for (auto axis : { GCodeTimeEstimator::X, GCodeTimeEstimator::Y, GCodeTimeEstimator::Z, GCodeTimeEstimator::E })
+                    REQUIRE(estimator.get_axis_origin(axis) == 0.f);
+            }
+        }
+    }
+}
+
+SCENARIO("PrintGCode analysis of a G-code file", "[PrintGCode]") {
+    GIVEN("A G-code file exported for a Marlin printer") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({
+            { "gcode_flavor",       "marlin" },
+            { "first_layer_height", "0.25" },
+            { "layer_height",       "0.25" },
+            { "gcode_comments",     "1" }
+            });
+        std::string gcode = Slic3r::Test::slice({ TestMesh::cube_20x20x20 }, config);
+        std::string path  = write_temp_file(gcode);
+        PrintConfig print_config;
+        print_config.apply(config, true);
+        GCodeFileStatistics stats = analyze_gcode_file(path, print_config);
+        boost::filesystem::remove(path);
+        THEN("the time estimate matches the one of the G-code export") {
+            REQUIRE(stats.normal_time_dhms == estimated_printing_time(gcode, "normal"));
+            // The silent mode estimate differs, as the machine limits written into the G-code apply to the silent mode as well.
+            REQUIRE(stats.has_silent_time);
+            REQUIRE(stats.silent_time > 0.f);
+        }
+        THEN("the filament usage matches the one of the G-code export") {
+            double filament_used = 0.;
+            size_t pos = gcode.find("; filament used [mm] = ");
+            REQUIRE(pos != std::string::npos);
+            REQUIRE(sscanf(gcode.data() + pos, "; filament used [mm] = %lf", &filament_used) == 1);
+            REQUIRE(stats.filaments.size() == 1);
+            REQUIRE(stats.filaments.front().length_mm == Approx(filament_used).epsilon(0.01));
+        }
+        THEN("the extrusions are reported by the feature types of the exported G-code") {
+            REQUIRE(gcode.find(";_ANALYZER_EXTR_ROLE:") == std::string::npos);
+            REQUIRE(gcode.find(";TYPE:External perimeter\n") != std::string::npos);
+            for (ExtrusionRole role : { erPerimeter, erExternalPerimeter, erInternalInfill, erSolidInfill, erTopSolidInfill, erSkirt })
+                REQUIRE(stats.extrusion_roles[role].filament_mm > 0.);
+            REQUIRE(stats.extrusion_roles.find(erNone) == stats.extrusion_roles.end());
+            double filament_mm = 0.;
+            for (const auto &role : stats.extrusion_roles)
+                filament_mm += role.second.filament_mm;
+            REQUIRE(filament_mm == Approx(stats.filaments.front().length_mm).epsilon(0.01));
+        }
+        THEN("no feature types are exported without gcode_comments") {
+            config.set_deserialize({ { "gcode_comments", "0" } });
+            REQUIRE(Slic3r::Test::slice({ TestMesh::cube_20x20x20 }, config).find(";TYPE:") == std::string::npos);
+        }
+        THEN("all layers are reported") {
+            REQUIRE(stats.layers.size() == 80);
+            REQUIRE(stats.layers.front().z == Approx(0.25));
+            REQUIRE(stats.layers.back().z == Approx(20.));
+        }
+    }
+    GIVEN("A G-code file with the extrusion role tags of the G-code analyzer") {
+        std::string path = write_temp_file(
+            "G1 Z0.2 F3000\n"
+            ";_ANALYZER_EXTR_ROLE:2\n;_ANALYZER_WIDTH:0.45\n;_ANALYZER_HEIGHT:0.2\n"
+            "G1 X10 E1\n"
+            ";_ANALYZER_EXTR_ROLE:4\n"
+            "G1 X10 Y10 E3\n"
+            "G1 X0 Y0\n"
+            "T1\n");
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({ { "nozzle_diameter", "0.4,0.4" } });
+        PrintConfig print_config;
+        print_config.apply(config, true);
+        GCodeFileStatistics stats = analyze_gcode_file(path, print_config);
+        boost::filesystem::remove(path);
+        THEN("the extrusions are reported by their roles") {
+            REQUIRE(stats.extrusion_roles.size() == 2);
+            REQUIRE(stats.extrusion_roles[erExternalPerimeter].filament_mm == Approx(1.));
+            REQUIRE(stats.extrusion_roles[erExternalPerimeter].length_mm == Approx(10.));
+            REQUIRE(stats.extrusion_roles[erInternalInfill].filament_mm == Approx(2.));
+            REQUIRE(stats.to_json().find("\"role\": \"Internal infill\"") != std::string::npos);
+        }
+        THEN("the travel moves and the tool changes are counted") {
+            REQUIRE(stats.travel_length_mm == Approx(0.2 + std::sqrt(200.)));
+            REQUIRE(stats.tool_changes == 1);
+        }
+    }
+}
+
+SCENARIO("PrintGCode preview data", "[PrintGCode]") {
+    GIVEN("Two cubes printed one after the other") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({ TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, print, model, {
+            { "first_layer_height",             0.3 },
+            { "layer_height",                   0.2 },
+            { "complete_objects",               true }
+            });
+        print.process();
+        GCodePreviewData preview_data;
+        std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-%%%%.gcode")).string();
+        print.export_gcode(path, &preview_data);
+        boost::filesystem::remove(path);
+        const GCodePreviewData::Extrusion::LayersList &layers = preview_data.extrusion.layers;
+        THEN("the extrusions of both cubes at the same height are collected into a single layer") {
+            REQUIRE(layers.size() == print.objects().front()->layers().size());
+            for (size_t i = 1; i < layers.size(); ++ i)
+                REQUIRE(layers[i - 1].z < layers[i].z);
+        }
+        THEN("the attribute arrays of each layer are parallel to its paths") {
+            for (const GCodePreviewData::Extrusion::Layer &layer : layers) {
+                REQUIRE(layer.paths_count() > 0);
+                REQUIRE(layer.path_ends.back() == layer.points.size());
+                REQUIRE(layer.extrusion_roles.size() == layer.paths_count());
+                REQUIRE(layer.widths.size() == layer.paths_count());
+                REQUIRE(layer.fan_speeds.size() == layer.paths_count());
+            }
+        }
+        THEN("each path has at least two vertices and no duplicate vertices") {
+            bool valid = true;
+            for (const GCodePreviewData::Extrusion::Layer &layer : layers)
+                for (size_t path_id = 0; path_id < layer.paths_count(); ++ path_id) {
+                    GCodePreviewData::Extrusion::Path path = layer.path(path_id);
+                    valid &= path.size() >= 2 && std::adjacent_find(path.points_begin, path.points_end) == path.points_end;
+                }
+            REQUIRE(valid);
+        }
+        THEN("the external perimeters of both cubes are found on the top layer") {
+            const GCodePreviewData::Extrusion::Layer &layer = layers.back();
+            BoundingBox bbox;
+            for (size_t path_id = 0; path_id < layer.paths_count(); ++ path_id) {
+                GCodePreviewData::Extrusion::Path path = layer.path(path_id);
+                if (path.extrusion_role == erExternalPerimeter)
+                    for (const Point *pt = path.points_begin; pt != path.points_end; ++ pt)
+                        bbox.merge(*pt);
+            }
+            REQUIRE(unscale<double>(bbox.size().x()) > 40.);
+        }
+        THEN("the color mapping ranges are set") {
+            REQUIRE(! preview_data.ranges.height.empty());
+            REQUIRE(! preview_data.ranges.volumetric_rate.empty());
+        }
+    }
+}
@@ -3,6 +3,8 @@
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/Layer.hpp"
+#include "libslic3r/GCode/SeamPlacer.hpp"
+#include "libslic3r/EdgeGrid.hpp"
 
 #include "test_data.hpp"
 
@@ -87,3 +89,153 @@ SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
 #endif
     }
 }
+
+SCENARIO("PrintObject: seam placement penalties", "[PrintObject]") {
+    // Collect the perimeter loops of all layers, recursing into the nested perimeter collections.
+    auto perimeter_loops = [](const PrintObject &object) {
+        std::vector<const ExtrusionLoop*> loops;
+        std::function<void(const ExtrusionEntityCollection&)> collect = [&loops, &collect](const ExtrusionEntityCollection &collection) {
+            for (const ExtrusionEntity *ee : collection.entities)
+                if (ee->is_collection())
+                    collect(*static_cast<const ExtrusionEntityCollection*>(ee));
+                else if (const ExtrusionLoop *loop = dynamic_cast<const ExtrusionLoop*>(ee); loop != nullptr)
+                    loops.emplace_back(loop);
+        };
+        for (const Layer *layer : object.layers())
+            for (const LayerRegion *layerm : layer->regions())
+                collect(layerm->perimeters);
+        return loops;
+    };
+    GIVEN("20mm cube") {
+        WHEN("The seams are aligned") {
+            Slic3r::Print print;
+            Slic3r::Test::init_and_process_print({TestMesh::cube_20x20x20}, print, { { "seam_position", "aligned" } });
+            std::vector<const ExtrusionLoop*> loops = perimeter_loops(*print.objects().front());
+            THEN("Each perimeter loop has a seam penalty for each of its vertices") {
+                REQUIRE(! loops.empty());
+                for (const ExtrusionLoop *loop : loops)
+                    REQUIRE(loop->seam_penalties.size() == loop->polygon().points.size());
+            }
+            THEN("The walls of a cube do not overhang") {
+                for (const ExtrusionLoop *loop : loops)
+                    for (const SeamPenalty &penalty : loop->seam_penalties)
+                        REQUIRE(penalty.overhang == 0.f);
+            }
+            THEN("G-code is exported") {
+                REQUIRE(! Slic3r::Test::gcode(print).empty());
+            }
+        }
+        WHEN("The seams are placed randomly") {
+            Slic3r::Print print;
+            Slic3r::Test::init_and_process_print({TestMesh::cube_20x20x20}, print, { { "seam_position", "random" } });
+            THEN("No seam penalties are calculated") {
+                for (const ExtrusionLoop *loop : perimeter_loops(*print.objects().front()))
+                    REQUIRE(loop->seam_penalties.empty());
+            }
+        }
+        WHEN("The seams are switched from aligned to random") {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            DynamicPrintConfig config = Slic3r::DynamicPrintConfig::full_print_config();
+            config.set_deserialize({ { "seam_position", "aligned" } });
+            Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+            print.process();
+            config.set_deserialize({ { "seam_position", "random" } });
+            print.apply(model, config);
+            print.process();
+            THEN("The stale seam penalties are dropped") {
+                for (const ExtrusionLoop *loop : perimeter_loops(*print.objects().front()))
+                    REQUIRE(loop->seam_penalties.empty());
+                for (const Layer *layer : print.objects().front()->layers())
+                    REQUIRE(! layer->lslices_edge_grid);
+            }
+        }
+    }
+    GIVEN("An object with an overhang") {
+        for (const char *seam_position : { "aligned", "nearest", "rear" }) {
+            WHEN(std::string("The seams are ") + seam_position) {
+                // The G-code export reorders the extrusions of the print in place, thus each G-code is exported from its own print.
+                Slic3r::Print print_precalculated;
+                Slic3r::Test::init_and_process_print({TestMesh::overhang}, print_precalculated, { { "seam_position", seam_position } });
+                std::string gcode_precalculated = Slic3r::Test::gcode(print_precalculated);
+                Slic3r::Print print_evaluated;
+                Slic3r::Test::init_and_process_print({TestMesh::overhang}, print_evaluated, { { "seam_position", seam_position } });
+                // Drop the precalculated penalties, so that the G-code export evaluates them.
+                for (const Layer *layer : print_evaluated.objects().front()->layers())
+                    for (LayerRegion *layerm : layer->regions())
+                        clear_seam_penalties(layerm->perimeters);
+                std::string gcode_evaluated = Slic3r::Test::gcode(print_evaluated);
+                THEN("The seams are placed the same as with the penalties evaluated by the G-code export") {
+                    REQUIRE(! gcode_precalculated.empty());
+                    // Skip the first line with the time stamp.
+                    REQUIRE(gcode_precalculated.substr(gcode_precalculated.find('\n')) == gcode_evaluated.substr(gcode_evaluated.find('\n')));
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Seam penalties of a point inserted into a loop", "[PrintObject]") {
+    const float nozzle_dmr = 0.4f;
+    // Penalties of the loop with the point inserted, updated from the penalties of the loop without it,
+    // shall be exactly the penalties evaluated over the loop with the point inserted.
+    auto check = [nozzle_dmr](const Polygon &polygon, const Point &pt, size_t idx, bool was_clockwise, const EdgeGrid::Grid *grid) {
+        std::vector<SeamPenalty> penalties = seam_penalties_at_vertices(polygon, polygon_parameter_by_length(polygon), was_clockwise, nozzle_dmr, grid);
+        Polygon polygon_inserted = polygon;
+        polygon_inserted.points.insert(polygon_inserted.points.begin() + idx, pt);
+        std::vector<float> lengths = polygon_parameter_by_length(polygon_inserted);
+        insert_seam_penalty(penalties, polygon_inserted, lengths, idx, was_clockwise, nozzle_dmr, grid);
+        std::vector<SeamPenalty> expected = seam_penalties_at_vertices(polygon_inserted, lengths, was_clockwise, nozzle_dmr, grid);
+        REQUIRE(penalties.size() == expected.size());
+        for (size_t i = 0; i < expected.size(); ++ i) {
+            REQUIRE(penalties[i].visibility == expected[i].visibility);
+            REQUIRE(penalties[i].overhang == expected[i].overhang);
+        }
+        return penalties;
+    };
+    GIVEN("A 20mm square") {
+        Polygon square { { 0, 0 }, { scaled(20.), 0 }, { scaled(20.), scaled(20.) }, { 0, scaled(20.) } };
+        WHEN("A point is inserted in the middle of a wall") {
+            std::vector<SeamPenalty> penalties = check(square, Point(scaled(10.), 0), 1, false, nullptr);
+            THEN("The inserted point has the penalty of a flat wall, higher than the corners") {
+                REQUIRE(penalties[1].visibility > penalties[0].visibility);
+                REQUIRE(penalties[1].visibility > penalties[2].visibility);
+            }
+        }
+        WHEN("A point is inserted closer to a corner than the nozzle radius") {
+            check(square, Point(scaled(0.05), 0), 1, false, nullptr);
+            check(square, Point(scaled(19.95), 0), 1, false, nullptr);
+        }
+        WHEN("A point is inserted into a hole") {
+            check(square, Point(scaled(10.), 0), 1, true, nullptr);
+            check(square, Point(scaled(0.1), 0), 1, true, nullptr);
+        }
+        WHEN("The lower layer is smaller, so that one wall overhangs") {
+            ExPolygons lower { ExPolygon(Polygon { { 0, 0 }, { scaled(19.), 0 }, { scaled(19.), scaled(20.) }, { 0, scaled(20.) } }) };
+            EdgeGrid::Grid grid;
+            grid.create(lower, coord_t(scale_(1.)));
+            grid.calculate_sdf();
+            std::vector<SeamPenalty> penalties = check(square, Point(scaled(20.), scaled(7.)), 2, false, &grid);
+            THEN("The inserted point at the overhanging wall is penalized") {
+                REQUIRE(penalties[2].overhang > 0.f);
+            }
+        }
+    }
+    GIVEN("A finely and unevenly sampled circle") {
+        Polygon circle;
+        for (size_t i = 0; i < 200; ++ i) {
+            double angle = 2. * PI * (double(i) + 0.3 * double(i % 3)) / 200.;
+            circle.points.emplace_back(scaled(5. * cos(angle)), scaled(5. * sin(angle)));
+        }
+        std::vector<float> lengths = polygon_parameter_by_length(circle);
+        THEN("The angle at each vertex is the one calculated for all vertices at once") {
+            std::vector<float> angles = polygon_angles_at_vertices(circle, lengths, float(scaled(0.2)));
+            for (size_t i = 0; i < circle.points.size(); ++ i)
+                REQUIRE(polygon_angle_at_vertex(circle, lengths, i, float(scaled(0.2))) == angles[i]);
+        }
+        WHEN("Points are inserted between the vertices") {
+            for (size_t i : { size_t(1), size_t(57), size_t(199) })
+                check(circle, (circle.points[i - 1] + circle.points[i]) / 2, i, false, nullptr);
+        }
+    }
+}
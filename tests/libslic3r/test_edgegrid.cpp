@@ -0,0 +1,39 @@
+#include <catch2/catch.hpp>
+
+#include "libslic3r/EdgeGrid.hpp"
+#include "libslic3r/ExPolygon.hpp"
+
+using namespace Slic3r;
+
+SCENARIO("EdgeGrid signed distance field", "[EdgeGrid]") {
+	GIVEN("A 100x100mm square with a 40x40mm square hole") {
+		ExPolygon expoly;
+		expoly.contour.points = { { 0, 0 }, { scaled(100.), 0 }, { scaled(100.), scaled(100.) }, { 0, scaled(100.) } };
+		expoly.holes.emplace_back(Points({ { scaled(30.), scaled(30.) }, { scaled(30.), scaled(70.) }, { scaled(70.), scaled(70.) }, { scaled(70.), scaled(30.) } }));
+		const coord_t resolution = scaled(1.);
+		const coord_t search_radius = scaled(0.5);
+
+		EdgeGrid::Grid grid_eager;
+		grid_eager.create(expoly, resolution);
+		grid_eager.calculate_sdf();
+		EdgeGrid::Grid grid_lazy;
+		grid_lazy.create(expoly, resolution);
+		grid_lazy.enable_lazy_sdf();
+
+		THEN("The lazy signed distance field matches the eager one") {
+			for (const Point &pt : { Point(scaled(15.), scaled(50.)), Point(scaled(50.), scaled(50.)), Point(scaled(85.), scaled(10.)), Point(scaled(20.), scaled(20.)) }) {
+				coordf_t d_eager, d_lazy;
+				REQUIRE(grid_eager.signed_distance(pt, search_radius, d_eager));
+				REQUIRE(grid_lazy.signed_distance(pt, search_radius, d_lazy));
+				REQUIRE(std::abs(d_eager - d_lazy) < resolution);
+			}
+		}
+		THEN("The sign of the lazy signed distance field is negative inside, positive in the hole") {
+			coordf_t d;
+			REQUIRE(grid_lazy.signed_distance(Point(scaled(15.), scaled(50.)), search_radius, d));
+			REQUIRE(d == Approx(- scaled(15.)).epsilon(0.01));
+			REQUIRE(grid_lazy.signed_distance(Point(scaled(50.), scaled(50.)), search_radius, d));
+			REQUIRE(d == Approx(scaled(20.)).epsilon(0.01));
+		}
+	}
+}
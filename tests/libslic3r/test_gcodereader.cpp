@@ -0,0 +1,93 @@
+#include <catch2/catch.hpp>
+
+#include <test_utils.hpp>
+
+#include <atomic>
+#include <boost/filesystem.hpp>
+
+#include "libslic3r/GCodeReader.hpp"
+
+using namespace Slic3r;
+
+// Lines parsed by the reader, each line with the reader position before the line was processed.
+static std::vector<std::string> parse_lines(const std::function<void(GCodeReader&, GCodeReader::callback_t)> &parse)
+{
+    std::vector<std::string> lines;
+    GCodeReader reader;
+    parse(reader, [&lines](GCodeReader &self, const GCodeReader::GCodeLine &line) {
+        lines.emplace_back(line.raw() + " @" + std::to_string(self.x()) + "," + std::to_string(self.y()) + "," + std::to_string(self.e()));
+    });
+    return lines;
+}
+
+SCENARIO("GCodeReader parsing a file", "[GCodeReader]") {
+    GIVEN("G-code with comments, empty lines, Windows line endings and a missing newline at the end") {
+        const std::string gcode = "G1 X10 Y20 E1 ; move\n\n; comment only\r\n  G92 E0\nT1\nM104 S200\r\nG1 X15.5 E2.5 F1200";
+        std::string path = write_temp_file(gcode);
+        std::vector<std::string> from_buffer = parse_lines([&gcode](GCodeReader &reader, GCodeReader::callback_t callback) { reader.parse_buffer(gcode, callback); });
+        std::vector<std::string> from_file   = parse_lines([&path](GCodeReader &reader, GCodeReader::callback_t callback) { reader.parse_file(path, callback); });
+        boost::filesystem::remove(path);
+        THEN("the file is parsed the same way as a buffer") {
+            REQUIRE(from_buffer.size() == 7);
+            REQUIRE(from_file == from_buffer);
+        }
+        THEN("the last line is parsed even without the newline") {
+            REQUIRE(from_file.back() == "G1 X15.5 E2.5 F1200 @10.000000,20.000000,0.000000");
+        }
+    }
+    GIVEN("A line") {
+        GCodeReader reader;
+        std::string cmd, comment;
+        reader.parse_line("  M117 Layer 1 ; layer change", [&cmd, &comment](GCodeReader&, const GCodeReader::GCodeLine &line) {
+            cmd     = std::string(line.cmd());
+            comment = std::string(line.comment());
+        });
+        THEN("the command and the comment are extracted") {
+            REQUIRE(cmd == "M117");
+            REQUIRE(comment == " layer change");
+        }
+    }
+    GIVEN("A missing and an empty file") {
+        std::string path = write_temp_file("");
+        std::vector<std::string> from_empty   = parse_lines([&path](GCodeReader &reader, GCodeReader::callback_t callback) { reader.parse_file(path, callback); });
+        boost::filesystem::remove(path);
+        std::vector<std::string> from_missing = parse_lines([&path](GCodeReader &reader, GCodeReader::callback_t callback) { reader.parse_file(path, callback); });
+        THEN("no line is parsed") {
+            REQUIRE(from_empty.empty());
+            REQUIRE(from_missing.empty());
+        }
+    }
+}
+
+SCENARIO("GCodeReader parsing a file in parallel", "[GCodeReader]") {
+    GIVEN("A file larger than a single chunk") {
+        std::string gcode;
+        size_t      num_moves = 0;
+        for (size_t layer = 0; gcode.size() < 10 * 1024 * 1024; ++ layer) {
+            gcode += "G1 Z" + std::to_string(layer) + " ; layer\n";
+            for (size_t i = 0; i < 1000; ++ i, ++ num_moves)
+                gcode += "G1 X" + std::to_string(i % 200) + " Y" + std::to_string(layer % 200) + " E0.05\n";
+        }
+        std::string path = write_temp_file(gcode);
+        std::atomic<size_t> moves { 0 };
+        std::atomic<size_t> layers { 0 };
+        std::atomic<size_t> lines { 0 };
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({ { "use_relative_e_distances", "1" } });
+        GCodeReader reader;
+        reader.apply_config(config);
+        reader.parse_file_parallel(path, [&](GCodeReader &self, const GCodeReader::GCodeLine &line) {
+            ++ lines;
+            if (line.extruding(self))
+                ++ moves;
+            else if (line.comment() == " layer")
+                ++ layers;
+        });
+        boost::filesystem::remove(path);
+        THEN("every line is parsed exactly once") {
+            REQUIRE(lines == num_moves + num_moves / 1000);
+            REQUIRE(moves == num_moves);
+            REQUIRE(layers == num_moves / 1000);
+        }
+    }
+}
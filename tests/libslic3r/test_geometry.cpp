@@ -1,5 +1,7 @@
 #include <catch2/catch.hpp>
 
+#include <random>
+
 #include "libslic3r/Point.hpp"
 #include "libslic3r/BoundingBox.hpp"
 #include "libslic3r/Polygon.hpp"
@@ -321,6 +323,63 @@ SCENARIO("Path chaining", "[Geometry]") {
 			}
 		}
 	}
+	GIVEN("A grid of short segments larger than a single chaining cluster") {
+		Polylines polylines;
+		for (coord_t y = 0; y < 100; ++ y)
+			for (coord_t x = 0; x < 100; ++ x)
+				polylines.emplace_back(Point(x * 1000, y * 1000), Point(x * 1000 + 500, y * 1000));
+		auto connection_length = [](const Polylines &chained) {
+			double length = 0.;
+			for (size_t i = 1; i < chained.size(); ++ i)
+				length += (chained[i].first_point() - chained[i - 1].last_point()).cast<double>().norm();
+			return length;
+		};
+		ChainingParams params;
+		params.max_cluster_size = 2000;
+		// Bound the 2-opt improvement, which is cubic in the number of segments.
+		params.time_budget      = 0.1;
+		Polylines chained = chain_polylines(polylines, nullptr, params);
+		THEN("All segments are chained exactly once") {
+			REQUIRE(chained.size() == polylines.size());
+			std::vector<Point> sorted_in, sorted_out;
+			for (const Polyline &pl : polylines)
+				sorted_in.emplace_back(pl.first_point());
+			for (const Polyline &pl : chained)
+				sorted_out.emplace_back(std::min(pl.first_point(), pl.last_point()));
+			std::sort(sorted_in.begin(), sorted_in.end());
+			std::sort(sorted_out.begin(), sorted_out.end());
+			REQUIRE(sorted_in == sorted_out);
+		}
+		THEN("Clustered travel is comparable to the unclustered chaining") {
+			params.max_cluster_size = 0;
+			REQUIRE(connection_length(chained) < 1.2 * connection_length(chain_polylines(polylines, nullptr, params)));
+		}
+	}
+	GIVEN("Randomly placed segments") {
+		Polylines polylines;
+		std::mt19937 rng(0);
+		std::uniform_int_distribution<coord_t> dist(0, 1000000);
+		for (size_t i = 0; i < 200; ++ i)
+			polylines.emplace_back(Point(dist(rng), dist(rng)), Point(dist(rng), dist(rng)));
+		auto connection_length = [](const Polylines &chained) {
+			double length = 0.;
+			for (size_t i = 1; i < chained.size(); ++ i)
+				length += (chained[i].first_point() - chained[i - 1].last_point()).cast<double>().norm();
+			return length;
+		};
+		Polylines chained = chain_polylines(polylines);
+		// With an elapsed time budget, the 2-opt improvement stops before its first iteration, leaving the greedy chain.
+		ChainingParams params;
+		params.time_budget = 1e-9;
+		Polylines chained_greedy = chain_polylines(polylines, nullptr, params);
+		THEN("All segments are chained exactly once") {
+			REQUIRE(chained.size() == polylines.size());
+			REQUIRE(chained_greedy.size() == polylines.size());
+		}
+		THEN("The 2-opt improvement shortens the travel of the greedy chain") {
+			REQUIRE(connection_length(chained) < 0.95 * connection_length(chained_greedy));
+		}
+	}
 }
 
 SCENARIO("Line distances", "[Geometry]"){
@@ -44,3 +44,38 @@ TEST_CASE("Negative 3D offset should produce smaller object.", "[Hollowing]")
     in_mesh.WriteOBJFile("merged_out.obj");
 }
 
+
+TEST_CASE("Interior generated from the cached grid should match", "[Hollowing]")
+{
+    Slic3r::TriangleMesh in_mesh = load_model("20mm_cube.obj");
+    Slic3r::sla::InteriorGridCache cache;
+    Slic3r::sla::HollowingConfig cfg;
+    
+    std::unique_ptr<Slic3r::TriangleMesh> first =
+        Slic3r::sla::generate_interior(in_mesh, cfg, {}, cache);
+    REQUIRE(first);
+    REQUIRE(! cache.empty());
+    REQUIRE(cache.builds() == 1);
+    
+    cfg.min_thickness += 0.5;
+    cfg.closing_distance = 0.;
+    
+    std::unique_ptr<Slic3r::TriangleMesh> cached =
+        Slic3r::sla::generate_interior(in_mesh, cfg, {}, cache);
+    
+    // The grid was reused, not built again.
+    REQUIRE(cache.builds() == 1);
+    
+    std::unique_ptr<Slic3r::TriangleMesh> fresh =
+        Slic3r::sla::generate_interior(in_mesh, cfg);
+    
+    REQUIRE(cached);
+    REQUIRE(fresh);
+    REQUIRE(std::abs(cached->volume()) == Approx(std::abs(fresh->volume())).epsilon(0.01));
+    REQUIRE(std::abs(cached->volume()) < std::abs(first->volume()));
+    
+    // A different quality needs a grid of a different resolution.
+    cfg.quality += 0.1;
+    REQUIRE(Slic3r::sla::generate_interior(in_mesh, cfg, {}, cache));
+    REQUIRE(cache.builds() == 2);
+}
@@ -31,6 +31,36 @@ SCENARIO("Placeholder parser scripting", "[PlaceholderParser]") {
     SECTION("array reference") { REQUIRE(parser.process("{temperature[foo]}") == "357"); }
     SECTION("whitespaces and newlines are maintained") { REQUIRE(parser.process("test [ temperature_ [foo] ] \n hu") == "test 357 \n hu"); }
 
+    // Templates are compiled once and cached, the free-form text and simple variable references are expanded without the macro parser.
+    SECTION("compiled template is re-evaluated with updated variables") {
+        const std::string templ = ";LAYER:[bar]\n;{foo}\n";
+        REQUIRE(parser.process(templ) == ";LAYER:2\n;0\n");
+        parser.set("foo", 3);
+        parser.set("bar", 7);
+        REQUIRE(parser.process(templ) == ";LAYER:7\n;3\n");
+    }
+    SECTION("leading whitespaces are skipped") { REQUIRE(parser.process(" \n [bar] x ") == "2 x "); }
+    SECTION("legacy vector variable of the current extruder") {
+        parser.set("tool_names", std::vector<std::string>{ "T0", "T1", "T2" });
+        REQUIRE(parser.process("[tool_names]", 2) == "T2");
+    }
+    SECTION("braces inside string literals and regular expressions") {
+        REQUIRE(parser.process("{if \"{\" =~ /[{]/}a{\"}\"}{else}b{endif}[bar]") == "a}2");
+    }
+    SECTION("nested if blocks") { REQUIRE(parser.process("{if bar == 2}{if foo == 1}x{else}y{endif}[foo]{endif}z") == "y0z"); }
+    SECTION("error line is reported relative to the whole template") {
+        const std::string templ = "line1\n{bar}\n{undefined_variable}\n";
+        for (int i = 0; i < 2; ++ i) {
+            std::string message;
+            try {
+                parser.process(templ);
+            } catch (std::runtime_error &ex) {
+                message = ex.what();
+            }
+            REQUIRE(message.find("Parsing error at line 3") == 0);
+        }
+    }
+
     // Test the math expressions.
     SECTION("math: 2*3") { REQUIRE(parser.process("{2*3}") == "6"); }
     SECTION("math: 2*3/6") { REQUIRE(parser.process("{2*3/6}") == "1"); }
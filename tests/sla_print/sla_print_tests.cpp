@@ -1,8 +1,13 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <random>
+#include <atomic>
+#include <cstring>
 
 #include "sla_test_utils.hpp"
+#include "libslic3r/SLA/Rotfinder.hpp"
+
+#include <miniz.h>
 
 namespace {
 
@@ -33,6 +38,107 @@ TEST_CASE("Pillar pairhash should be unique", "[SLASupportGeneration]") {
     test_pairhash<unsigned, unsigned long>();
 }
 
+TEST_CASE("Pillar index queries should match brute force search", "[SLASupportGeneration]") {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> coord(-50., 50.);
+
+    sla::PointIndex index;
+    std::vector<sla::PointIndexEl> points;
+    for (unsigned i = 0; i < 1000; ++i) {
+        points.emplace_back(Vec3d{coord(rng), coord(rng), coord(rng)}, i);
+        index.insert(points.back());
+    }
+
+    for (int q = 0; q < 100; ++q) {
+        Vec3d  center{coord(rng), coord(rng), coord(rng)};
+        double radius = 2. + q / 5.;
+
+        std::vector<unsigned> expected, found;
+        for (const auto &p : points)
+            if ((center - p.first).norm() < radius)
+                expected.emplace_back(p.second);
+        for (const auto &p : index.within(center, radius))
+            found.emplace_back(p.second);
+        std::sort(found.begin(), found.end());
+        REQUIRE(found == expected);
+
+        // The nearest point with an odd id
+        auto odd = [](const sla::PointIndexEl &e) { return e.second % 2; };
+        auto qres = index.nearest(center, 1, odd);
+        REQUIRE(qres.size() == 1);
+        for (const auto &p : points)
+            if (odd(p))
+                REQUIRE((center - p.first).norm() >=
+                        (center - qres.front().first).norm());
+    }
+}
+
+TEST_CASE("Pillar search on a support tree should match the cloned index search",
+          "[SLASupportGeneration]") {
+    // The pillar search used to clone the pillar index for every head and
+    // remove the rejected pillars from the clone. Replay both variants on the
+    // pillars of a real support tree with a deterministic rejection rule.
+    sla::SupportConfig supportcfg;
+    for (auto fname : SUPPORT_TEST_MODELS) {
+        SupportByproducts byproducts;
+        test_supports(fname, supportcfg, byproducts);
+        const sla::SupportTreeBuilder &tree = byproducts.supporttree;
+
+        sla::PointIndex pillar_index;
+        for (const sla::Pillar &pillar : tree.pillars())
+            pillar_index.insert(pillar.endpoint(), unsigned(pillar.id));
+
+        for (const sla::Head &head : tree.heads()) {
+            if (!head.is_valid()) continue;
+
+            Vec3d jp = head.junction_point();
+            Vec3d qp{jp.x(), jp.y(), tree.ground_level};
+            auto  accept = [&head](unsigned id) { return (id + head.id) % 3 == 0; };
+
+            std::vector<unsigned> cloned_seq;
+            sla::PointIndex spindex = pillar_index;
+            while (!spindex.empty()) {
+                auto qres = spindex.nearest(qp, 1);
+                if (qres.empty()) break;
+                cloned_seq.emplace_back(qres.front().second);
+                if (accept(qres.front().second)) break;
+                spindex.remove(qres.front());
+            }
+
+            std::vector<unsigned> rejected, filtered_seq;
+            auto not_rejected = [&rejected](const sla::PointIndexEl &e) {
+                return std::find(rejected.begin(), rejected.end(), e.second) ==
+                       rejected.end();
+            };
+            for (;;) {
+                auto qres = pillar_index.nearest(qp, 1, not_rejected);
+                if (qres.empty()) break;
+                filtered_seq.emplace_back(qres.front().second);
+                if (accept(qres.front().second)) break;
+                rejected.emplace_back(qres.front().second);
+            }
+
+            REQUIRE(filtered_seq == cloned_seq);
+        }
+
+        // The pillar interconnection queries the neighbors within reach
+        double d = supportcfg.max_pillar_link_distance_mm;
+        for (const sla::Pillar &pillar : tree.pillars()) {
+            Vec3d qp = pillar.endpoint();
+            auto by_id = [](const sla::PointIndexEl &e1, const sla::PointIndexEl &e2) {
+                return e1.second < e2.second;
+            };
+            auto scanned = pillar_index.query([qp, d](const sla::PointIndexEl &e) {
+                return (e.first - qp).norm() < d;
+            });
+            auto found = pillar_index.within(qp, d);
+            std::sort(scanned.begin(), scanned.end(), by_id);
+            std::sort(found.begin(), found.end(), by_id);
+            REQUIRE(found == scanned);
+        }
+    }
+}
+
 TEST_CASE("Support point generator should be deterministic if seeded", 
           "[SLASupportGeneration], [SLAPointGen]") {
     TriangleMesh mesh = load_model("A_upsidedown.obj");
@@ -82,6 +188,38 @@ TEST_CASE("Support point generator should be deterministic if seeded",
     }
 }
 
+TEST_CASE("Support points from cached layers should match a full run",
+          "[SLASupportGeneration], [SLAPointGen]") {
+    TriangleMesh mesh = load_model("A_upsidedown.obj");
+    sla::EigenMesh3D emesh{mesh};
+
+    TriangleMeshSlicer slicer{&mesh};
+    auto bb        = mesh.bounding_box();
+    auto slicegrid = grid(float(bb.min.z()), float(bb.max.z()), 0.05f);
+    std::vector<ExPolygons> slices;
+    slicer.slice(slicegrid, SlicingMode::Regular, CLOSING_RADIUS, &slices, []{});
+
+    // The layers are built once and reused for all the densities.
+    sla::SupportPointGenerator::Layers layers =
+        sla::SupportPointGenerator::make_layers(slices, slicegrid, [] {});
+
+    for (float density : {1.f, 0.5f, 1.5f, 1.f}) {
+        sla::SupportPointGenerator::Config autogencfg;
+        autogencfg.density_relative = density;
+
+        sla::SupportPointGenerator full{emesh, autogencfg, [] {}, [](int) {}};
+        full.seed(0);
+        full.execute(slices, slicegrid);
+
+        sla::SupportPointGenerator cached{emesh, autogencfg, [] {}, [](int) {}};
+        cached.seed(0);
+        cached.execute(layers);
+
+        REQUIRE(! full.output().empty());
+        REQUIRE(cached.output() == full.output());
+    }
+}
+
 TEST_CASE("Flat pad geometry is valid", "[SLASupportGeneration]") {
     sla::PadConfig padcfg;
     
@@ -219,6 +357,290 @@ TEST_CASE("RasterizedPolygonAreaShouldMatch", "[SLARasterOutput]") {
     REQUIRE(raster_pxsum(raster0) == 0);
 }
 
+TEST_CASE("LayerDrawnAtOnceShouldMatchDrawnByPolygons", "[SLARasterOutput]") {
+    sla::RasterBase::Resolution res{1440, 2560};
+    sla::RasterBase::PixelDim pixdim{68.04 / res.width_px, 120.96 / res.height_px};
+    sla::RasterBase::Trafo trafo(sla::RasterBase::roPortrait, sla::RasterBase::MirrorX);
+    
+    ExPolygons layer;
+    for (double x : {20., 50., 80.}) {
+        layer.emplace_back(square_with_hole(10.));
+        layer.back().translate(scaled(x), scaled(34.));
+    }
+    
+    std::vector<ClipperLib::Polygon> clipper_layer;
+    for (const ExPolygon &poly : layer) {
+        ClipperLib::Polygon cpoly;
+        for (const Point &p : poly.contour.points)
+            cpoly.Contour.push_back({p.x(), p.y()});
+        for (const Polygon &h : poly.holes) {
+            cpoly.Holes.emplace_back();
+            for (const Point &p : h.points)
+                cpoly.Holes.back().push_back({p.x(), p.y()});
+        }
+        clipper_layer.emplace_back(std::move(cpoly));
+    }
+    
+    sla::RasterGrayscaleAAGammaPower by_polygons(res, pixdim, trafo, 1.);
+    for (const ExPolygon &poly : layer)
+        by_polygons.draw(poly);
+    
+    sla::RasterGrayscaleAAGammaPower at_once(res, pixdim, trafo, 1.);
+    at_once.draw(layer);
+    
+    sla::RasterGrayscaleAAGammaPower clipper_at_once(res, pixdim, trafo, 1.);
+    clipper_at_once.draw(clipper_layer);
+    
+    REQUIRE(raster_pxsum(by_polygons) > 0);
+    REQUIRE(raster_pxsum(at_once) == raster_pxsum(by_polygons));
+    
+    sla::EncodedRaster expected = by_polygons.encode(sla::PPMRasterEncoder());
+    sla::EncodedRaster encoded  = at_once.encode(sla::PPMRasterEncoder());
+    sla::EncodedRaster clipper_encoded = clipper_at_once.encode(sla::PPMRasterEncoder());
+    REQUIRE(encoded.size() == expected.size());
+    REQUIRE(std::memcmp(encoded.data(), expected.data(), expected.size()) == 0);
+    REQUIRE(clipper_encoded.size() == expected.size());
+    REQUIRE(std::memcmp(clipper_encoded.data(), expected.data(), expected.size()) == 0);
+}
+
+TEST_CASE("PNGEncoderShouldMatchMiniz", "[SLARasterOutput]") {
+    sla::RasterBase::Resolution res{1440, 2560};
+    sla::RasterBase::PixelDim pixdim{68.04 / res.width_px, 120.96 / res.height_px};
+    sla::RasterGrayscaleAAGammaPower raster(res, pixdim, {}, 1.);
+    
+    // The encoder state is reused, encode several different layers.
+    for (double size : {0., 10., 60., 30.}) {
+        raster.clear();
+        if (size > 0.) {
+            ExPolygon poly = square_with_hole(size);
+            poly.translate(scaled(34.), scaled(60.));
+            raster.draw(poly);
+        }
+        
+        std::vector<uint8_t> pixels(res.pixels());
+        for (size_t row = 0; row < res.height_px; ++row)
+            for (size_t col = 0; col < res.width_px; ++col)
+                pixels[row * res.width_px + col] = raster.read_pixel(col, row);
+        
+        size_t expected_size = 0;
+        void *expected = tdefl_write_image_to_png_file_in_memory(
+            pixels.data(), int(res.width_px), int(res.height_px), 1, &expected_size);
+        REQUIRE(expected != nullptr);
+        
+        sla::EncodedRaster encoded = raster.encode(sla::PNGRasterEncoder());
+        bool equal = encoded.size() == expected_size &&
+                     std::memcmp(encoded.data(), expected, expected_size) == 0;
+        mz_free(expected);
+        REQUIRE(equal);
+    }
+}
+
+TEST_CASE("PrintLayerSameSlicesShouldCompareTheSlices", "[SLARasterOutput]") {
+    auto square = [](ClipperLib::cInt x, ClipperLib::cInt size) {
+        ClipperLib::Polygon poly;
+        poly.Contour = {{x, 0}, {x + size, 0}, {x + size, size}, {x, size}};
+        return poly;
+    };
+    
+    std::vector<ClipperLib::Polygon> slices = {square(0, 1000), square(2000, 500)};
+    std::vector<ClipperLib::Polygon> other  = {square(0, 1000), square(2000, 600)};
+    
+    using PrintLayer = SLAPrint::PrintLayer;
+    PrintLayer a(0), b(1), c(2);
+    a.transformed_slices(slices);
+    b.transformed_slices(slices);
+    c.transformed_slices(other);
+    
+    // Equal layers
+    REQUIRE(a.same_slices(b));
+    REQUIRE(PrintLayer::hash(slices) == PrintLayer::hash(slices));
+    
+    // Different layers
+    REQUIRE(PrintLayer::hash(slices) != PrintLayer::hash(other));
+    REQUIRE(! a.same_slices(c));
+    
+    // A hole makes the layer different as well.
+    std::vector<ClipperLib::Polygon> with_hole = slices;
+    with_hole.front().Holes.emplace_back(square(100, 100).Contour);
+    REQUIRE(PrintLayer::hash(slices) != PrintLayer::hash(with_hole));
+    
+    // Colliding hashes of different slices are told apart by the comparison.
+    size_t h = PrintLayer::hash(slices);
+    REQUIRE(PrintLayer::same_slices(slices, h, slices, h));
+    REQUIRE(! PrintLayer::same_slices(slices, h, other, h));
+    REQUIRE(! PrintLayer::same_slices(slices, h, with_hole, h));
+    REQUIRE(! PrintLayer::same_slices(slices, h, {slices.front()}, h));
+}
+
+TEST_CASE("StreamedLayersShouldMatchCachedLayers", "[SLARasterOutput]") {
+    class TestPrinter: public SLAPrinter {
+    protected:
+        uqptr<sla::RasterBase> create_raster() const override
+        {
+            sla::RasterBase::Resolution res{320, 180};
+            sla::RasterBase::PixelDim pixdim{120. / res.width_px, 68. / res.height_px};
+            return sla::create_raster_grayscale_aa(res, pixdim, 1., {});
+        }
+        sla::EncodedRaster encode_raster(const sla::RasterBase &rst) const override
+        {
+            return rst.encode(sla::PNGRasterEncoder());
+        }
+    public:
+        void apply(const SLAPrinterConfig &) override {}
+        const std::vector<sla::EncodedRaster> &layers() const { return m_layers; }
+    };
+    
+    // Runs of three identical layers, the runs differ, so that a layer
+    // written out of order is detected.
+    std::atomic<size_t> num_drawn{0};
+    auto drawfn = [&num_drawn](sla::RasterBase &raster, size_t idx) {
+        ExPolygon poly = square_with_hole(10. + double(idx / 3));
+        poly.translate(scaled(60.), scaled(34.));
+        raster.draw(poly);
+        ++num_drawn;
+    };
+    auto samefn = [](size_t idx) { return idx % 3 != 0; };
+    
+    const size_t num_layers = 25;
+    const size_t num_runs   = (num_layers + 2) / 3;
+    TestPrinter printer;
+    printer.draw_layers(num_layers, drawfn, samefn);
+    REQUIRE(printer.layers().size() == num_layers);
+    REQUIRE(num_drawn == num_runs);
+    for (size_t i = 0; i < num_layers; ++i)
+        REQUIRE(printer.layers()[i].data() == printer.layers()[i - i % 3].data());
+    
+    for (size_t window : {size_t(1), size_t(3), num_layers * 2}) {
+        std::vector<size_t> indices;
+        std::vector<sla::EncodedRaster> streamed;
+        num_drawn = 0;
+        printer.draw_layers(num_layers, drawfn, samefn,
+                            [&indices, &streamed](sla::EncodedRaster &&rst, size_t idx) {
+                                indices.emplace_back(idx);
+                                streamed.emplace_back(std::move(rst));
+                            }, window);
+        
+        REQUIRE(num_drawn == num_runs);
+        REQUIRE(streamed.size() == num_layers);
+        for (size_t i = 0; i < num_layers; ++i) {
+            REQUIRE(indices[i] == i);
+            REQUIRE(streamed[i].data() == streamed[i - i % 3].data());
+            const sla::EncodedRaster &cached = printer.layers()[i];
+            REQUIRE(streamed[i].size() == cached.size());
+            REQUIRE(std::memcmp(streamed[i].data(), cached.data(), cached.size()) == 0);
+        }
+    }
+}
+
+TEST_CASE("CachedDrainHolesShouldMatchSlicedHoles", "[SLAHollowing]") {
+    TriangleMesh mesh = make_cube(20., 20., 20.);
+    mesh.require_shared_vertices();
+    
+    std::vector<float> slicegrid = grid(0.025f, 20.f, 0.05f);
+    auto slice = [&slicegrid](const TriangleMesh &m) {
+        std::vector<ExPolygons> slices;
+        TriangleMeshSlicer{&m}.slice(slicegrid, SlicingMode::Regular, 0.f, &slices, []{});
+        return slices;
+    };
+    
+    std::vector<ExPolygons> slices = slice(mesh);
+    
+    // Holes drilled from the top and from the side.
+    sla::DrainHoles holes = {
+        sla::DrainHole{Vec3f(5.f, 5.f, 22.f), Vec3f(0.f, 0.f, -1.f), 2.f, 5.f},
+        sla::DrainHole{Vec3f(15.f, 15.f, 22.f), Vec3f(0.f, 0.f, -1.f), 1.f, 8.f},
+        sla::DrainHole{Vec3f(-2.f, 10.f, 10.f), Vec3f(1.f, 0.f, 0.f), 1.5f, 6.f},
+    };
+    
+    auto area = [](const ExPolygons &expolys) {
+        double a = 0.;
+        for (const ExPolygon &expoly : expolys) a += expoly.area();
+        return a;
+    };
+    
+    // The holes cut from the slices by the cache are compared against the
+    // slices of the whole hole meshes on the whole slice grid, cut one by one.
+    auto check = [&slices, &slice, &area](const sla::DrainHoleSlices &cache,
+                                          const sla::DrainHoles &holes) {
+        std::vector<ExPolygons> cut = slices;
+        cache.cut(cut);
+        
+        std::vector<ExPolygons> expected = slices;
+        for (const sla::DrainHole &hole : holes) {
+            TriangleMesh hole_mesh = sla::to_triangle_mesh(hole.to_mesh());
+            hole_mesh.require_shared_vertices();
+            std::vector<ExPolygons> hole_slices = slice(hole_mesh);
+            for (size_t i = 0; i < expected.size(); ++i)
+                expected[i] = diff_ex(expected[i], hole_slices[i]);
+        }
+        
+        REQUIRE(cut.size() == expected.size());
+        for (size_t i = 0; i < cut.size(); ++i) {
+            REQUIRE(cut[i].size() == expected[i].size());
+            REQUIRE(area(cut[i]) == Approx(area(expected[i])));
+        }
+        
+        // The top layer is drilled, the bottom one is not.
+        REQUIRE(area(cut.back()) < area(slices.back()));
+        REQUIRE(area(cut.front()) == Approx(area(slices.front())));
+    };
+    
+    sla::DrainHoleSlices cache;
+    cache.update(holes, slicegrid, 0.f, []{});
+    check(cache, holes);
+    
+    // Move one hole and remove another one.
+    holes[1].pos = Vec3f(12.f, 15.f, 22.f);
+    holes.erase(holes.begin());
+    cache.update(holes, slicegrid, 0.f, []{});
+    check(cache, holes);
+}
+
+TEST_CASE("Rotfinder should match a dense search of the rotations", "[SLARotfinder]") {
+    auto score = [](const TriangleMesh &mesh, const std::array<double, 3> &rot) {
+        Transform3d rt = Transform3d::Identity();
+        rt.rotate(Eigen::AngleAxisd(rot[2], Vec3d::UnitZ()));
+        rt.rotate(Eigen::AngleAxisd(rot[1], Vec3d::UnitY()));
+        rt.rotate(Eigen::AngleAxisd(rot[0], Vec3d::UnitX()));
+        double s = 0.;
+        for (const stl_facet &facet : mesh.stl.facet_start)
+            s += (rt * facet.normal.cast<double>()).lpNorm<1>();
+        return s;
+    };
+
+    Model model;
+    ModelObject *obj = model.add_object();
+    obj->add_volume(load_model("A_upsidedown.obj"));
+    const TriangleMesh &mesh = obj->raw_mesh();
+
+    const size_t N = 30;
+    double dense_best = 0.;
+    for (size_t i = 0; i < N * N * N; ++i) {
+        auto ang = [](size_t k) { return -PI / 2 + (k + .5) * PI / N; };
+        dense_best = std::max(dense_best, score(mesh, {ang(i % N), ang(i / N % N), ang(i / N / N)}));
+    }
+
+    // The accuracy used by the "Optimize orientation" of the GUI
+    std::array<double, 3> rot = sla::find_best_rotation(*obj, .005f);
+    REQUIRE(score(mesh, rot) >= 0.99 * dense_best);
+
+    // The result does not depend on the scheduling of the threads.
+    REQUIRE(sla::find_best_rotation(*obj, .005f) == rot);
+
+    // A cube turned so that its face normals are at their best already.
+    // The identity rotation is not a cell center of the search grid.
+    Matrix3d m;
+    m << -1.,  2.,  2.,
+          2., -1.,  2.,
+          2.,  2., -1.;
+    TriangleMesh cube = make_cube(10., 10., 10.);
+    cube.transform(Matrix3d(m / 3.));
+    ModelObject *cube_obj = model.add_object();
+    cube_obj->add_volume(cube);
+    REQUIRE(score(cube, sla::find_best_rotation(*cube_obj, .005f)) >=
+            score(cube, {0., 0., 0.}) - EPSILON);
+}
+
 TEST_CASE("Triangle mesh conversions should be correct", "[SLAConversions]")
 {
     sla::Contour3D cntr;
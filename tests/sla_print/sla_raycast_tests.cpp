@@ -94,4 +94,35 @@ TEST_CASE("Raycaster with loaded drillholes", "[sla_raycast]")
     // Check for support tree correctness
     test_support_model_collision("20mm_cube.obj", {}, hcfg, holes);
 }
+
+// The drain holes are not drilled into the mesh the supports are built on,
+// the rays have to pass through the holes of a solid cube as well.
+TEST_CASE("Raycaster with drillholes in a solid mesh", "[sla_raycast]")
+{
+    TriangleMesh cube = make_cube(20., 20., 20.);
+    cube.require_shared_vertices();
+
+    // A blind hole 5mm deep, drilled from the top.
+    sla::DrainHoles holes = { sla::DrainHole{Vec3f(10.f, 10.f, 22.f), Vec3f(0.f, 0.f, -1.f), 2.f, 7.f} };
+
+    sla::EigenMesh3D emesh{cube};
+    emesh.load_holes(holes);
+
+    // Fire down into the hole, hit its bottom.
+    auto hit = emesh.query_ray_hit({10., 10., 25.}, {0., 0., -1.});
+    REQUIRE(hit.distance() == Approx(10.));
+
+    // Fire down next to the hole, hit the top of the cube.
+    hit = emesh.query_ray_hit({3., 3., 25.}, {0., 0., -1.});
+    REQUIRE(hit.distance() == Approx(5.));
+
+    // Fire up under the hole, hit the bottom of the cube.
+    hit = emesh.query_ray_hit({10., 10., -5.}, {0., 0., 1.});
+    REQUIRE(hit.distance() == Approx(5.));
+
+    // A copy of the mesh keeps the holes.
+    sla::EigenMesh3D emesh_copy{emesh};
+    hit = emesh_copy.query_ray_hit({10., 10., 25.}, {0., 0., -1.});
+    REQUIRE(hit.distance() == Approx(10.));
+}
 #endif
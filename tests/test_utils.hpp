@@ -4,6 +4,9 @@
 #include <libslic3r/TriangleMesh.hpp>
 #include <libslic3r/Format/OBJ.hpp>
 
+#include <fstream>
+#include <boost/filesystem.hpp>
+
 #if defined(WIN32) || defined(_WIN32)
 #define PATH_SEPARATOR R"(\)"
 #else
@@ -18,4 +21,12 @@ inline Slic3r::TriangleMesh load_model(const std::string &obj_filename)
     return mesh;
 }
 
+// Write the content into a new file in the temporary directory, returns its path. The caller removes the file.
+inline std::string write_temp_file(const std::string &content, const std::string &extension = ".gcode")
+{
+    std::string path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("%%%%-%%%%-%%%%" + extension)).string();
+    std::ofstream(path, std::ios::binary) << content;
+    return path;
+}
+
 #endif // SLIC3R_TEST_UTILS